@@ -11,6 +11,20 @@ YELLOW='\033[1;33m'
 # Make sure we are inside the github workspace
 cd $GITHUB_WORKSPACE
 
+# Print the nanoseconds of the fastest of five runs of the test ROM, writes the output to the file given
+best_time() {
+    local best=0
+    for run in 1 2 3 4 5; do
+        local start=$(date +%s%N)
+        $1 0 70000000 > $2
+        local time=$(( $(date +%s%N) - start ))
+        if [ $best -eq 0 ] || [ $time -lt $best ]; then
+            best=$time
+        fi
+    done
+    echo $best
+}
+
 # Install PlatformIO CLI
 echo -e "\n########################################################################";
 echo -e "${YELLOW}INSTALLING PLATFORMIO CLI"
@@ -23,15 +37,103 @@ echo -e "\n#####################################################################
 echo -e "${YELLOW}BUILD"
 echo "########################################################################";
 pio run -e native
+pio run -e native_swar
+pio run -e native_jit
+pio run -e native_recompiled
 if [ $? -ne 0 ]; then echo -e "${RED}\xe2\x9c\x96"; else echo -e "${GREEN}\xe2\x9c\x93"; fi
 
 echo -e "\n########################################################################";
 echo -e "${YELLOW}RUN TEST"
 echo "########################################################################";
-.pio/build/native/program 0 70000000 | tee test.out
+.pio/build/native/program --frame-hashes 0 70000000 2> test.frames | tee test.out
 if grep -q "Passed all tests" test.out; then 
     echo -e "${GREEN}\xe2\x9c\x93";
 else
     echo -e "${RED}\xe2\x9c\x96"; 
     exit 1;
 fi
+
+echo -e "\n########################################################################";
+echo -e "${YELLOW}CHECK FRAME HASHES"
+echo "########################################################################";
+.pio/build/native_swar/program --frame-hashes 0 70000000 2> test-swar.frames > /dev/null
+for frames in test.frames test-swar.frames; do
+    grep "^Frame" $frames > $frames.hashes || true
+    if cmp -s ci/cpu-instrs.frames $frames.hashes; then
+        echo -e "${GREEN}\xe2\x9c\x93 $frames";
+    else
+        echo -e "${RED}\xe2\x9c\x96 Frames of $frames differ from ci/cpu-instrs.frames"; 
+        diff ci/cpu-instrs.frames $frames.hashes || true
+        exit 1;
+    fi
+done
+
+echo -e "\n########################################################################";
+echo -e "${YELLOW}RUN TEST WITH JIT"
+echo "########################################################################";
+INTERPRETER_TIME=$(best_time .pio/build/native/program /dev/null)
+JIT_TIME=$(best_time .pio/build/native_jit/program test-jit.out)
+if cmp -s test.out test-jit.out; then
+    echo -e "${GREEN}\xe2\x9c\x93";
+else
+    echo -e "${RED}\xe2\x9c\x96 Output differs from the interpreter"; 
+    diff test.out test-jit.out || true
+    exit 1;
+fi
+if ! awk -v i=$INTERPRETER_TIME -v j=$JIT_TIME 'BEGIN { printf "Interpreter: %.3fs, JIT: %.3fs, speedup: %.2fx\n", i / 1e9, j / 1e9, i / j; exit i / j < 1 }'; then
+    echo -e "${RED}\xe2\x9c\x96 The JIT runs slower than the interpreter";
+    exit 1;
+fi
+
+echo -e "\n########################################################################";
+echo -e "${YELLOW}RUN TEST WITH RECOMPILED ROM"
+echo "########################################################################";
+RECOMPILED_TIME=$(best_time .pio/build/native_recompiled/program test-recompiled.out)
+if cmp -s test.out test-recompiled.out; then
+    echo -e "${GREEN}\xe2\x9c\x93";
+else
+    echo -e "${RED}\xe2\x9c\x96 Output differs from the interpreter"; 
+    diff test.out test-recompiled.out || true
+    exit 1;
+fi
+if ! awk -v i=$INTERPRETER_TIME -v r=$RECOMPILED_TIME 'BEGIN { printf "Interpreter: %.3fs, recompiled: %.3fs, speedup: %.2fx\n", i / 1e9, r / 1e9, i / r; exit i / r < 1 }'; then
+    echo -e "${RED}\xe2\x9c\x96 The recompiled ROM runs slower than the interpreter";
+    exit 1;
+fi
+
+echo -e "\n########################################################################";
+echo -e "${YELLOW}RUN IDLE LOOP TEST"
+echo "########################################################################";
+.pio/build/native/program --idle-loops 1 20000000 > test-idle.out 2> test-idle.err
+.pio/build/native/program --no-idle-loops 1 20000000 > test-idle-off.out 2> /dev/null
+cat test-idle.err
+if ! cmp -s ci/idle-loop.expected test-idle-off.out; then
+    echo -e "${RED}\xe2\x9c\x96 Output differs from ci/idle-loop.expected"; 
+    diff ci/idle-loop.expected test-idle-off.out || true
+    exit 1;
+elif ! cmp -s ci/idle-loop.expected test-idle.out; then
+    echo -e "${RED}\xe2\x9c\x96 Skipping idle loops changes the output"; 
+    diff ci/idle-loop.expected test-idle.out || true
+    exit 1;
+elif ! grep -q "Idle loops skipped: [1-9]" test-idle.err; then
+    echo -e "${RED}\xe2\x9c\x96 No idle loops skipped"; 
+    exit 1;
+else
+    echo -e "${GREEN}\xe2\x9c\x93";
+fi
+
+echo -e "\n########################################################################";
+echo -e "${YELLOW}RUN SPRITE TEST"
+echo "########################################################################";
+.pio/build/native/program --frame-hashes 2 2000000 2> test-sprites.frames > /dev/null
+.pio/build/native_swar/program --frame-hashes 2 2000000 2> test-sprites-swar.frames > /dev/null
+for frames in test-sprites.frames test-sprites-swar.frames; do
+    grep "^Frame" $frames > $frames.hashes || true
+    if cmp -s ci/sprites.frames $frames.hashes; then
+        echo -e "${GREEN}\xe2\x9c\x93 $frames";
+    else
+        echo -e "${RED}\xe2\x9c\x96 Frames of $frames differ from ci/sprites.frames"; 
+        diff ci/sprites.frames $frames.hashes || true
+        exit 1;
+    fi
+done
@@ -17,6 +17,7 @@
  **/
 #include "APU.h"
 
+#include "HostTiming.h"
 #include "Memory.h"
 
 // Use Teensyduino's IntervalTimer for all sound channels
@@ -68,34 +69,131 @@ void APU::begin() {
     for (uint8_t i = 0; i < 4; i++) {
         APU::frequencyTimer[i].begin(APU::frequencyUpdate[i], 1000000);
     }
-}
 
-void APU::apuStep() {
-    const nr52_register_t nr52 = {.value = Memory::readByte(MEM_SOUND_NR52)};
+    // React to writes to the sound registers
+    const uint16_t registers[] = {MEM_SOUND_NR11, MEM_SOUND_NR12, MEM_SOUND_NR13, MEM_SOUND_NR14, MEM_SOUND_NR21, MEM_SOUND_NR22,
+                                  MEM_SOUND_NR23, MEM_SOUND_NR24, MEM_SOUND_NR30, MEM_SOUND_NR31, MEM_SOUND_NR33, MEM_SOUND_NR34,
+                                  MEM_SOUND_NR41, MEM_SOUND_NR42, MEM_SOUND_NR43, MEM_SOUND_NR44, MEM_SOUND_NR52};
+    for (uint8_t i = 0; i < sizeof(registers) / sizeof(registers[0]); i++) {
+        Memory::attachIO(registers[i], APU::writeRegister);
+    }
 
-    if (nr52.bits.masterSwitch) {
-        // Calculate frequencies
-        const nrx4_register_t nr14 = {.value = Memory::readByte(MEM_SOUND_NR14)};
-        const nrx4_register_t nr24 = {.value = Memory::readByte(MEM_SOUND_NR24)};
-        const nrx4_register_t nr34 = {.value = Memory::readByte(MEM_SOUND_NR34)};
-        const uint16_t frequency[] = {(uint16_t)(0x20000 / (0x800 - ((nr14.bits.frequency << 8) | Memory::readByte(MEM_SOUND_NR13)))),
-                                      (uint16_t)(0x20000 / (0x800 - ((nr24.bits.frequency << 8) | Memory::readByte(MEM_SOUND_NR23)))),
-                                      (uint16_t)(0x10000 / (0x800 - ((nr34.bits.frequency << 8) | Memory::readByte(MEM_SOUND_NR33))))};
-
-        for (uint8_t i = 0; i < 3; i++) {
-            if (APU::currentFrequency[i] != frequency[i] && frequency[i] != 0) {
-                APU::currentFrequency[i] = frequency[i];
-                APU::frequencyTimer[i].update(1000000 / 8 / (uint32_t)frequency[i]);
+    APU::updateMasterSwitch();
+}
+
+void APU::writeRegister(const uint16_t location, const uint8_t data) {
+    /**
+     * Handle a write to a sound register
+     */
+    HOST_TIMING_ENTER(HOST_TIMING_APU);
+    Memory::writeByteInternal(location, data, true);
+
+    switch (location) {
+        // Sound length counter
+        case MEM_SOUND_NR11:
+            APU::loadLength1();
+            break;
+        case MEM_SOUND_NR21:
+            APU::loadLength2();
+            break;
+        case MEM_SOUND_NR31:
+            APU::loadLength3();
+            break;
+        case MEM_SOUND_NR41:
+            APU::loadLength4();
+            break;
+
+        // Sound channel disable
+        case MEM_SOUND_NR12: {
+            const nrx2_register_t nrx2 = {.value = data};
+            if (nrx2.bits.volume == 0) {
+                APU::disableDac1();
+            } else {
+                APU::enableDac1();
+            }
+            break;
+        }
+        case MEM_SOUND_NR22: {
+            const nrx2_register_t nrx2 = {.value = data};
+            if (nrx2.bits.volume == 0) {
+                APU::disableDac2();
+            } else {
+                APU::enableDac2();
             }
+            break;
+        }
+        case MEM_SOUND_NR30:
+            if ((data & 0x80) == 0) {
+                APU::disableDac3();
+            } else {
+                APU::enableDac3();
+            }
+            break;
+        case MEM_SOUND_NR42: {
+            const nrx2_register_t nrx2 = {.value = data};
+            if (nrx2.bits.volume == 0) {
+                APU::disableDac4();
+            } else {
+                APU::enableDac4();
+            }
+            break;
         }
 
-        const nr43_register_t nr43 = {.value = Memory::readByte(MEM_SOUND_NR43)};
-        const uint16_t noiseFreq = 0x80000 / APU::divisor[nr43.bits.divisor] / (1 << (nr43.bits.shift + 1));
+        // Frequency and sound channel enable
+        case MEM_SOUND_NR13:
+            APU::updateFrequency(Channel::square1);
+            break;
+        case MEM_SOUND_NR14:
+            if (data >> 7) {
+                APU::triggerSquare1();
+            }
+            APU::updateFrequency(Channel::square1);
+            break;
+        case MEM_SOUND_NR23:
+            APU::updateFrequency(Channel::square2);
+            break;
+        case MEM_SOUND_NR24:
+            if (data >> 7) {
+                APU::triggerSquare2();
+            }
+            APU::updateFrequency(Channel::square2);
+            break;
+        case MEM_SOUND_NR33:
+            APU::updateFrequency(Channel::wave);
+            break;
+        case MEM_SOUND_NR34:
+            if (data >> 7) {
+                APU::triggerWave();
+            }
+            APU::updateFrequency(Channel::wave);
+            break;
+        case MEM_SOUND_NR43:
+            APU::updateNoiseFrequency();
+            break;
+        case MEM_SOUND_NR44:
+            if (data >> 7) {
+                APU::triggerNoise();
+            }
+            break;
 
-        if (APU::currentFrequency[Channel::noise] != noiseFreq && noiseFreq != 0) {
-            APU::currentFrequency[Channel::noise] = noiseFreq;
-            APU::frequencyTimer[Channel::noise].update(1000000 / noiseFreq);
-        }
+        case MEM_SOUND_NR52:
+            APU::updateMasterSwitch();
+            break;
+    }
+    HOST_TIMING_LEAVE();
+}
+
+void APU::updateMasterSwitch() {
+    /**
+     * Start or silence all channels according to NR52
+     */
+    const nr52_register_t nr52 = {.value = Memory::readByte(MEM_SOUND_NR52)};
+
+    if (nr52.bits.masterSwitch) {
+        APU::updateFrequency(Channel::square1);
+        APU::updateFrequency(Channel::square2);
+        APU::updateFrequency(Channel::wave);
+        APU::updateNoiseFrequency();
     } else {
         APU::frequencyTimer[Channel::square1].update(1000000);
         APU::frequencyTimer[Channel::square2].update(1000000);
@@ -108,7 +206,46 @@ void APU::apuStep() {
     }
 }
 
+void APU::updateFrequency(const uint8_t channel) {
+    /**
+     * Calculate the frequency of a square or the wave channel from its NRx3 and NRx4 registers
+     */
+    const nr52_register_t nr52 = {.value = Memory::readByte(MEM_SOUND_NR52)};
+    if (!nr52.bits.masterSwitch) {
+        return;
+    }
+
+    const uint16_t nrx3 = channel == Channel::square1 ? MEM_SOUND_NR13 : channel == Channel::square2 ? MEM_SOUND_NR23 : MEM_SOUND_NR33;
+    const nrx4_register_t nrx4 = {.value = Memory::readByte(nrx3 + 1)};
+    const uint32_t clock = channel == Channel::wave ? 0x10000 : 0x20000;
+    const uint16_t frequency = (uint16_t)(clock / (0x800 - ((nrx4.bits.frequency << 8) | Memory::readByte(nrx3))));
+
+    if (APU::currentFrequency[channel] != frequency && frequency != 0) {
+        APU::currentFrequency[channel] = frequency;
+        APU::frequencyTimer[channel].update(1000000 / 8 / (uint32_t)frequency);
+    }
+}
+
+void APU::updateNoiseFrequency() {
+    /**
+     * Calculate the frequency of the noise channel from NR43
+     */
+    const nr52_register_t nr52 = {.value = Memory::readByte(MEM_SOUND_NR52)};
+    if (!nr52.bits.masterSwitch) {
+        return;
+    }
+
+    const nr43_register_t nr43 = {.value = Memory::readByte(MEM_SOUND_NR43)};
+    const uint16_t noiseFreq = 0x80000 / APU::divisor[nr43.bits.divisor] / (1 << (nr43.bits.shift + 1));
+
+    if (APU::currentFrequency[Channel::noise] != noiseFreq && noiseFreq != 0) {
+        APU::currentFrequency[Channel::noise] = noiseFreq;
+        APU::frequencyTimer[Channel::noise].update(1000000 / noiseFreq);
+    }
+}
+
 void APU::squareUpdate1() {
+    HOST_TIMING_ENTER(HOST_TIMING_APU);
     const nrx1_register_t nrx1 = {.value = Memory::readByte(MEM_SOUND_NR11)};
     const nrx4_register_t nrx4 = {.value = Memory::readByte(MEM_SOUND_NR14)};
 
@@ -125,9 +262,11 @@ void APU::squareUpdate1() {
     } else {
         APU::disableSquare1();
     }
+    HOST_TIMING_LEAVE();
 }
 
 void APU::squareUpdate2() {
+    HOST_TIMING_ENTER(HOST_TIMING_APU);
     const nrx1_register_t nrx1 = {.value = Memory::readByte(MEM_SOUND_NR21)};
     const nrx4_register_t nrx4 = {.value = Memory::readByte(MEM_SOUND_NR24)};
 
@@ -144,9 +283,11 @@ void APU::squareUpdate2() {
     } else {
         APU::disableSquare2();
     }
+    HOST_TIMING_LEAVE();
 }
 
 void APU::waveUpdate() {
+    HOST_TIMING_ENTER(HOST_TIMING_APU);
     const nrx4_register_t nrx4 = {.value = Memory::readByte(MEM_SOUND_NR34)};
 
     if (APU::dacEnabled[Channel::wave] && APU::channelEnabled[Channel::wave] && (!nrx4.bits.lengthEnable || APU::lengthCounter[Channel::wave] > 0)) {
@@ -165,9 +306,11 @@ void APU::waveUpdate() {
     } else {
         APU::disableWave();
     }
+    HOST_TIMING_LEAVE();
 }
 
 void APU::noiseUpdate() {
+    HOST_TIMING_ENTER(HOST_TIMING_APU);
     const nrx4_register_t nrx4 = {.value = Memory::readByte(MEM_SOUND_NR44)};
 
     if (APU::dacEnabled[Channel::noise] && APU::channelEnabled[Channel::noise] && (!nrx4.bits.lengthEnable || APU::lengthCounter[Channel::noise] > 0)) {
@@ -191,9 +334,11 @@ void APU::noiseUpdate() {
     } else {
         APU::disableNoise();
     }
+    HOST_TIMING_LEAVE();
 }
 
 void APU::effectUpdate() {
+    HOST_TIMING_ENTER(HOST_TIMING_APU);
     APU::effectTimerCounter++;
 
     // Length update
@@ -294,6 +439,7 @@ void APU::effectUpdate() {
             }
         }
     }
+    HOST_TIMING_LEAVE();
 }
 
 void APU::triggerSquare1() {
@@ -113,7 +113,6 @@ typedef union {
 class APU {
    public:
     static void begin();
-    static void apuStep();
     static void triggerSquare1();
     static void triggerSquare2();
     static void triggerWave();
@@ -158,6 +157,10 @@ class APU {
     static void waveUpdate();
     static void noiseUpdate();
     static void effectUpdate();
+    static void writeRegister(const uint16_t location, const uint8_t data);
+    static void updateMasterSwitch();
+    static void updateFrequency(const uint8_t channel);
+    static void updateNoiseFrequency();
     static void disableSquare1();
     static void disableSquare2();
     static void disableWave();
@@ -0,0 +1,192 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#include "BlockCache.h"
+
+#include <Arduino.h>
+#include <Cartridge.h>
+
+#include "CPU.h"
+#include "Fusion.h"
+#include "Memory.h"
+
+BlockCache::Block BlockCache::blocks[BLOCK_CACHE_SIZE] = {};
+uint32_t BlockCache::pageGeneration[0x100] = {0};
+uint32_t BlockCache::romBank[2] = {0, 1};
+
+const DecodedOp *BlockCache::cursor = NULL;
+const DecodedOp *BlockCache::cursorEnd = NULL;
+uint16_t BlockCache::nextPC = 0;
+uint8_t BlockCache::cursorPage = 0;
+
+bool BlockCache::endsBlock(const uint8_t opcode) {
+    /**
+     * Check if an opcode may change the program flow
+     * @param opcode: The opcode to check
+     * @return True if the block has to end after this opcode
+     */
+    switch (opcode) {
+        // STOP, HALT
+        case 0x10:
+        case 0x76:
+        // JR n, JR cc,n
+        case 0x18:
+        case 0x20:
+        case 0x28:
+        case 0x30:
+        case 0x38:
+        // JP nn, JP cc,nn, JP (HL)
+        case 0xC3:
+        case 0xC2:
+        case 0xCA:
+        case 0xD2:
+        case 0xDA:
+        case 0xE9:
+        // CALL nn, CALL cc,nn
+        case 0xCD:
+        case 0xC4:
+        case 0xCC:
+        case 0xD4:
+        case 0xDC:
+        // RET, RET cc, RETI
+        case 0xC9:
+        case 0xC0:
+        case 0xC8:
+        case 0xD0:
+        case 0xD8:
+        case 0xD9:
+        // RST n
+        case 0xC7:
+        case 0xCF:
+        case 0xD7:
+        case 0xDF:
+        case 0xE7:
+        case 0xEF:
+        case 0xF7:
+        case 0xFF:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+const uint32_t *BlockCache::tag(const uint16_t pc) {
+    /**
+     * Get the tag blocks starting at pc are valid for
+     * @return The location of the current ROM bank or page generation, null if pc is not in a cacheable region
+     */
+    if (pc < MEM_ROM_BANK) {
+        return &romBank[0];
+    } else if (pc < MEM_VRAM) {
+        return &romBank[1];
+    } else if ((pc >= MEM_RAM_INTERNAL && pc < MEM_RAM_ECHO) || (pc >= MEM_HIGH_RAM && pc < MEM_INT_EN_REG)) {
+        return &pageGeneration[pc >> 8];
+    }
+    return NULL;
+}
+
+bool BlockCache::lookup(const uint16_t pc) {
+    /**
+     * Point the cursor to the block starting at pc, decode the block if needed
+     * @param pc: Start address of the block
+     * @return False if the block can't be cached
+     */
+    const uint8_t page = pc >> 8;
+    const uint32_t *current = tag(pc);
+    if (!current) {
+        cursor = cursorEnd;
+        return false;
+    }
+
+    Block &block = slot(pc);
+    if (block.pc != pc || block.tag != *current || block.count == 0) {
+        decode(block, pc, *current);
+    }
+
+    // The first instruction crosses the page boundary
+    if (block.count == 0) {
+        cursor = cursorEnd;
+        return false;
+    }
+
+    cursor = block.ops;
+    cursorEnd = block.ops + block.count;
+    cursorPage = page;
+    return true;
+}
+
+void BlockCache::decode(Block &block, const uint16_t pc, const uint32_t tag) {
+    /**
+     * Decode instructions starting at pc until a branch or the end of the page
+     * @param block: The block to fill
+     * @param pc: Start address of the block
+     * @param tag: Bank or page generation the block is valid for
+     */
+    // HRAM ends right before the IE register
+    const uint32_t pageEnd = pc >= MEM_HIGH_RAM ? MEM_INT_EN_REG : (pc & 0xFF00) + 0x100;
+    uint32_t location = pc;
+
+    block.pc = pc;
+    block.tag = tag;
+    block.count = 0;
+#ifdef CPU_NATIVE_CODE
+    block.native = NULL;
+    block.hits = 0;
+#endif
+
+    while (block.count < BLOCK_MAX_OPS) {
+        const uint8_t opcode = Memory::readByte(location);
+        const uint8_t length = CPU::opLength[opcode];
+        if (location + length > pageEnd) {
+            break;
+        }
+
+        DecodedOp &decoded = block.ops[block.count++];
+        decoded.opcode = opcode;
+        decoded.length = length;
+        if (length == 3) {
+            decoded.operand = Memory::readByte(location + 1) | (Memory::readByte(location + 2) << 8);
+        } else if (length == 2) {
+            decoded.operand = Memory::readByte(location + 1);
+        } else {
+            decoded.operand = 0;
+        }
+
+        location += length;
+        if (endsBlock(opcode)) {
+            break;
+        }
+    }
+
+#ifdef CPU_FUSION
+    for (uint8_t i = 0; i < block.count; i++) {
+        block.ops[i].fusion = Fusion::match(block.ops + i, block.count - i);
+    }
+#endif
+}
+
+void BlockCache::bankSwitched() {
+    /**
+     * Update the mapped ROM banks
+     * Has to be called on every write to the MBC registers
+     */
+    romBank[0] = Cartridge::getRomBank(MEM_ROM);
+    romBank[1] = Cartridge::getRomBank(MEM_ROM_BANK);
+    cursor = cursorEnd;
+}
@@ -0,0 +1,132 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#pragma once
+
+#include <Arduino.h>
+
+// Number of cached blocks, must be a power of two
+#define BLOCK_CACHE_SIZE 256
+
+// Maximum number of instructions per block
+#define BLOCK_MAX_OPS 16
+
+// Blocks can carry native code, see NativeCode
+#if defined(CPU_JIT) || defined(CPU_RECOMPILED)
+#define CPU_NATIVE_CODE
+#endif
+
+// A single predecoded instruction
+struct DecodedOp {
+    uint8_t opcode;
+    // Instruction length in bytes, including the opcode
+    uint8_t length;
+    // Immediate data or 0xCB opcode
+    uint16_t operand;
+#ifdef CPU_FUSION
+    // Fused sequence starting here, see Fusion::match
+    uint8_t fusion;
+#endif
+};
+
+/**
+ * Cache of predecoded basic blocks
+ *
+ * A block is a run of straight-line instructions that ends at the first branch.
+ * Blocks are keyed by their start address and a tag describing what is mapped there:
+ * the ROM bank for cartridge ROM, a write generation for WRAM and HRAM pages.
+ * Blocks never cross a 256 byte page, so a write to a page or a bank switch is all
+ * that is needed to tell whether a block went stale.
+ * Code in any other region is not cached and has to be fetched from memory.
+ */
+class BlockCache {
+   public:
+    static const DecodedOp *fetch(const uint16_t pc);
+    static void invalidate(const uint16_t location);
+    static void bankSwitched();
+    static bool endsBlock(const uint8_t opcode);
+
+   private:
+    friend class Jit;
+    friend class NativeCode;
+
+    struct Block {
+        uint16_t pc;
+        uint8_t count;
+        uint32_t tag;
+        DecodedOp ops[BLOCK_MAX_OPS];
+#ifdef CPU_NATIVE_CODE
+        // Native code, the instruction it starts at and the executions without it
+        void *native;
+        uint8_t entry;
+        uint8_t hits;
+#endif
+    };
+
+    static Block blocks[BLOCK_CACHE_SIZE];
+
+    // Write generation of each RAM page
+    static uint32_t pageGeneration[0x100];
+
+    // Currently mapped ROM banks at 0x0000 and 0x4000
+    static uint32_t romBank[2];
+
+    // Position inside the block being executed
+    static const DecodedOp *cursor;
+    static const DecodedOp *cursorEnd;
+    static uint16_t nextPC;
+    static uint8_t cursorPage;
+
+    static Block &slot(const uint16_t pc);
+    static const uint32_t *tag(const uint16_t pc);
+    static bool lookup(const uint16_t pc);
+    static void decode(Block &block, const uint16_t pc, const uint32_t tag);
+};
+
+inline const DecodedOp *BlockCache::fetch(const uint16_t pc) {
+    /**
+     * Fetch the decoded instruction at pc
+     * @return The decoded instruction or null if pc is not in a cacheable region
+     */
+    if (pc != nextPC || cursor == cursorEnd) {
+        if (!lookup(pc)) return NULL;
+    }
+    const DecodedOp *decoded = cursor++;
+    nextPC = pc + decoded->length;
+    return decoded;
+}
+
+inline BlockCache::Block &BlockCache::slot(const uint16_t pc) {
+    /**
+     * Get the cache slot for a block starting at pc
+     */
+    return blocks[(pc ^ (pc >> 8)) & (BLOCK_CACHE_SIZE - 1)];
+}
+
+inline void BlockCache::invalidate(const uint16_t location) {
+    /**
+     * Mark all blocks in the page of location as stale
+     * Has to be called on every write to WRAM and HRAM
+     * @param location: The address being written
+     */
+    const uint8_t page = location >> 8;
+    pageGeneration[page]++;
+    if (page == cursorPage) {
+        cursor = cursorEnd;
+    }
+}
@@ -19,9 +19,16 @@
 #include "CPU.h"
 
 #include <Arduino.h>
+#include <Scheduler.h>
 #include <time.h>
 
+#include "BlockCache.h"
+#include "Fusion.h"
+#include "IdleLoop.h"
+#include "Interrupts.h"
 #include "Memory.h"
+#include "NativeCode.h"
+#include "Profiler.h"
 
 /**
  * Debuging settings
@@ -32,6 +39,34 @@
 // #define DEBUG_AFTER_CYCLE 0
 // #define DEBUG_AFTER_PC PC_TIMER
 
+/**
+ * Dispatch settings
+ */
+
+// Jump to inlined opcode handlers through computed goto instead of calling
+// them through the handler table. Requires GCC or Clang (labels as values).
+// #define CPU_THREADED_DISPATCH
+
+#if defined(CPU_THREADED_DISPATCH) && !defined(__GNUC__)
+#error "CPU_THREADED_DISPATCH requires GCC or Clang"
+#endif
+
+// Decode 0xCB prefixed opcodes at runtime in a single handler instead of instantiating
+// a handler per opcode. Keeps the interpreter small enough to stay in the ITCM of the
+// Teensy 4.x, run tools/size_report.py on the firmware to check.
+#ifndef PLATFORM_NATIVE
+#define CPU_COMPACT_CB
+#endif
+
+/**
+ * Flag settings
+ */
+
+// Record the result and operands of ADD, ADC, SUB, SBC, CP, AND, OR and XOR instead of
+// computing the flags right away. Flags are only computed once an instruction reads them.
+// Set it as a build flag along with CPU_JIT, compiled code updates the flags itself otherwise.
+// #define CPU_LAZY_FLAGS
+
 /**
  * Registers
  */
@@ -77,20 +112,14 @@ uint16_t CPU::PC = PC_START;
 // LD r1,r2
 #define LD_Nn_Nn(t, s) (((s)&0xFF00) | ((t)&0x00FF))
 #define LD_Nn_nN(t, s) LD_Nn_n(t, s)
-#define LD_nN_Nn(t, s) (((s) >> 8) | ((t)&0xFF00))
-#define LD_nN_nN(t, s) (((s)&0x00FF) | ((t)&0xFF00))
 
-// AND n
-#define AND_Nn_Nn(nn1, nn2) (((nn1) & (nn2)&0xFF00) >> 8)
-#define AND_Nn_nN(nn1, nn2) (((nn1) >> 8) & (nn2)&0x00FF)
-
-// OR n
-#define OR_Nn_Nn(nn1, nn2) ((((nn1) | (nn2)) & 0xFF00) >> 8)
-#define OR_Nn_nN(nn1, nn2) ((((nn1) >> 8) | (nn2)) & 0x00FF)
-
-// XOR n
-#define XOR_Nn_Nn(nn1, nn2) ((((nn1) ^ (nn2)) & 0xFF00) >> 8)
-#define XOR_Nn_nN(nn1, nn2) ((((nn1) >> 8) ^ (nn2)) & 0x00FF)
+// Expand e for every opcode 0x00 - 0xFF
+#define OPCODES_ROW(e, h)                                                                           \
+    e(0x##h##0) e(0x##h##1) e(0x##h##2) e(0x##h##3) e(0x##h##4) e(0x##h##5) e(0x##h##6) e(0x##h##7) \
+    e(0x##h##8) e(0x##h##9) e(0x##h##A) e(0x##h##B) e(0x##h##C) e(0x##h##D) e(0x##h##E) e(0x##h##F)
+#define OPCODES(e)                                                                                                                                  \
+    OPCODES_ROW(e, 0) OPCODES_ROW(e, 1) OPCODES_ROW(e, 2) OPCODES_ROW(e, 3) OPCODES_ROW(e, 4) OPCODES_ROW(e, 5) OPCODES_ROW(e, 6) OPCODES_ROW(e, 7) \
+    OPCODES_ROW(e, 8) OPCODES_ROW(e, 9) OPCODES_ROW(e, A) OPCODES_ROW(e, B) OPCODES_ROW(e, C) OPCODES_ROW(e, D) OPCODES_ROW(e, E) OPCODES_ROW(e, F)
 
 // Flags
 #define ZERO_V                 0x80
@@ -112,6 +141,132 @@ uint16_t CPU::PC = PC_START;
 #define BORROW_S(n1, n2)       (((n1) < (n2)) << 4)
 #define BORROW_Sc(n1, n2, c)   ((((n1) < (n2)) | ((n1) < ((n2) + (c)))) << 4)
 
+#ifdef CPU_LAZY_FLAGS
+// Operations with lazily computed flags
+#define LAZY_NONE 0
+#define LAZY_ADD  1
+#define LAZY_SUB  2
+#define LAZY_AND  3
+#define LAZY_OR   4
+
+// Last operation with lazily computed flags, LAZY_NONE if the flags in AF are up to date
+static uint8_t lazyOp = LAZY_NONE;
+static uint8_t lazyResult, lazyN1, lazyN2, lazyCarry;
+
+static inline uint16_t lazyFlags(const uint16_t af) {
+    /**
+     * Compute the flags of the last operation
+     * @return AF with up to date flags
+     */
+    switch (lazyOp) {
+        case LAZY_ADD:
+            return LD_nN_n(af, ZERO_S(lazyResult) | HALF_Sc(lazyN1, lazyN2, lazyCarry) | CARRY_Sc(lazyResult, lazyN1, lazyN2, lazyCarry));
+        case LAZY_SUB:
+            return LD_nN_n(af, ZERO_S(lazyResult) | SUB_V | HBORROW_Sc(lazyN1, lazyN2, lazyCarry) | BORROW_Sc(lazyN1, lazyN2, lazyCarry));
+        case LAZY_AND:
+            return LD_nN_n(af, ZERO_S(lazyResult) | HALF_V);
+        case LAZY_OR:
+            return LD_nN_n(af, ZERO_S(lazyResult));
+        default:
+            return af;
+    }
+}
+
+// Read flags
+#define AF_FLAGS lazyFlags(AF)
+
+// Write flags
+#define SET_FLAGS(f)                  \
+    do {                              \
+        const uint8_t newFlags = (f); \
+        lazyOp = LAZY_NONE;           \
+        AF = LD_nN_n(AF, newFlags);   \
+    } while (0)
+
+#define LAZY_FLAGS(op, n, n1, n2, c) \
+    do {                             \
+        lazyOp = op;                 \
+        lazyResult = (n);            \
+        lazyN1 = (n1);               \
+        lazyN2 = (n2);               \
+        lazyCarry = (c);             \
+    } while (0)
+
+#define FLAGS_ADD(n, n1, n2, c) LAZY_FLAGS(LAZY_ADD, n, n1, n2, c)
+#define FLAGS_SUB(n, n1, n2, c) LAZY_FLAGS(LAZY_SUB, n, n1, n2, c)
+#define FLAGS_AND(n)            LAZY_FLAGS(LAZY_AND, n, 0, 0, 0)
+#define FLAGS_OR(n)             LAZY_FLAGS(LAZY_OR, n, 0, 0, 0)
+#else
+// Read flags
+#define AF_FLAGS AF
+
+// Write flags
+#define SET_FLAGS(f) AF = LD_nN_n(AF, f)
+
+#define FLAGS_ADD(n, n1, n2, c) SET_FLAGS(ZERO_S(n) | HALF_Sc(n1, n2, c) | CARRY_Sc(n, n1, n2, c))
+#define FLAGS_SUB(n, n1, n2, c) SET_FLAGS(ZERO_S(n) | SUB_V | HBORROW_Sc(n1, n2, c) | BORROW_Sc(n1, n2, c))
+#define FLAGS_AND(n)            SET_FLAGS(ZERO_S(n) | HALF_V)
+#define FLAGS_OR(n)             SET_FLAGS(ZERO_S(n))
+#endif
+
+// Operations of ADD, ADC, SUB, SBC, AND, XOR, OR and CP as encoded in bits 3-5 of the opcode
+#define ALU_ADD 0
+#define ALU_ADC 1
+#define ALU_SUB 2
+#define ALU_SBC 3
+#define ALU_AND 4
+#define ALU_XOR 5
+#define ALU_OR  6
+#define ALU_CP  7
+
+// Operations of the 0xCB prefixed rotates and shifts as encoded in bits 3-5 of the opcode
+#define SHIFT_RLC  0
+#define SHIFT_RRC  1
+#define SHIFT_RL   2
+#define SHIFT_RR   3
+#define SHIFT_SLA  4
+#define SHIFT_SRA  5
+#define SHIFT_SWAP 6
+#define SHIFT_SRL  7
+
+/**
+ * Flag tables
+ */
+
+// Flags of INC n and DEC n per result, the carry flag is left untouched
+#define INC_FLAGS(n) (ZERO_S(n) | (((n)&0x0F) == 0x00) << 5),
+#define DEC_FLAGS(n) (ZERO_S(n) | SUB_V | (((n)&0x0F) == 0x0F) << 5),
+
+static constexpr uint8_t incFlags[256] = {OPCODES(INC_FLAGS)};
+static constexpr uint8_t decFlags[256] = {OPCODES(DEC_FLAGS)};
+
+static constexpr uint8_t daaAdjust(const uint8_t a, const uint8_t flags) {
+    /**
+     * Get the correction DAA applies to A
+     */
+    return (((flags & HALF_V) || (!(flags & SUB_V) && (a & 0x0F) > 0x09)) ? 0x06 : 0x00) |
+           (((flags & CARRY_V) || (!(flags & SUB_V) && a > 0x99)) ? 0x60 : 0x00);
+}
+
+static constexpr uint16_t daaEntry(const uint8_t result, const uint8_t sub, const uint8_t adjust) {
+    /**
+     * Pack the result of DAA and its flags like AF
+     */
+    return result << 8 | ZERO_S(result) | sub | (adjust > 0x06 ? CARRY_V : 0);
+}
+
+static constexpr uint16_t daa(const uint8_t a, const uint8_t flags) {
+    /**
+     * Compute DAA for A and the N, H and C flags
+     */
+    return daaEntry((flags & SUB_V) ? a - daaAdjust(a, flags) : a + daaAdjust(a, flags), flags & SUB_V, daaAdjust(a, flags));
+}
+
+// Result of DAA as AF, indexed by A << 3 | N, H and C flags
+#define DAA_ENTRIES(a) daa(a, 0x00), daa(a, 0x10), daa(a, 0x20), daa(a, 0x30), daa(a, 0x40), daa(a, 0x50), daa(a, 0x60), daa(a, 0x70),
+
+static constexpr uint16_t daaTable[256 * 8] = {OPCODES(DAA_ENTRIES)};
+
 /**
  * Variables
  */
@@ -120,15 +275,17 @@ uint16_t CPU::PC = PC_START;
 volatile bool CPU::cpuEnabled = false;
 
 // Keep count of cycles
-volatile uint64_t CPU::totalCycles = 0;
+uint64_t CPU::totalCycles = 0;
 
 // Init OP
 uint8_t CPU::op = 0x00;
 
-// IME: Interrupt Master Enable Flag
-// 0: All interrupts disabled
-// 1: Enable all interrupts that are enabled in IE (interrupt enable) register
-bool CPU::IME = 0;
+// Init operand
+uint16_t CPU::operand = 0x0000;
+
+// Fetch window, empty until the first fetch
+const uint8_t *CPU::fetchData = NULL;
+uint16_t CPU::fetchStart = 0, CPU::fetchSize = 0;
 
 // Virtual HALT
 bool CPU::halted = 0;
@@ -136,12 +293,6 @@ bool CPU::halted = 0;
 // IRQ control
 uint8_t CPU::enableIRQ = 0, CPU::disableIRQ = 0;
 
-// Divider interval
-uint8_t CPU::divider = 0;
-
-// Timer control
-uint8_t CPU::timerCycles = 0, CPU::timerTotalCycles = 0xFF;
-
 uint8_t CPU::cyclesDelta = 0;
 
 // Debug variables
@@ -153,12 +304,36 @@ uint64_t debugAfterCycle = DEBUG_AFTER_CYCLE;
  * Functions
  */
 
+void CPU::moveFetchWindow() {
+    /**
+     * Point the fetch window to the region PC is in
+     */
+    fetchData = Memory::getFetchWindow(PC, fetchStart, fetchSize);
+}
+
+void CPU::bankSwitched() {
+    /**
+     * Drop the fetch window as it may point to a ROM bank that is no longer mapped
+     * Has to be called on every write to the MBC registers
+     */
+    fetchSize = 0;
+}
+
 uint8_t CPU::readOp() {
     /**
      * Read an opcode from the program
      * @return An 8 byte opcode
      */
-    return Memory::readByte(PC++);
+    uint16_t offset = PC - fetchStart;
+    if (offset >= fetchSize) {
+        moveFetchWindow();
+        offset = PC - fetchStart;
+        if (offset >= fetchSize) {
+            return Memory::readByte(PC++);
+        }
+    }
+    PC++;
+    return fetchData[offset];
 }
 
 uint16_t CPU::readNn() {
@@ -167,8 +342,13 @@ uint16_t CPU::readNn() {
      * Advances PC by two
      * @return Two bytes of big endian program data
      */
-    uint8_t n1 = Memory::readByte(PC++);
-    uint8_t n2 = Memory::readByte(PC++);
+    const uint16_t offset = PC - fetchStart;
+    if (offset + 1 < fetchSize) {
+        PC += 2;
+        return fetchData[offset] | (fetchData[offset + 1] << 8);
+    }
+    uint8_t n1 = readOp();
+    uint8_t n2 = readOp();
     return n1 | (n2 << 8);
 }
 
@@ -201,7 +381,7 @@ void CPU::dumpRegister() {
     /**
      * Dump out all the CPU regsiters for debugging
      */
-    Serial.printf("AF: %04x, BC: %04x, DE: %04x, HL: %04x, SP: %04x, PC: %04x\n", AF, BC, DE, HL, SP, PC);
+    Serial.printf("AF: %04x, BC: %04x, DE: %04x, HL: %04x, SP: %04x, PC: %04x\n", AF_FLAGS, BC, DE, HL, SP, PC);
 }
 
 void CPU::dumpStack() {
@@ -226,2766 +406,1488 @@ void CPU::stopAndRestart() {
     }
 }
 
-void CPU::cpuStep() {
+/**
+ * Opcode handlers
+ * Each handler executes a single instruction. Opcode and operands have already been read
+ * and PC points to the next instruction. Cycles are taken from the dispatch tables below.
+ * @return True if a conditional branch was taken
+ */
+
+template <uint8_t r>
+inline uint8_t CPU::readRegister() {
     /**
-     * Perform one CPU operation
-     * This will update the timer, check for interrupts, decode and act upon the current opcode
+     * Read an 8 bit operand
+     * @param r: Operand as encoded in the opcode: B, C, D, E, H, L, (HL), A
+     * @return The value of the register or the byte at HL
      */
-    uint8_t n, n1, n2, interrupt;
-    int8_t sn;
-    uint16_t nn, nn1, nn2;
-    bool c;
-
-    if (!cpuEnabled) return;
-
-#ifdef HALT_AT_ZERO
-    if (PC == 0) {
-        Serial.printf("PC at %02x\n", PC);
-        dumpRegister();
-        stopAndRestart();
-    }
-#endif
-
-#ifdef HALT_AFTER_CYCLE
-    if (totalCycles > HALT_AFTER_CYCLE) {
-        Serial.printf("0x8000 - 0x97FF (Tile Data):\n");
-        for (uint16_t i = 0x8000; i < 0x97FF; i += 2) {
-            Serial.printf("%02x-%02x ", Memory::readByte(i), Memory::readByte(i + 1));
-        }
-        Serial.printf("\n");
-        Serial.printf("0x9800 - 0x9BFF (Background Map):\n");
-        for (uint16_t i = 0x9800; i < 0x9BFF; i++) {
-            Serial.printf("%02x ", Memory::readByte(i));
-        }
-        Serial.printf("\n");
-        Serial.printf("0x9C00 - 0x9FFF (Background Maps):\n");
-        for (uint16_t i = 0x9C00; i < 0x9FFF; i++) {
-            Serial.printf("%02x ", Memory::readByte(i));
-        }
-        Serial.printf("\n");
-        Serial.printf("0xFE00 - 0xFEA0 (OAM):\n");
-        for (uint16_t i = 0xFE00; i < 0xFEA0; i += 4) {
-            Serial.printf("%02x-%02x-%02x-%02x ", Memory::readByte(i), Memory::readByte(i + 1), Memory::readByte(i + 2), Memory::readByte(i + 3));
-        }
-        Serial.printf("\n");
-        Serial.printf("0xFF40 (LCDC): %02x\n", Memory::readByte(0xFF40));
-        Serial.printf("0xFF41 (STAT): %02x\n", Memory::readByte(0xFF41));
-        stopAndRestart();
-    }
-#endif
-
-    // Update timer
-    // Check to see if timer is enabled
-    if ((Memory::readByte(MEM_TIMER_CONTROL) & 0x04)) {
-        // Check the current TAC Input Clock Select field
-        switch (Memory::readByte(MEM_TIMER_CONTROL) & 0x03) {
-            // Take the modulo of total cycles with a divider based
-            // on TAC. If this is 0, TIMA will be incremented
-            case 3:
-                timerTotalCycles = 64;
-                break;
-
-            case 2:
-                timerTotalCycles = 16;
-                break;
-
-            case 1:
-                timerTotalCycles = 4;
-                break;
-
-            default:
-                timerTotalCycles = 250;
-                break;
-        }
-
-        const uint8_t newTimerCycles = timerCycles + cyclesDelta;
-        while (timerCycles < newTimerCycles) {
-            timerCycles++;
-            if (timerCycles == timerTotalCycles) {
-                Memory::writeByteInternal(MEM_TIMA, Memory::readByte(MEM_TIMA) + 1, true);
-
-                if (Memory::readByte(MEM_TIMA) == 0) {
-                    Memory::writeByteInternal(MEM_TIMA, Memory::readByte(MEM_TMA), true);
-                    Memory::interrupt(IRQ_TIMER);
-                }
-            }
-        }
-
-        timerCycles %= timerTotalCycles;
-    }
-
-    // Check for interrupts
-    // Only service interrupts when IME is enabled or the CPU is halted
-    if (IME || halted) {
-        interrupt = Memory::readByte(MEM_IRQ_FLAG) & Memory::readByte(MEM_IRQ_ENABLE) & 0x1F;
-
-        if (interrupt) {
-            if (IME && !halted) {
-                IME = 0;
-                if ((interrupt & IRQ_VBLANK) == IRQ_VBLANK) {
-                    Memory::writeByte(MEM_IRQ_FLAG, Memory::readByte(MEM_IRQ_FLAG) & (0xFF - IRQ_VBLANK));
-                    pushStack(PC);
-                    PC = PC_VBLANK;
-                } else if ((interrupt & IRQ_LCD_STAT) == IRQ_LCD_STAT) {
-                    Memory::writeByte(MEM_IRQ_FLAG, Memory::readByte(MEM_IRQ_FLAG) & (0xFF - IRQ_LCD_STAT));
-                    pushStack(PC);
-                    PC = PC_LCD_STAT;
-                } else if ((interrupt & IRQ_TIMER) == IRQ_TIMER) {
-                    Memory::writeByte(MEM_IRQ_FLAG, Memory::readByte(MEM_IRQ_FLAG) & (0xFF - IRQ_TIMER));
-                    pushStack(PC);
-                    PC = PC_TIMER;
-                } else if ((interrupt & IRQ_SERIAL) == IRQ_SERIAL) {
-                    Memory::writeByte(MEM_IRQ_FLAG, Memory::readByte(MEM_IRQ_FLAG) & (0xFF - IRQ_SERIAL));
-                    pushStack(PC);
-                    PC = PC_SERIAL;
-                } else if ((interrupt & IRQ_JOYPAD) == IRQ_JOYPAD) {
-                    Memory::writeByte(MEM_IRQ_FLAG, Memory::readByte(MEM_IRQ_FLAG) & (0xFF - IRQ_JOYPAD));
-                    pushStack(PC);
-                    PC = PC_JOYPAD;
-                }
-            }
-
-            halted = 0;
-        }
-    }
-
-    // Update divider register
-    const uint8_t newDivider = divider + cyclesDelta;
-    while (divider < newDivider) {
-        divider++;
-        if (divider == 61) {
-            Memory::writeByteInternal(MEM_DIVIDER, Memory::readByte(MEM_DIVIDER) + 1, true);
-        }
-    }
-    divider %= 61;
-
-    // Check if halted
-    if (halted) {
-        cyclesDelta = 1;  // In order for the timer to work properly
-        totalCycles += cyclesDelta;
-        return;
-    }
-
-#ifdef DEBUG_AFTER_PC
-    if (PC == DEBUG_AFTER_PC && debugAfterCycle == 0) {
-        debugAfterCycle = totalCycles;
-    }
-#endif
-
-    op = readOp();
-
-#ifdef DEBUG_AFTER_CYCLE
-    if (debugAfterCycle > 0 && totalCycles >= debugAfterCycle) {
-        delay(20);
-        Serial.printf("Cycle %llu: %02x at %04x - ", totalCycles, op, PC - 1);
-        dumpRegister();
-
-        /*for (uint16_t i = 0x8000; i <= 0x97FF; i++) {
-            Serial.printf("%02x ", Memory::readByte(i));
-        }
-
-        Serial.printf("\n");
-        stopAndRestart();*/
+    switch (r) {
+        case 0:
+            return BC >> 8;
+        case 1:
+            return BC & 0x00FF;
+        case 2:
+            return DE >> 8;
+        case 3:
+            return DE & 0x00FF;
+        case 4:
+            return HL >> 8;
+        case 5:
+            return HL & 0x00FF;
+        case 6:
+            return Memory::readByte(HL);
+        default:
+            return AF >> 8;
     }
-#endif
-
-    switch (op) {
-        // NOP
-        // No Operation
-        case 0x0:
-            cyclesDelta = 1;
-            break;
+}
 
-        // STOP
-        // Halt the CPU until button pressed
-        // TODO: implement correctly
-        case 0x10:
-            readOp();
-            cyclesDelta = 1;
+template <uint8_t r>
+inline void CPU::writeRegister(const uint8_t n) {
+    /**
+     * Write an 8 bit operand
+     * @param r: Operand as encoded in the opcode: B, C, D, E, H, L, (HL), A
+     * @param n: The value to write
+     */
+    switch (r) {
+        case 0:
+            BC = LD_Nn_n(BC, n);
             break;
-
-        // HALT
-        // Halt the CPU
-        case 0x76:
-            halted = 1;
-            cyclesDelta = 1;
+        case 1:
+            BC = LD_nN_n(BC, n);
             break;
-
-        // LD nn,n
-        case 0x06:
-            BC = LD_Nn_n(BC, readOp());
-            cyclesDelta = 2;
+        case 2:
+            DE = LD_Nn_n(DE, n);
             break;
-        case 0x0E:
-            BC = LD_nN_n(BC, readOp());
-            cyclesDelta = 2;
+        case 3:
+            DE = LD_nN_n(DE, n);
             break;
-        case 0x16:
-            DE = LD_Nn_n(DE, readOp());
-            cyclesDelta = 2;
+        case 4:
+            HL = LD_Nn_n(HL, n);
             break;
-        case 0x1E:
-            DE = LD_nN_n(DE, readOp());
-            cyclesDelta = 2;
+        case 5:
+            HL = LD_nN_n(HL, n);
             break;
-        case 0x26:
-            HL = LD_Nn_n(HL, readOp());
-            cyclesDelta = 2;
+        case 6:
+            Memory::writeByte(HL, n);
             break;
-        case 0x2E:
-            HL = LD_nN_n(HL, readOp());
-            cyclesDelta = 2;
+        default:
+            AF = LD_Nn_n(AF, n);
             break;
+    }
+}
 
-        // LD r1,r2
-        case 0x7F:
-            AF = LD_Nn_Nn(AF, AF);
-            cyclesDelta = 1;
-            break;
-        case 0x78:
-            AF = LD_Nn_Nn(AF, BC);
-            cyclesDelta = 1;
-            break;
-        case 0x79:
-            AF = LD_Nn_nN(AF, BC);
-            cyclesDelta = 1;
-            break;
-        case 0x7A:
-            AF = LD_Nn_Nn(AF, DE);
-            cyclesDelta = 1;
-            break;
-        case 0x7B:
-            AF = LD_Nn_nN(AF, DE);
-            cyclesDelta = 1;
-            break;
-        case 0x7C:
-            AF = LD_Nn_Nn(AF, HL);
-            cyclesDelta = 1;
-            break;
-        case 0x7D:
-            AF = LD_Nn_nN(AF, HL);
-            cyclesDelta = 1;
-            break;
-        case 0x7E:
-            AF = LD_Nn_nN(AF, Memory::readByte(HL));
-            cyclesDelta = 2;
-            break;
-        case 0x40:
-            BC = LD_Nn_Nn(BC, BC);
-            cyclesDelta = 1;
-            break;
-        case 0x41:
-            BC = LD_Nn_nN(BC, BC);
-            cyclesDelta = 1;
-            break;
-        case 0x42:
-            BC = LD_Nn_Nn(BC, DE);
-            cyclesDelta = 1;
-            break;
-        case 0x43:
-            BC = LD_Nn_nN(BC, DE);
-            cyclesDelta = 1;
-            break;
-        case 0x44:
-            BC = LD_Nn_Nn(BC, HL);
-            cyclesDelta = 1;
-            break;
-        case 0x45:
-            BC = LD_Nn_nN(BC, HL);
-            cyclesDelta = 1;
-            break;
-        case 0x46:
-            BC = LD_Nn_nN(BC, Memory::readByte(HL));
-            cyclesDelta = 2;
-            break;
-        case 0x48:
-            BC = LD_nN_Nn(BC, BC);
-            cyclesDelta = 1;
-            break;
-        case 0x49:
-            BC = LD_nN_nN(BC, BC);
-            cyclesDelta = 1;
-            break;
-        case 0x4A:
-            BC = LD_nN_Nn(BC, DE);
-            cyclesDelta = 1;
-            break;
-        case 0x4B:
-            BC = LD_nN_nN(BC, DE);
-            cyclesDelta = 1;
-            break;
-        case 0x4C:
-            BC = LD_nN_Nn(BC, HL);
-            cyclesDelta = 1;
-            break;
-        case 0x4D:
-            BC = LD_nN_nN(BC, HL);
-            cyclesDelta = 1;
-            break;
-        case 0x4E:
-            BC = LD_nN_nN(BC, Memory::readByte(HL));
-            cyclesDelta = 2;
-            break;
-        case 0x50:
-            DE = LD_Nn_Nn(DE, BC);
-            cyclesDelta = 1;
-            break;
-        case 0x51:
-            DE = LD_Nn_nN(DE, BC);
-            cyclesDelta = 1;
-            break;
-        case 0x52:
-            DE = LD_Nn_Nn(DE, DE);
-            cyclesDelta = 1;
-            break;
-        case 0x53:
-            DE = LD_Nn_nN(DE, DE);
-            cyclesDelta = 1;
-            break;
-        case 0x54:
-            DE = LD_Nn_Nn(DE, HL);
-            cyclesDelta = 1;
-            break;
-        case 0x55:
-            DE = LD_Nn_nN(DE, HL);
-            cyclesDelta = 1;
-            break;
-        case 0x56:
-            DE = LD_Nn_nN(DE, Memory::readByte(HL));
-            cyclesDelta = 2;
-            break;
-        case 0x58:
-            DE = LD_nN_Nn(DE, BC);
-            cyclesDelta = 1;
-            break;
-        case 0x59:
-            DE = LD_nN_nN(DE, BC);
-            cyclesDelta = 1;
-            break;
-        case 0x5A:
-            DE = LD_nN_Nn(DE, DE);
-            cyclesDelta = 1;
-            break;
-        case 0x5B:
-            DE = LD_nN_nN(DE, DE);
-            cyclesDelta = 1;
-            break;
-        case 0x5C:
-            DE = LD_nN_Nn(DE, HL);
-            cyclesDelta = 1;
-            break;
-        case 0x5D:
-            DE = LD_nN_nN(DE, HL);
-            cyclesDelta = 1;
-            break;
-        case 0x5E:
-            DE = LD_nN_nN(DE, Memory::readByte(HL));
-            cyclesDelta = 2;
-            break;
-        case 0x60:
-            HL = LD_Nn_Nn(HL, BC);
-            cyclesDelta = 1;
-            break;
-        case 0x61:
-            HL = LD_Nn_nN(HL, BC);
-            cyclesDelta = 1;
-            break;
-        case 0x62:
-            HL = LD_Nn_Nn(HL, DE);
-            cyclesDelta = 1;
-            break;
-        case 0x63:
-            HL = LD_Nn_nN(HL, DE);
-            cyclesDelta = 1;
-            break;
-        case 0x64:
-            HL = LD_Nn_Nn(HL, HL);
-            cyclesDelta = 1;
-            break;
-        case 0x65:
-            HL = LD_Nn_nN(HL, HL);
-            cyclesDelta = 1;
-            break;
-        case 0x66:
-            HL = LD_Nn_nN(HL, Memory::readByte(HL));
-            cyclesDelta = 2;
-            break;
-        case 0x68:
-            HL = LD_nN_Nn(HL, BC);
-            cyclesDelta = 1;
-            break;
-        case 0x69:
-            HL = LD_nN_nN(HL, BC);
-            cyclesDelta = 1;
-            break;
-        case 0x6A:
-            HL = LD_nN_Nn(HL, DE);
-            cyclesDelta = 1;
-            break;
-        case 0x6B:
-            HL = LD_nN_nN(HL, DE);
-            cyclesDelta = 1;
-            break;
-        case 0x6C:
-            HL = LD_nN_Nn(HL, HL);
-            cyclesDelta = 1;
-            break;
-        case 0x6D:
-            HL = LD_nN_nN(HL, HL);
-            cyclesDelta = 1;
-            break;
-        case 0x6E:
-            HL = LD_nN_nN(HL, Memory::readByte(HL));
-            cyclesDelta = 2;
-            break;
-        case 0x70:
-            Memory::writeByte(HL, BC >> 8);
-            cyclesDelta = 2;
-            break;
-        case 0x71:
-            Memory::writeByte(HL, BC & 0x00FF);
-            cyclesDelta = 2;
-            break;
-        case 0x72:
-            Memory::writeByte(HL, DE >> 8);
-            cyclesDelta = 2;
-            break;
-        case 0x73:
-            Memory::writeByte(HL, DE & 0x00FF);
-            cyclesDelta = 2;
-            break;
-        case 0x74:
-            Memory::writeByte(HL, HL >> 8);
-            cyclesDelta = 2;
-            break;
-        case 0x75:
-            Memory::writeByte(HL, HL & 0x00FF);
-            cyclesDelta = 2;
+template <uint8_t operation>
+inline void CPU::alu(const uint8_t n2) {
+    /**
+     * Perform an 8 bit arithmetic or logical operation on A
+     * @param operation: One of ALU_ADD, ALU_ADC, ALU_SUB, ALU_SBC, ALU_AND, ALU_XOR, ALU_OR, ALU_CP
+     * @param n2: The operand
+     */
+    const uint8_t n1 = AF >> 8;
+    uint8_t n, c;
+
+    switch (operation) {
+        case ALU_ADD:
+            n = n1 + n2;
+            AF = LD_Nn_n(AF, n);
+            FLAGS_ADD(n, n1, n2, 0);
+            break;
+        case ALU_ADC:
+            c = CARRY_F(AF_FLAGS) >> 4;
+            n = n1 + n2 + c;
+            AF = LD_Nn_n(AF, n);
+            FLAGS_ADD(n, n1, n2, c);
+            break;
+        case ALU_SUB:
+            n = n1 - n2;
+            AF = LD_Nn_n(AF, n);
+            FLAGS_SUB(n, n1, n2, 0);
+            break;
+        case ALU_SBC:
+            c = CARRY_F(AF_FLAGS) >> 4;
+            n = n1 - n2 - c;
+            AF = LD_Nn_n(AF, n);
+            FLAGS_SUB(n, n1, n2, c);
+            break;
+        case ALU_AND:
+            n = n1 & n2;
+            AF = LD_Nn_n(AF, n);
+            FLAGS_AND(n);
+            break;
+        case ALU_XOR:
+            n = n1 ^ n2;
+            AF = LD_Nn_n(AF, n);
+            FLAGS_OR(n);
+            break;
+        case ALU_OR:
+            n = n1 | n2;
+            AF = LD_Nn_n(AF, n);
+            FLAGS_OR(n);
             break;
-        case 0x36:
-            Memory::writeByte(HL, readOp());
-            cyclesDelta = 3;
+        default:
+            n = n1 - n2;
+            FLAGS_SUB(n, n1, n2, 0);
             break;
+    }
+}
 
-        // LD A,n
-        case 0x0A:
-            AF = LD_Nn_nN(AF, Memory::readByte(BC));
-            cyclesDelta = 2;
-            break;
-        case 0x1A:
-            AF = LD_Nn_nN(AF, Memory::readByte(DE));
-            cyclesDelta = 2;
-            break;
-        case 0xFA:
-            AF = LD_Nn_nN(AF, Memory::readByte(readNn()));
-            cyclesDelta = 4;
-            break;
-        case 0x3E:
-            AF = LD_Nn_nN(AF, readOp());
-            cyclesDelta = 2;
-            break;
+template <uint8_t operation>
+inline uint8_t CPU::shift(const uint8_t n) {
+    /**
+     * Rotate or shift an 8 bit operand and set the flags accordingly
+     * @param operation: One of SHIFT_RLC, SHIFT_RRC, SHIFT_RL, SHIFT_RR, SHIFT_SLA, SHIFT_SRA, SHIFT_SWAP, SHIFT_SRL
+     * @param n: The operand
+     * @return The result
+     */
+    uint8_t result, c;
 
-        // LD n,A
-        case 0x47:
-            BC = LD_Nn_Nn(BC, AF);
-            cyclesDelta = 1;
-            break;
-        case 0x4F:
-            BC = LD_nN_Nn(BC, AF);
-            cyclesDelta = 1;
-            break;
-        case 0x57:
-            DE = LD_Nn_Nn(DE, AF);
-            cyclesDelta = 1;
+    switch (operation) {
+        case SHIFT_RLC:
+            c = n >> 7;
+            result = (n << 1) | c;
             break;
-        case 0x5F:
-            DE = LD_nN_Nn(DE, AF);
-            cyclesDelta = 1;
+        case SHIFT_RRC:
+            c = n & 0x01;
+            result = (n >> 1) | (c << 7);
             break;
-        case 0x67:
-            HL = LD_Nn_Nn(HL, AF);
-            cyclesDelta = 1;
+        case SHIFT_RL:
+            c = n >> 7;
+            result = (n << 1) | (CARRY_F(AF_FLAGS) >> 4);
             break;
-        case 0x6F:
-            HL = LD_nN_Nn(HL, AF);
-            cyclesDelta = 1;
+        case SHIFT_RR:
+            c = n & 0x01;
+            result = (n >> 1) | (CARRY_F(AF_FLAGS) << 3);
             break;
-        case 0x02:
-            Memory::writeByte(BC, AF >> 8);
-            cyclesDelta = 2;
+        case SHIFT_SLA:
+            c = n >> 7;
+            result = n << 1;
             break;
-        case 0x12:
-            Memory::writeByte(DE, AF >> 8);
-            cyclesDelta = 2;
+        case SHIFT_SRA:
+            c = n & 0x01;
+            result = (n >> 1) | (n & 0x80);
             break;
-        case 0x77:
-            Memory::writeByte(HL, AF >> 8);
-            cyclesDelta = 2;
+        case SHIFT_SWAP:
+            c = 0;
+            result = (n >> 4) | (n << 4);
             break;
-        case 0xEA:
-            Memory::writeByte(readNn(), AF >> 8);
-            cyclesDelta = 4;
+        default:
+            c = n & 0x01;
+            result = n >> 1;
             break;
+    }
 
-        // LD A,(C)
-        case 0xF2:
-            AF = LD_Nn_n(AF, Memory::readByte(BC | 0xFF00));
-            cyclesDelta = 8;
-            break;
+    SET_FLAGS(ZERO_S(result) | (c << 4));
+    return result;
+}
 
-        // LD (C),A
-        case 0xE2:
-            Memory::writeByte(BC | 0xFF00, AF >> 8);
-            cyclesDelta = 8;
-            break;
+template <uint8_t code>
+bool CPU::opcode() {
+    /**
+     * Generic handler of the opcodes that work alike on all 8 bit operands
+     * The operand is encoded in bits 0-2 or 3-5 of the opcode, see readRegister.
+     * All other opcodes are specialized below, unused ones stop the CPU.
+     */
+    const uint8_t r = (code >> 3) & 0x07;
 
-        // LDH (n),A
-        case 0xE0:
-            Memory::writeByte(0xFF00 + readOp(), AF >> 8);
-            cyclesDelta = 3;
-            break;
+    if (code >= 0x40 && code < 0x80) {
+        // LD r1,r2
+        writeRegister<r>(readRegister<code & 0x07>());
+    } else if (code >= 0x80 && code < 0xC0) {
+        // ADD, ADC, SUB, SBC, AND, XOR, OR, CP r
+        alu<r>(readRegister<code & 0x07>());
+    } else if ((code & 0xC7) == 0xC6) {
+        // ADD, ADC, SUB, SBC, AND, XOR, OR, CP n
+        alu<r>(operandN());
+    } else if ((code & 0xC7) == 0x04) {
+        // INC r
+        const uint8_t n = readRegister<r>() + 1;
+        writeRegister<r>(n);
+        SET_FLAGS(incFlags[n] | CARRY_F(AF_FLAGS));
+    } else if ((code & 0xC7) == 0x05) {
+        // DEC r
+        const uint8_t n = readRegister<r>() - 1;
+        writeRegister<r>(n);
+        SET_FLAGS(decFlags[n] | CARRY_F(AF_FLAGS));
+    } else if ((code & 0xC7) == 0x06) {
+        // LD r,n
+        writeRegister<r>(operandN());
+    } else {
+        Serial.printf("%02x NOT IMPLEMENTED (at %04x)\n\n", code, PC - 1);
+        stopAndRestart();
+    }
+    return false;
+}
 
-        // LDH A,(n)
-        case 0xF0:
-            AF = LD_Nn_n(AF, Memory::readByte(0xFF00 + readOp()));
-            cyclesDelta = 3;
-            break;
+// NOP
+// No Operation
+template <>
+bool CPU::opcode<0x00>() {
+    return false;
+}
 
-        // LDD A,(HL)
-        case 0x3A:
-            AF = LD_Nn_n(AF, Memory::readByte(HL));
-            HL--;
-            cyclesDelta = 2;
-            break;
+// STOP
+// Halt the CPU until button pressed
+// TODO: implement correctly
+template <>
+bool CPU::opcode<0x10>() {
+    return false;
+}
 
-        // LDD (HL),A
-        case 0x32:
-            Memory::writeByte(HL, AF >> 8);
-            HL--;
-            cyclesDelta = 2;
-            break;
+// HALT
+// Halt the CPU
+template <>
+bool CPU::opcode<0x76>() {
+    halted = 1;
+    return false;
+}
 
-        // LDI (HL),A
-        case 0x22:
-            Memory::writeByte(HL, AF >> 8);
-            HL++;
-            cyclesDelta = 2;
-            break;
+// LD A,n
+template <>
+bool CPU::opcode<0x0A>() {
+    AF = LD_Nn_nN(AF, Memory::readByte(BC));
+    return false;
+}
 
-        // LDI A,(HL)
-        case 0x2A:
-            AF = LD_Nn_n(AF, Memory::readByte(HL));
-            HL++;
-            cyclesDelta = 2;
-            break;
+template <>
+bool CPU::opcode<0x1A>() {
+    AF = LD_Nn_nN(AF, Memory::readByte(DE));
+    return false;
+}
 
-        // LD n,nn
-        case 0x01:
-            BC = readNn();
-            cyclesDelta = 3;
-            break;
-        case 0x11:
-            DE = readNn();
-            cyclesDelta = 3;
-            break;
-        case 0x21:
-            HL = readNn();
-            cyclesDelta = 3;
-            break;
-        case 0x31:
-            SP = readNn();
-            cyclesDelta = 3;
-            break;
+template <>
+bool CPU::opcode<0xFA>() {
+    AF = LD_Nn_nN(AF, Memory::readByte(operandNn()));
+    return false;
+}
 
-        // LD SP,HL
-        case 0xF9:
-            SP = HL;
-            cyclesDelta = 2;
-            break;
+// LD n,A
+template <>
+bool CPU::opcode<0x02>() {
+    Memory::writeByte(BC, AF >> 8);
+    return false;
+}
 
-        // LDHL SP,n
-        case 0xF8:
-            sn = (int8_t)readOp();
-            HL = SP + sn;
-            AF = LD_nN_n(AF, HALF_S(SP, sn) | CARRY_S(HL & 0xFF, SP & 0xFF, sn));
-            cyclesDelta = 3;
-            break;
+template <>
+bool CPU::opcode<0x12>() {
+    Memory::writeByte(DE, AF >> 8);
+    return false;
+}
 
-        // LD (nn),SP
-        case 0x08:
-            nn = readNn();
-            Memory::writeByte(nn, SP & 0xFF);
-            Memory::writeByte(nn + 1, SP >> 8);
-            cyclesDelta = 5;
-            break;
+template <>
+bool CPU::opcode<0xEA>() {
+    Memory::writeByte(operandNn(), AF >> 8);
+    return false;
+}
 
-        // PUSH nn
-        case 0xF5:
-            pushStack(AF);
-            cyclesDelta = 4;
-            break;
-        case 0xC5:
-            pushStack(BC);
-            cyclesDelta = 4;
-            break;
-        case 0xD5:
-            pushStack(DE);
-            cyclesDelta = 4;
-            break;
-        case 0xE5:
-            pushStack(HL);
-            cyclesDelta = 4;
-            break;
+// LD A,(C)
+template <>
+bool CPU::opcode<0xF2>() {
+    AF = LD_Nn_n(AF, Memory::readByte(BC | 0xFF00));
+    return false;
+}
 
-        // POP nn
-        case 0xF1:
-            AF = popStack() & 0xFFF0;
-            cyclesDelta = 3;
-            break;
-        case 0xC1:
-            BC = popStack();
-            cyclesDelta = 3;
-            break;
-        case 0xD1:
-            DE = popStack();
-            cyclesDelta = 3;
-            break;
-        case 0xE1:
-            HL = popStack();
-            cyclesDelta = 3;
-            break;
+// LD (C),A
+template <>
+bool CPU::opcode<0xE2>() {
+    Memory::writeByte(BC | 0xFF00, AF >> 8);
+    return false;
+}
 
-        // ADD A,n
-        case 0x87:
-            n1 = AF >> 8;
-            n2 = AF >> 8;
-            AF = LD_Nn_n(AF, n1 + n2);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_S(n1, n2) | CARRY_S(n, n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0x80:
-            n1 = AF >> 8;
-            n2 = BC >> 8;
-            AF = LD_Nn_n(AF, n1 + n2);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_S(n1, n2) | CARRY_S(n, n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0x81:
-            n1 = AF >> 8;
-            n2 = BC & 0x00FF;
-            AF = LD_Nn_n(AF, n1 + n2);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_S(n1, n2) | CARRY_S(n, n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0x82:
-            n1 = AF >> 8;
-            n2 = DE >> 8;
-            AF = LD_Nn_n(AF, n1 + n2);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_S(n1, n2) | CARRY_S(n, n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0x83:
-            n1 = AF >> 8;
-            n2 = DE & 0x00FF;
-            AF = LD_Nn_n(AF, n1 + n2);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_S(n1, n2) | CARRY_S(n, n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0x84:
-            n1 = AF >> 8;
-            n2 = HL >> 8;
-            AF = LD_Nn_n(AF, n1 + n2);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_S(n1, n2) | CARRY_S(n, n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0x85:
-            n1 = AF >> 8;
-            n2 = HL & 0x00FF;
-            AF = LD_Nn_n(AF, n1 + n2);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_S(n1, n2) | CARRY_S(n, n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0x86:
-            n1 = AF >> 8;
-            n2 = Memory::readByte(HL);
-            AF = LD_Nn_n(AF, n1 + n2);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_S(n1, n2) | CARRY_S(n, n1, n2));
-            cyclesDelta = 2;
-            break;
-        case 0xC6:
-            n1 = AF >> 8;
-            n2 = readOp();
-            AF = LD_Nn_n(AF, n1 + n2);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_S(n1, n2) | CARRY_S(n, n1, n2));
-            cyclesDelta = 2;
-            break;
+// LDH (n),A
+template <>
+bool CPU::opcode<0xE0>() {
+    Memory::writeByte(0xFF00 + operandN(), AF >> 8);
+    return false;
+}
 
-        // ADC A,n
-        case 0x8F:
-            n1 = AF >> 8;
-            n2 = AF >> 8;
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 + n2 + c);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_Sc(n1, n2, c) | CARRY_Sc(n, n1, n2, c));
-            cyclesDelta = 1;
-            break;
-        case 0x88:
-            n1 = AF >> 8;
-            n2 = BC >> 8;
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 + n2 + c);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_Sc(n1, n2, c) | CARRY_Sc(n, n1, n2, c));
-            cyclesDelta = 1;
-            break;
-        case 0x89:
-            n1 = AF >> 8;
-            n2 = BC & 0x00FF;
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 + n2 + c);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_Sc(n1, n2, c) | CARRY_Sc(n, n1, n2, c));
-            cyclesDelta = 1;
-            break;
-        case 0x8A:
-            n1 = AF >> 8;
-            n2 = DE >> 8;
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 + n2 + c);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_Sc(n1, n2, c) | CARRY_Sc(n, n1, n2, c));
-            cyclesDelta = 1;
-            break;
-        case 0x8B:
-            n1 = AF >> 8;
-            n2 = DE & 0x00FF;
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 + n2 + c);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_Sc(n1, n2, c) | CARRY_Sc(n, n1, n2, c));
-            cyclesDelta = 1;
-            break;
-        case 0x8C:
-            n1 = AF >> 8;
-            n2 = HL >> 8;
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 + n2 + c);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_Sc(n1, n2, c) | CARRY_Sc(n, n1, n2, c));
-            cyclesDelta = 1;
-            break;
-        case 0x8D:
-            n1 = AF >> 8;
-            n2 = HL & 0x00FF;
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 + n2 + c);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_Sc(n1, n2, c) | CARRY_Sc(n, n1, n2, c));
-            cyclesDelta = 1;
-            break;
-        case 0x8E:
-            n1 = AF >> 8;
-            n2 = Memory::readByte(HL);
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 + n2 + c);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_Sc(n1, n2, c) | CARRY_Sc(n, n1, n2, c));
-            cyclesDelta = 2;
-            break;
-        case 0xCE:
-            n1 = AF >> 8;
-            n2 = readOp();
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 + n2 + c);
-            n = AF >> 8;
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_Sc(n1, n2, c) | CARRY_Sc(n, n1, n2, c));
-            cyclesDelta = 2;
-            break;
+// LDH A,(n)
+template <>
+bool CPU::opcode<0xF0>() {
+    AF = LD_Nn_n(AF, Memory::readByte(0xFF00 + operandN()));
+    return false;
+}
 
-        // SUB n
-        case 0x97:
-            n1 = AF >> 8;
-            n2 = AF >> 8;
-            AF = LD_Nn_n(AF, n1 - n2);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0x90:
-            n1 = AF >> 8;
-            n2 = BC >> 8;
-            AF = LD_Nn_n(AF, n1 - n2);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0x91:
-            n1 = AF >> 8;
-            n2 = BC & 0x00FF;
-            AF = LD_Nn_n(AF, n1 - n2);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0x92:
-            n1 = AF >> 8;
-            n2 = DE >> 8;
-            AF = LD_Nn_n(AF, n1 - n2);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0x93:
-            n1 = AF >> 8;
-            n2 = DE & 0x00FF;
-            AF = LD_Nn_n(AF, n1 - n2);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0x94:
-            n1 = AF >> 8;
-            n2 = HL >> 8;
-            AF = LD_Nn_n(AF, n1 - n2);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0x95:
-            n1 = AF >> 8;
-            n2 = HL & 0x00FF;
-            AF = LD_Nn_n(AF, n1 - n2);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0x96:
-            n1 = AF >> 8;
-            n2 = Memory::readByte(HL);
-            AF = LD_Nn_n(AF, n1 - n2);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 2;
-            break;
-        case 0xD6:
-            n1 = AF >> 8;
-            n2 = readOp();
-            AF = LD_Nn_n(AF, n1 - n2);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 2;
-            break;
+// LDD A,(HL)
+template <>
+bool CPU::opcode<0x3A>() {
+    AF = LD_Nn_n(AF, Memory::readByte(HL));
+    HL--;
+    return false;
+}
 
-        // SBC n
-        case 0x9F:
-            n1 = AF >> 8;
-            n2 = AF >> 8;
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 - n2 - c);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_Sc(n1, n2, c) | BORROW_Sc(n1, n2, c));
-            cyclesDelta = 1;
-            break;
-        case 0x98:
-            n1 = AF >> 8;
-            n2 = BC >> 8;
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 - n2 - c);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_Sc(n1, n2, c) | BORROW_Sc(n1, n2, c));
-            cyclesDelta = 1;
-            break;
-        case 0x99:
-            n1 = AF >> 8;
-            n2 = BC & 0x00FF;
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 - n2 - c);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_Sc(n1, n2, c) | BORROW_Sc(n1, n2, c));
-            cyclesDelta = 1;
-            break;
-        case 0x9A:
-            n1 = AF >> 8;
-            n2 = DE >> 8;
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 - n2 - c);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_Sc(n1, n2, c) | BORROW_Sc(n1, n2, c));
-            cyclesDelta = 1;
-            break;
-        case 0x9B:
-            n1 = AF >> 8;
-            n2 = DE & 0x00FF;
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 - n2 - c);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_Sc(n1, n2, c) | BORROW_Sc(n1, n2, c));
-            cyclesDelta = 1;
-            break;
-        case 0x9C:
-            n1 = AF >> 8;
-            n2 = HL >> 8;
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 - n2 - c);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_Sc(n1, n2, c) | BORROW_Sc(n1, n2, c));
-            cyclesDelta = 1;
-            break;
-        case 0x9D:
-            n1 = AF >> 8;
-            n2 = HL & 0x00FF;
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 - n2 - c);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_Sc(n1, n2, c) | BORROW_Sc(n1, n2, c));
-            cyclesDelta = 1;
-            break;
-        case 0x9E:
-            n1 = AF >> 8;
-            n2 = Memory::readByte(HL);
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 - n2 - c);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_Sc(n1, n2, c) | BORROW_Sc(n1, n2, c));
-            cyclesDelta = 2;
-            break;
-        case 0xDE:
-            n1 = AF >> 8;
-            n2 = readOp();
-            c = CARRY_F(AF) >> 4;
-            AF = LD_Nn_n(AF, n1 - n2 - c);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | HBORROW_Sc(n1, n2, c) | BORROW_Sc(n1, n2, c));
-            cyclesDelta = 2;
-            break;
+// LDD (HL),A
+template <>
+bool CPU::opcode<0x32>() {
+    Memory::writeByte(HL, AF >> 8);
+    HL--;
+    return false;
+}
 
-        // AND n
-        case 0xA7:
-            AF = LD_Nn_n(AF, AND_Nn_Nn(AF, AF));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_V);
-            cyclesDelta = 1;
-            break;
-        case 0xA0:
-            AF = LD_Nn_n(AF, AND_Nn_Nn(AF, BC));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_V);
-            cyclesDelta = 1;
-            break;
-        case 0xA1:
-            AF = LD_Nn_n(AF, AND_Nn_nN(AF, BC));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_V);
-            cyclesDelta = 1;
-            break;
-        case 0xA2:
-            AF = LD_Nn_n(AF, AND_Nn_Nn(AF, DE));
-            AF = (((DE >> 8) & (AF >> 8)) << 8) | (AF & 0x00FF);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_V);
-            cyclesDelta = 1;
-            break;
-        case 0xA3:
-            AF = LD_Nn_n(AF, AND_Nn_nN(AF, DE));
-            AF = (((DE & 0x00FF) & (AF >> 8)) << 8) | (AF & 0x00FF);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_V);
-            cyclesDelta = 1;
-            break;
-        case 0xA4:
-            AF = LD_Nn_n(AF, AND_Nn_Nn(AF, HL));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_V);
-            cyclesDelta = 1;
-            break;
-        case 0xA5:
-            AF = LD_Nn_n(AF, AND_Nn_nN(AF, HL));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_V);
-            cyclesDelta = 1;
-            break;
-        case 0xA6:
-            AF = LD_Nn_n(AF, AND_Nn_nN(AF, Memory::readByte(HL)));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_V);
-            cyclesDelta = 2;
-            break;
-        case 0xE6:
-            AF = LD_Nn_n(AF, AND_Nn_nN(AF, readOp()));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | HALF_V);
-            cyclesDelta = 2;
-            break;
+// LDI (HL),A
+template <>
+bool CPU::opcode<0x22>() {
+    Memory::writeByte(HL, AF >> 8);
+    HL++;
+    return false;
+}
 
-        // OR n
-        case 0xB7:
-            AF = LD_Nn_n(AF, OR_Nn_Nn(AF, AF));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 1;
-            break;
-        case 0xB0:
-            AF = LD_Nn_n(AF, OR_Nn_Nn(AF, BC));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 1;
-            break;
-        case 0xB1:
-            AF = LD_Nn_n(AF, OR_Nn_nN(AF, BC));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 1;
-            break;
-        case 0xB2:
-            AF = LD_Nn_n(AF, OR_Nn_Nn(AF, DE));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 1;
-            break;
-        case 0xB3:
-            AF = LD_Nn_n(AF, OR_Nn_nN(AF, DE));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 1;
-            break;
-        case 0xB4:
-            AF = LD_Nn_n(AF, OR_Nn_Nn(AF, HL));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 1;
-            break;
-        case 0xB5:
-            AF = LD_Nn_n(AF, OR_Nn_nN(AF, HL));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 1;
-            break;
-        case 0xB6:
-            AF = LD_Nn_n(AF, OR_Nn_nN(AF, Memory::readByte(HL)));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 2;
-            break;
-        case 0xF6:
-            AF = LD_Nn_n(AF, OR_Nn_nN(AF, readOp()));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 2;
-            break;
+// LDI A,(HL)
+template <>
+bool CPU::opcode<0x2A>() {
+    AF = LD_Nn_n(AF, Memory::readByte(HL));
+    HL++;
+    return false;
+}
 
-        // XOR n
-        case 0xAF:
-            AF = LD_Nn_n(AF, XOR_Nn_Nn(AF, AF));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 1;
-            break;
-        case 0xA8:
-            AF = LD_Nn_n(AF, XOR_Nn_Nn(AF, BC));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 1;
-            break;
-        case 0xA9:
-            AF = LD_Nn_n(AF, XOR_Nn_nN(AF, BC));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 1;
-            break;
-        case 0xAA:
-            AF = LD_Nn_n(AF, XOR_Nn_Nn(AF, DE));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 1;
-            break;
-        case 0xAB:
-            AF = LD_Nn_n(AF, XOR_Nn_nN(AF, DE));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 1;
-            break;
-        case 0xAC:
-            AF = LD_Nn_n(AF, XOR_Nn_Nn(AF, HL));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 1;
-            break;
-        case 0xAD:
-            AF = LD_Nn_n(AF, XOR_Nn_nN(AF, HL));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 1;
-            break;
-        case 0xAE:
-            AF = LD_Nn_n(AF, XOR_Nn_nN(AF, Memory::readByte(HL)));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 2;
-            break;
-        case 0xEE:
-            AF = LD_Nn_n(AF, XOR_Nn_nN(AF, readOp()));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-            cyclesDelta = 2;
-            break;
+// LD n,nn
+template <>
+bool CPU::opcode<0x01>() {
+    BC = operandNn();
+    return false;
+}
 
-        // CP n
-        case 0xBF:
-            n1 = AF >> 8;
-            n2 = AF >> 8;
-            n = n1 - n2;
-            AF = LD_nN_n(AF, ZERO_S(n) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0xB8:
-            n1 = AF >> 8;
-            n2 = BC >> 8;
-            n = n1 - n2;
-            AF = LD_nN_n(AF, ZERO_S(n) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0xB9:
-            n1 = AF >> 8;
-            n2 = BC & 0x00FF;
-            n = n1 - n2;
-            AF = LD_nN_n(AF, ZERO_S(n) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0xBA:
-            n1 = AF >> 8;
-            n2 = DE >> 8;
-            n = n1 - n2;
-            AF = LD_nN_n(AF, ZERO_S(n) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0xBB:
-            n1 = AF >> 8;
-            n2 = DE & 0x00FF;
-            n = n1 - n2;
-            AF = LD_nN_n(AF, ZERO_S(n) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0xBC:
-            n1 = AF >> 8;
-            n2 = HL >> 8;
-            n = n1 - n2;
-            AF = LD_nN_n(AF, ZERO_S(n) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0xBD:
-            n1 = AF >> 8;
-            n2 = HL & 0x00FF;
-            n = n1 - n2;
-            AF = LD_nN_n(AF, ZERO_S(n) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 1;
-            break;
-        case 0xBE:
-            n1 = AF >> 8;
-            n2 = Memory::readByte(HL);
-            n = n1 - n2;
-            AF = LD_nN_n(AF, ZERO_S(n) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 2;
-            break;
-        case 0xFE:
-            n1 = AF >> 8;
-            n2 = readOp();
-            n = n1 - n2;
-            AF = LD_nN_n(AF, ZERO_S(n) | SUB_V | HBORROW_S(n1, n2) | BORROW_S(n1, n2));
-            cyclesDelta = 2;
-            break;
+template <>
+bool CPU::opcode<0x11>() {
+    DE = operandNn();
+    return false;
+}
 
-        // INC n
-        case 0x3C:
-            AF = LD_Nn_Nn(AF, AF + 0x100);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | (((AF & 0x0F00) == 0) << 5) | CARRY_F(AF));
-            cyclesDelta = 1;
-            break;
-        case 0x04:
-            BC = LD_Nn_Nn(BC, BC + 0x100);
-            AF = LD_nN_n(AF, ZERO_S(BC & 0xFF00) | (((BC & 0x0F00) == 0) << 5) | CARRY_F(AF));
-            cyclesDelta = 1;
-            break;
-        case 0x0C:
-            BC = LD_nN_nN(BC, BC + 1);
-            AF = LD_nN_n(AF, ZERO_S(BC & 0x00FF) | (((BC & 0x000F) == 0) << 5) | CARRY_F(AF));
-            cyclesDelta = 1;
-            break;
-        case 0x14:
-            DE = LD_Nn_Nn(DE, DE + 0x100);
-            AF = LD_nN_n(AF, ZERO_S(DE & 0xFF00) | (((DE & 0x0F00) == 0) << 5) | CARRY_F(AF));
-            cyclesDelta = 1;
-            break;
-        case 0x1C:
-            DE = LD_nN_nN(DE, DE + 1);
-            AF = LD_nN_n(AF, ZERO_S(DE & 0x00FF) | (((DE & 0x000F) == 0) << 5) | CARRY_F(AF));
-            cyclesDelta = 1;
-            break;
-        case 0x24:
-            HL = LD_Nn_Nn(HL, HL + 0x100);
-            AF = LD_nN_n(AF, ZERO_S(HL & 0xFF00) | (((HL & 0x0F00) == 0) << 5) | CARRY_F(AF));
-            cyclesDelta = 1;
-            break;
-        case 0x2C:
-            HL = LD_nN_nN(HL, HL + 1);
-            AF = LD_nN_n(AF, ZERO_S(HL & 0x00FF) | (((HL & 0x000F) == 0) << 5) | CARRY_F(AF));
-            cyclesDelta = 1;
-            break;
-        case 0x34:
-            Memory::writeByte(HL, Memory::readByte(HL) + 1);
-            AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL)) | (((Memory::readByte(HL) & 0x0F) == 0) << 5) | CARRY_F(AF));
-            cyclesDelta = 3;
-            break;
+template <>
+bool CPU::opcode<0x21>() {
+    HL = operandNn();
+    return false;
+}
 
-        // DEC n
-        case 0x3D:
-            AF = LD_Nn_Nn(AF, AF - 0x100);
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_V | (((AF & 0x0F00) == 0x0F00) << 5)) | CARRY_F(AF);
-            cyclesDelta = 1;
-            break;
-        case 0x05:
-            BC = LD_Nn_Nn(BC, BC - 0x100);
-            AF = LD_nN_n(AF, ZERO_S(BC & 0xFF00) | SUB_V | (((BC & 0x0F00) == 0x0F00) << 5) | CARRY_F(AF));
-            cyclesDelta = 1;
-            break;
-        case 0x0D:
-            BC = LD_nN_nN(BC, BC - 1);
-            AF = LD_nN_n(AF, ZERO_S(BC & 0x00FF) | SUB_V | (((BC & 0x000F) == 0x000F) << 5) | CARRY_F(AF));
-            cyclesDelta = 1;
-            break;
-        case 0x15:
-            DE = LD_Nn_Nn(DE, DE - 0x100);
-            AF = LD_nN_n(AF, ZERO_S(DE & 0xFF00) | SUB_V | (((DE & 0x0F00) == 0x0F00) << 5) | CARRY_F(AF));
-            cyclesDelta = 1;
-            break;
-        case 0x1D:
-            DE = LD_nN_nN(DE, DE - 1);
-            AF = LD_nN_n(AF, ZERO_S(DE & 0x00FF) | SUB_V | (((DE & 0x000F) == 0x000F) << 5) | CARRY_F(AF));
-            cyclesDelta = 1;
-            break;
-        case 0x25:
-            HL = LD_Nn_Nn(HL, HL - 0x100);
-            AF = LD_nN_n(AF, ZERO_S(HL & 0xFF00) | SUB_V | (((HL & 0x0F00) == 0x0F00) << 5) | CARRY_F(AF));
-            cyclesDelta = 1;
-            break;
-        case 0x2D:
-            HL = LD_nN_nN(HL, HL - 1);
-            AF = LD_nN_n(AF, ZERO_S(HL & 0x00FF) | SUB_V | (((HL & 0x000F) == 0x000F) << 5) | CARRY_F(AF));
-            cyclesDelta = 1;
-            break;
-        case 0x35:
-            Memory::writeByte(HL, Memory::readByte(HL) - 1);
-            AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL)) | SUB_V | (((Memory::readByte(HL) & 0x0F) == 0x0F) << 5) | CARRY_F(AF));
-            cyclesDelta = 3;
-            break;
+template <>
+bool CPU::opcode<0x31>() {
+    SP = operandNn();
+    return false;
+}
 
-        // ADD HL,n
-        case 0x09:
-            nn1 = HL;
-            nn2 = BC;
-            HL = nn1 + nn2;
-            AF = LD_nN_n(AF, ZERO_F(AF) | HALF_Snn(nn1, nn2) | CARRY_S(HL, nn1, nn2));
-            cyclesDelta = 2;
-            break;
-        case 0x19:
-            nn1 = HL;
-            nn2 = DE;
-            HL = nn1 + nn2;
-            AF = LD_nN_n(AF, ZERO_F(AF) | HALF_Snn(nn1, nn2) | CARRY_S(HL, nn1, nn2));
-            cyclesDelta = 2;
-            break;
-        case 0x29:
-            nn1 = HL;
-            nn2 = HL;
-            HL = nn1 + nn2;
-            AF = LD_nN_n(AF, ZERO_F(AF) | HALF_Snn(nn1, nn2) | CARRY_S(HL, nn1, nn2));
-            cyclesDelta = 2;
-            break;
-        case 0x39:
-            nn1 = HL;
-            nn2 = SP;
-            HL = nn1 + nn2;
-            AF = LD_nN_n(AF, ZERO_F(AF) | HALF_Snn(nn1, nn2) | CARRY_S(HL, nn1, nn2));
-            cyclesDelta = 2;
-            break;
+// LD SP,HL
+template <>
+bool CPU::opcode<0xF9>() {
+    SP = HL;
+    return false;
+}
 
-        // ADD SP,n
-        case 0xE8:
-            nn = SP;
-            sn = (int8_t)readOp();
-            SP = nn + sn;
-            AF = LD_nN_n(AF, HALF_S(nn, sn) | CARRY_S(SP & 0xFF, nn & 0xFF, sn));
-            cyclesDelta = 4;
-            break;
+// LDHL SP,n
+template <>
+bool CPU::opcode<0xF8>() {
+    int8_t sn;
+    sn = (int8_t)operandN();
+    HL = SP + sn;
+    SET_FLAGS(HALF_S(SP, sn) | CARRY_S(HL & 0xFF, SP & 0xFF, sn));
+    return false;
+}
 
-        // INC nn
-        case 0x03:
-            BC++;
-            cyclesDelta = 2;
-            break;
-        case 0x13:
-            DE++;
-            cyclesDelta = 2;
-            break;
-        case 0x23:
-            HL++;
-            cyclesDelta = 2;
-            break;
-        case 0x33:
-            SP++;
-            cyclesDelta = 2;
-            break;
+// LD (nn),SP
+template <>
+bool CPU::opcode<0x08>() {
+    uint16_t nn;
+    nn = operandNn();
+    Memory::writeByte(nn, SP & 0xFF);
+    Memory::writeByte(nn + 1, SP >> 8);
+    return false;
+}
 
-        // DEC nn
-        case 0x0B:
-            BC--;
-            cyclesDelta = 2;
-            break;
-        case 0x1B:
-            DE--;
-            cyclesDelta = 2;
-            break;
-        case 0x2B:
-            HL--;
-            cyclesDelta = 2;
-            break;
-        case 0x3B:
-            SP--;
-            cyclesDelta = 2;
-            break;
+// PUSH nn
+template <>
+bool CPU::opcode<0xF5>() {
+    pushStack(AF_FLAGS);
+    return false;
+}
 
-        // RLCA
-        case 0x07:
-            c = (AF >> 15) & 0x01;
-            AF = LD_Nn_Nn(AF, ((AF & 0xFF00) << 1) | (c << 8));
-            AF = LD_nN_n(AF, c << 4);
-            cyclesDelta = 1;
-            break;
+template <>
+bool CPU::opcode<0xC5>() {
+    pushStack(BC);
+    return false;
+}
 
-        // RLA
-        case 0x17:
-            c = (AF >> 15) & 0x01;
-            AF = LD_Nn_Nn(AF, ((AF & 0xFF00) << 1) | (CARRY_F(AF) << 4));
-            AF = LD_nN_n(AF, c << 4);
-            cyclesDelta = 1;
-            break;
+template <>
+bool CPU::opcode<0xD5>() {
+    pushStack(DE);
+    return false;
+}
 
-        // RRCA
-        case 0x0F:
-            c = (AF >> 8) & 0x01;
-            AF = LD_Nn_Nn(AF, (AF >> 1) | (c << 15));
-            AF = LD_nN_n(AF, c << 4);
-            cyclesDelta = 1;
-            break;
+template <>
+bool CPU::opcode<0xE5>() {
+    pushStack(HL);
+    return false;
+}
 
-        // RRA
-        case 0x1F:
-            c = (AF >> 8) & 0x01;
-            AF = LD_Nn_Nn(AF, (AF >> 1) | (CARRY_F(AF) << 11));
-            AF = LD_nN_n(AF, c << 4);
-            cyclesDelta = 1;
-            break;
+// POP nn
+template <>
+bool CPU::opcode<0xF1>() {
+    AF = popStack();
+    SET_FLAGS(AF & 0xF0);
+    return false;
+}
 
-        // Multiple OP codes depending on n
-        case 0xCB:
-            n = readOp();
-            switch (n) {
-                // RLC c
-                case 0x07:
-                    c = (AF >> 15) & 0x01;
-                    AF = LD_Nn_Nn(AF, ((AF & 0xFF00) << 1) | (c << 8));
-                    AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x00:
-                    c = (BC >> 15) & 0x01;
-                    BC = LD_Nn_Nn(BC, ((BC & 0xFF00) << 1) | (c << 8));
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x01:
-                    c = (BC >> 7) & 0x01;
-                    BC = LD_nN_nN(BC, (BC << 1) | c);
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x02:
-                    c = (DE >> 15) & 0x01;
-                    DE = LD_Nn_Nn(DE, ((DE & 0xFF00) << 1) | (c << 8));
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x03:
-                    c = (DE >> 7) & 0x01;
-                    DE = LD_nN_nN(DE, (DE << 1) | c);
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x04:
-                    c = (HL >> 15) & 0x01;
-                    HL = LD_Nn_Nn(HL, ((HL & 0xFF00) << 1) | (c << 8));
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x05:
-                    c = (HL >> 7) & 0x01;
-                    HL = LD_nN_nN(HL, (HL << 1) | c);
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x06:
-                    c = (Memory::readByte(HL) >> 7) & 0x01;
-                    Memory::writeByte(HL, (Memory::readByte(HL) << 1) | c);
-                    AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL)) | (c << 4));
-                    cyclesDelta = 4;
-                    break;
+template <>
+bool CPU::opcode<0xC1>() {
+    BC = popStack();
+    return false;
+}
 
-                // RL n
-                case 0x17:
-                    c = (AF >> 15) & 0x01;
-                    AF = LD_Nn_Nn(AF, ((AF & 0xFF00) << 1) | (CARRY_F(AF) << 4));
-                    AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x10:
-                    c = (BC >> 15) & 0x01;
-                    BC = LD_Nn_Nn(BC, ((BC & 0xFF00) << 1) | (CARRY_F(AF) << 4));
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x11:
-                    c = (BC >> 7) & 0x01;
-                    BC = LD_nN_nN(BC, (BC << 1) | (CARRY_F(AF) >> 4));
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x12:
-                    c = (DE >> 15) & 0x01;
-                    DE = LD_Nn_Nn(DE, ((DE & 0xFF00) << 1) | (CARRY_F(AF) << 4));
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x13:
-                    c = (DE >> 7) & 0x01;
-                    DE = LD_nN_nN(DE, (DE << 1) | (CARRY_F(AF) >> 4));
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x14:
-                    c = (HL >> 15) & 0x01;
-                    HL = LD_Nn_Nn(HL, ((HL & 0xFF00) << 1) | (CARRY_F(AF) << 4));
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x15:
-                    c = (HL >> 7) & 0x01;
-                    HL = LD_nN_nN(HL, (HL << 1) | (CARRY_F(AF) >> 4));
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x16:
-                    c = (Memory::readByte(HL) >> 7) & 0x01;
-                    Memory::writeByte(HL, (Memory::readByte(HL) << 1) | (CARRY_F(AF) >> 4));
-                    AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL)) | (c << 4));
-                    cyclesDelta = 4;
-                    break;
+template <>
+bool CPU::opcode<0xD1>() {
+    DE = popStack();
+    return false;
+}
 
-                // RRC n
-                case 0x0F:
-                    c = (AF >> 8) & 0x01;
-                    AF = LD_Nn_Nn(AF, (AF >> 1) | (c << 15));
-                    AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x08:
-                    c = (BC >> 8) & 0x01;
-                    BC = LD_Nn_Nn(BC, (BC >> 1) | (c << 15));
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x09:
-                    c = BC & 0x01;
-                    BC = LD_nN_nN(BC, ((BC & 0x00FF) >> 1) | (c << 7));
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x0A:
-                    c = (DE >> 8) & 0x01;
-                    DE = LD_Nn_Nn(DE, (DE >> 1) | (c << 15));
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x0B:
-                    c = DE & 0x01;
-                    DE = LD_nN_nN(DE, ((DE & 0x00FF) >> 1) | (c << 7));
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x0C:
-                    c = (HL >> 8) & 0x01;
-                    HL = LD_Nn_Nn(HL, (HL >> 1) | (c << 15));
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x0D:
-                    c = HL & 0x01;
-                    HL = LD_nN_nN(HL, ((HL & 0x00FF) >> 1) | (c << 7));
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x0E:
-                    c = Memory::readByte(HL) & 0x01;
-                    Memory::writeByte(HL, (Memory::readByte(HL) >> 1) | (c << 7));
-                    AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL)) | (c << 4));
-                    cyclesDelta = 4;
-                    break;
+template <>
+bool CPU::opcode<0xE1>() {
+    HL = popStack();
+    return false;
+}
 
-                // RR n
-                case 0x1F:
-                    c = (AF >> 8) & 0x01;
-                    AF = LD_Nn_Nn(AF, (AF >> 1) | (CARRY_F(AF) << 11));
-                    AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x18:
-                    c = (BC >> 8) & 0x01;
-                    BC = LD_Nn_Nn(BC, (BC >> 1) | (CARRY_F(AF) << 11));
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x19:
-                    c = BC & 0x01;
-                    BC = LD_nN_nN(BC, ((BC & 0x00FF) >> 1) | (CARRY_F(AF) << 3));
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x1A:
-                    c = (DE >> 8) & 0x01;
-                    DE = LD_Nn_Nn(DE, (DE >> 1) | (CARRY_F(AF) << 11));
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x1B:
-                    c = DE & 0x01;
-                    DE = LD_nN_nN(DE, ((DE & 0x00FF) >> 1) | (CARRY_F(AF) << 3));
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x1C:
-                    c = (HL >> 8) & 0x01;
-                    HL = LD_Nn_Nn(HL, (HL >> 1) | (CARRY_F(AF) << 11));
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x1D:
-                    c = HL & 0x01;
-                    HL = LD_nN_nN(HL, ((HL & 0x00FF) >> 1) | (CARRY_F(AF) << 3));
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x1E:
-                    c = Memory::readByte(HL) & 0x01;
-                    Memory::writeByte(HL, (Memory::readByte(HL) >> 1) | (CARRY_F(AF) << 3));
-                    AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL)) | (c << 4));
-                    cyclesDelta = 4;
-                    break;
+// ADD HL,n
+template <>
+bool CPU::opcode<0x09>() {
+    uint16_t nn1, nn2;
+    nn1 = HL;
+    nn2 = BC;
+    HL = nn1 + nn2;
+    SET_FLAGS(ZERO_F(AF_FLAGS) | HALF_Snn(nn1, nn2) | CARRY_S(HL, nn1, nn2));
+    return false;
+}
 
-                // SLA n
-                case 0x27:
-                    c = (AF >> 15) & 0x01;
-                    AF = LD_Nn_Nn(AF, (AF & 0xFF00) << 1);
-                    AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x20:
-                    c = (BC >> 15) & 0x01;
-                    BC = LD_Nn_Nn(BC, (BC & 0xFF00) << 1);
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x21:
-                    c = (BC >> 7) & 0x01;
-                    BC = LD_nN_nN(BC, BC << 1);
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x22:
-                    c = (DE >> 15) & 0x01;
-                    DE = LD_Nn_Nn(DE, (DE & 0xFF00) << 1);
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x23:
-                    c = (DE >> 7) & 0x01;
-                    DE = LD_nN_nN(DE, DE << 1);
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x24:
-                    c = (HL >> 15) & 0x01;
-                    HL = LD_Nn_Nn(HL, (HL & 0xFF00) << 1);
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x25:
-                    c = (HL >> 7) & 0x01;
-                    HL = LD_nN_nN(HL, HL << 1);
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x26:
-                    c = (Memory::readByte(HL) >> 7) & 0x01;
-                    Memory::writeByte(HL, Memory::readByte(HL) << 1);
-                    AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL)) | (c << 4));
-                    cyclesDelta = 4;
-                    break;
+template <>
+bool CPU::opcode<0x19>() {
+    uint16_t nn1, nn2;
+    nn1 = HL;
+    nn2 = DE;
+    HL = nn1 + nn2;
+    SET_FLAGS(ZERO_F(AF_FLAGS) | HALF_Snn(nn1, nn2) | CARRY_S(HL, nn1, nn2));
+    return false;
+}
 
-                // SRA n
-                case 0x2F:
-                    c = (AF >> 8) & 0x01;
-                    AF = LD_Nn_Nn(AF, (AF >> 1) | (AF & 0x8000));
-                    AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x28:
-                    c = (BC >> 8) & 0x01;
-                    BC = LD_Nn_Nn(BC, (BC >> 1) | (BC & 0x8000));
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x29:
-                    c = BC & 0x01;
-                    BC = LD_nN_nN(BC, ((BC & 0x00FF) >> 1) | (BC & 0x0080));
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x2A:
-                    c = (DE >> 8) & 0x01;
-                    DE = LD_Nn_Nn(DE, (DE >> 1) | (DE & 0x8000));
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x2B:
-                    c = DE & 0x01;
-                    DE = LD_nN_nN(DE, ((DE & 0x00FF) >> 1) | (DE & 0x0080));
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x2C:
-                    c = (HL >> 8) & 0x01;
-                    HL = LD_Nn_Nn(HL, (HL >> 1) | (HL & 0x8000));
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x2D:
-                    c = HL & 0x01;
-                    HL = LD_nN_nN(HL, ((HL & 0x00FF) >> 1) | (HL & 0x0080));
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x2E:
-                    c = Memory::readByte(HL) & 0x01;
-                    Memory::writeByte(HL, (Memory::readByte(HL) >> 1) | (Memory::readByte(HL) & 0x0080));
-                    AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL)) | (c << 4));
-                    cyclesDelta = 4;
-                    break;
+template <>
+bool CPU::opcode<0x29>() {
+    uint16_t nn1, nn2;
+    nn1 = HL;
+    nn2 = HL;
+    HL = nn1 + nn2;
+    SET_FLAGS(ZERO_F(AF_FLAGS) | HALF_Snn(nn1, nn2) | CARRY_S(HL, nn1, nn2));
+    return false;
+}
 
-                // SRL n
-                case 0x3F:
-                    c = (AF >> 8) & 0x01;
-                    AF = LD_Nn_Nn(AF, AF >> 1);
-                    AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x38:
-                    c = (BC >> 8) & 0x01;
-                    BC = LD_Nn_Nn(BC, BC >> 1);
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x39:
-                    c = BC & 0x01;
-                    BC = LD_nN_nN(BC, (BC & 0x00FF) >> 1);
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x3A:
-                    c = (DE >> 8) & 0x01;
-                    DE = LD_Nn_Nn(DE, DE >> 1);
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x3B:
-                    c = DE & 0x01;
-                    DE = LD_nN_nN(DE, (DE & 0x00FF) >> 1);
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x3C:
-                    c = (HL >> 8) & 0x01;
-                    HL = LD_Nn_Nn(HL, HL >> 1);
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0xFF00) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x3D:
-                    c = HL & 0x01;
-                    HL = LD_nN_nN(HL, (HL & 0x00FF) >> 1);
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x00FF) | (c << 4));
-                    cyclesDelta = 2;
-                    break;
-                case 0x3E:
-                    c = Memory::readByte(HL) & 0x01;
-                    Memory::writeByte(HL, Memory::readByte(HL) >> 1);
-                    AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL)) | (c << 4));
-                    cyclesDelta = 4;
-                    break;
+template <>
+bool CPU::opcode<0x39>() {
+    uint16_t nn1, nn2;
+    nn1 = HL;
+    nn2 = SP;
+    HL = nn1 + nn2;
+    SET_FLAGS(ZERO_F(AF_FLAGS) | HALF_Snn(nn1, nn2) | CARRY_S(HL, nn1, nn2));
+    return false;
+}
 
-                // BIT b,r
-                case 0x47:
-                    AF = LD_nN_n(AF, ZERO_S(AF & 0x0100) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x40:
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x0100) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x41:
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x0001) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x42:
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x0100) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x43:
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x0001) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x44:
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x0100) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x45:
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x0001) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x46:
-                    AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL) & 0x01) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 4;
-                    break;
-                case 0x4F:
-                    AF = LD_nN_n(AF, ZERO_S(AF & 0x0200) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x48:
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x0200) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x49:
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x0002) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x4A:
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x0200) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x4B:
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x0002) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x4C:
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x0200) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x4D:
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x0002) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x4E:
-                    AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL) & 0x02) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 4;
-                    break;
-                case 0x57:
-                    AF = LD_nN_n(AF, ZERO_S(AF & 0x0400) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x50:
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x0400) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x51:
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x0004) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x52:
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x0400) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x53:
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x0004) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x54:
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x0400) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x55:
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x0004) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x56:
-                    AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL) & 0x04) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 4;
-                    break;
-                case 0x5F:
-                    AF = LD_nN_n(AF, ZERO_S(AF & 0x0800) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x58:
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x0800) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x59:
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x0008) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x5A:
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x0800) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x5B:
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x0008) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x5C:
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x0800) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x5D:
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x0008) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x5E:
-                    AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL) & 0x08) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 4;
-                    break;
-                case 0x67:
-                    AF = LD_nN_n(AF, ZERO_S(AF & 0x1000) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x60:
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x1000) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x61:
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x0010) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x62:
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x1000) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x63:
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x0010) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x64:
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x1000) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x65:
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x0010) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x66:
-                    AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL) & 0x10) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 4;
-                    break;
-                case 0x6F:
-                    AF = LD_nN_n(AF, ZERO_S(AF & 0x2000) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x68:
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x2000) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x69:
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x0020) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x6A:
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x2000) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x6B:
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x0020) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x6C:
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x2000) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x6D:
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x0020) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x6E:
-                    AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL) & 0x20) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 4;
-                    break;
-                case 0x77:
-                    AF = LD_nN_n(AF, ZERO_S(AF & 0x4000) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x70:
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x4000) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x71:
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x0040) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x72:
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x4000) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x73:
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x0040) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x74:
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x4000) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x75:
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x0040) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x76:
-                    AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL) & 0x40) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 4;
-                    break;
-                case 0x7F:
-                    AF = LD_nN_n(AF, ZERO_S(AF & 0x8000) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x78:
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x8000) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x79:
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x0080) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x7A:
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x8000) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x7B:
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x0080) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x7C:
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x8000) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x7D:
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x0080) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x7E:
-                    AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL) & 0x80) | HALF_V | CARRY_F(AF));
-                    cyclesDelta = 4;
-                    break;
+// ADD SP,n
+template <>
+bool CPU::opcode<0xE8>() {
+    int8_t sn;
+    uint16_t nn;
+    nn = SP;
+    sn = (int8_t)operandN();
+    SP = nn + sn;
+    SET_FLAGS(HALF_S(nn, sn) | CARRY_S(SP & 0xFF, nn & 0xFF, sn));
+    return false;
+}
 
-                // SET b,r
-                case 0xC7:
-                    AF = AF | 0x0100;
-                    cyclesDelta = 2;
-                    break;
-                case 0xC0:
-                    BC = BC | 0x0100;
-                    cyclesDelta = 2;
-                    break;
-                case 0xC1:
-                    BC = BC | 0x0001;
-                    cyclesDelta = 2;
-                    break;
-                case 0xC2:
-                    DE = DE | 0x0100;
-                    cyclesDelta = 2;
-                    break;
-                case 0xC3:
-                    DE = DE | 0x0001;
-                    cyclesDelta = 2;
-                    break;
-                case 0xC4:
-                    HL = HL | 0x0100;
-                    cyclesDelta = 2;
-                    break;
-                case 0xC5:
-                    HL = HL | 0x0001;
-                    cyclesDelta = 2;
-                    break;
-                case 0xC6:
-                    Memory::writeByte(HL, Memory::readByte(HL) | 0x01);
-                    cyclesDelta = 4;
-                    break;
-                case 0xCF:
-                    AF = AF | 0x0200;
-                    cyclesDelta = 2;
-                    break;
-                case 0xC8:
-                    BC = BC | 0x0200;
-                    cyclesDelta = 2;
-                    break;
-                case 0xC9:
-                    BC = BC | 0x0002;
-                    cyclesDelta = 2;
-                    break;
-                case 0xCA:
-                    DE = DE | 0x0200;
-                    cyclesDelta = 2;
-                    break;
-                case 0xCB:
-                    DE = DE | 0x0002;
-                    cyclesDelta = 2;
-                    break;
-                case 0xCC:
-                    HL = HL | 0x0200;
-                    cyclesDelta = 2;
-                    break;
-                case 0xCD:
-                    HL = HL | 0x0002;
-                    cyclesDelta = 2;
-                    break;
-                case 0xCE:
-                    Memory::writeByte(HL, Memory::readByte(HL) | 0x02);
-                    cyclesDelta = 4;
-                    break;
-                case 0xD7:
-                    AF = AF | 0x0400;
-                    cyclesDelta = 2;
-                    break;
-                case 0xD0:
-                    BC = BC | 0x0400;
-                    cyclesDelta = 2;
-                    break;
-                case 0xD1:
-                    BC = BC | 0x0004;
-                    cyclesDelta = 2;
-                    break;
-                case 0xD2:
-                    DE = DE | 0x0400;
-                    cyclesDelta = 2;
-                    break;
-                case 0xD3:
-                    DE = DE | 0x0004;
-                    cyclesDelta = 2;
-                    break;
-                case 0xD4:
-                    HL = HL | 0x0400;
-                    cyclesDelta = 2;
-                    break;
-                case 0xD5:
-                    HL = HL | 0x0004;
-                    cyclesDelta = 2;
-                    break;
-                case 0xD6:
-                    Memory::writeByte(HL, Memory::readByte(HL) | 0x04);
-                    cyclesDelta = 4;
-                    break;
-                case 0xDF:
-                    AF = AF | 0x0800;
-                    cyclesDelta = 2;
-                    break;
-                case 0xD8:
-                    BC = BC | 0x0800;
-                    cyclesDelta = 2;
-                    break;
-                case 0xD9:
-                    BC = BC | 0x0008;
-                    cyclesDelta = 2;
-                    break;
-                case 0xDA:
-                    DE = DE | 0x0800;
-                    cyclesDelta = 2;
-                    break;
-                case 0xDB:
-                    DE = DE | 0x0008;
-                    cyclesDelta = 2;
-                    break;
-                case 0xDC:
-                    HL = HL | 0x0800;
-                    cyclesDelta = 2;
-                    break;
-                case 0xDD:
-                    HL = HL | 0x0008;
-                    cyclesDelta = 2;
-                    break;
-                case 0xDE:
-                    Memory::writeByte(HL, Memory::readByte(HL) | 0x08);
-                    cyclesDelta = 4;
-                    break;
-                case 0xE7:
-                    AF = AF | 0x1000;
-                    cyclesDelta = 2;
-                    break;
-                case 0xE0:
-                    BC = BC | 0x1000;
-                    cyclesDelta = 2;
-                    break;
-                case 0xE1:
-                    BC = BC | 0x0010;
-                    cyclesDelta = 2;
-                    break;
-                case 0xE2:
-                    DE = DE | 0x1000;
-                    cyclesDelta = 2;
-                    break;
-                case 0xE3:
-                    DE = DE | 0x0010;
-                    cyclesDelta = 2;
-                    break;
-                case 0xE4:
-                    HL = HL | 0x1000;
-                    cyclesDelta = 2;
-                    break;
-                case 0xE5:
-                    HL = HL | 0x0010;
-                    cyclesDelta = 2;
-                    break;
-                case 0xE6:
-                    Memory::writeByte(HL, Memory::readByte(HL) | 0x10);
-                    cyclesDelta = 4;
-                    break;
-                case 0xEF:
-                    AF = AF | 0x2000;
-                    cyclesDelta = 2;
-                    break;
-                case 0xE8:
-                    BC = BC | 0x2000;
-                    cyclesDelta = 2;
-                    break;
-                case 0xE9:
-                    BC = BC | 0x0020;
-                    cyclesDelta = 2;
-                    break;
-                case 0xEA:
-                    DE = DE | 0x2000;
-                    cyclesDelta = 2;
-                    break;
-                case 0xEB:
-                    DE = DE | 0x0020;
-                    cyclesDelta = 2;
-                    break;
-                case 0xEC:
-                    HL = HL | 0x2000;
-                    cyclesDelta = 2;
-                    break;
-                case 0xED:
-                    HL = HL | 0x0020;
-                    cyclesDelta = 2;
-                    break;
-                case 0xEE:
-                    Memory::writeByte(HL, Memory::readByte(HL) | 0x20);
-                    cyclesDelta = 4;
-                    break;
-                case 0xF7:
-                    AF = AF | 0x4000;
-                    cyclesDelta = 2;
-                    break;
-                case 0xF0:
-                    BC = BC | 0x4000;
-                    cyclesDelta = 2;
-                    break;
-                case 0xF1:
-                    BC = BC | 0x0040;
-                    cyclesDelta = 2;
-                    break;
-                case 0xF2:
-                    DE = DE | 0x4000;
-                    cyclesDelta = 2;
-                    break;
-                case 0xF3:
-                    DE = DE | 0x0040;
-                    cyclesDelta = 2;
-                    break;
-                case 0xF4:
-                    HL = HL | 0x4000;
-                    cyclesDelta = 2;
-                    break;
-                case 0xF5:
-                    HL = HL | 0x0040;
-                    cyclesDelta = 2;
-                    break;
-                case 0xF6:
-                    Memory::writeByte(HL, Memory::readByte(HL) | 0x40);
-                    cyclesDelta = 4;
-                    break;
-                case 0xFF:
-                    AF = AF | 0x8000;
-                    cyclesDelta = 2;
-                    break;
-                case 0xF8:
-                    BC = BC | 0x8000;
-                    cyclesDelta = 2;
-                    break;
-                case 0xF9:
-                    BC = BC | 0x0080;
-                    cyclesDelta = 2;
-                    break;
-                case 0xFA:
-                    DE = DE | 0x8000;
-                    cyclesDelta = 2;
-                    break;
-                case 0xFB:
-                    DE = DE | 0x0080;
-                    cyclesDelta = 2;
-                    break;
-                case 0xFC:
-                    HL = HL | 0x8000;
-                    cyclesDelta = 2;
-                    break;
-                case 0xFD:
-                    HL = HL | 0x0080;
-                    cyclesDelta = 2;
-                    break;
-                case 0xFE:
-                    Memory::writeByte(HL, Memory::readByte(HL) | 0x80);
-                    cyclesDelta = 4;
-                    break;
+// INC nn
+template <>
+bool CPU::opcode<0x03>() {
+    BC++;
+    return false;
+}
 
-                // RES b,r
-                case 0x87:
-                    AF = AF & 0xFEFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0x80:
-                    BC = BC & 0xFEFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0x81:
-                    BC = BC & 0xFFFE;
-                    cyclesDelta = 2;
-                    break;
-                case 0x82:
-                    DE = DE & 0xFEFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0x83:
-                    DE = DE & 0xFFFE;
-                    cyclesDelta = 2;
-                    break;
-                case 0x84:
-                    HL = HL & 0xFEFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0x85:
-                    HL = HL & 0xFFFE;
-                    cyclesDelta = 2;
-                    break;
-                case 0x86:
-                    Memory::writeByte(HL, Memory::readByte(HL) & 0xFE);
-                    cyclesDelta = 4;
-                    break;
-                case 0x8F:
-                    AF = AF & 0xFDFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0x88:
-                    BC = BC & 0xFDFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0x89:
-                    BC = BC & 0xFFFD;
-                    cyclesDelta = 2;
-                    break;
-                case 0x8A:
-                    DE = DE & 0xFDFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0x8B:
-                    DE = DE & 0xFFFD;
-                    cyclesDelta = 2;
-                    break;
-                case 0x8C:
-                    HL = HL & 0xFDFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0x8D:
-                    HL = HL & 0xFFFD;
-                    cyclesDelta = 2;
-                    break;
-                case 0x8E:
-                    Memory::writeByte(HL, Memory::readByte(HL) & 0xFD);
-                    cyclesDelta = 4;
-                    break;
-                case 0x97:
-                    AF = AF & 0xFBFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0x90:
-                    BC = BC & 0xFBFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0x91:
-                    BC = BC & 0xFFFB;
-                    cyclesDelta = 2;
-                    break;
-                case 0x92:
-                    DE = DE & 0xFBFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0x93:
-                    DE = DE & 0xFFFB;
-                    cyclesDelta = 2;
-                    break;
-                case 0x94:
-                    HL = HL & 0xFBFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0x95:
-                    HL = HL & 0xFFFB;
-                    cyclesDelta = 2;
-                    break;
-                case 0x96:
-                    Memory::writeByte(HL, Memory::readByte(HL) & 0xFB);
-                    cyclesDelta = 4;
-                    break;
-                case 0x9F:
-                    AF = AF & 0xF7FF;
-                    cyclesDelta = 2;
-                    break;
-                case 0x98:
-                    BC = BC & 0xF7FF;
-                    cyclesDelta = 2;
-                    break;
-                case 0x99:
-                    BC = BC & 0xFFF7;
-                    cyclesDelta = 2;
-                    break;
-                case 0x9A:
-                    DE = DE & 0xF7FF;
-                    cyclesDelta = 2;
-                    break;
-                case 0x9B:
-                    DE = DE & 0xFFF7;
-                    cyclesDelta = 2;
-                    break;
-                case 0x9C:
-                    HL = HL & 0xF7FF;
-                    cyclesDelta = 2;
-                    break;
-                case 0x9D:
-                    HL = HL & 0xFFF7;
-                    cyclesDelta = 2;
-                    break;
-                case 0x9E:
-                    Memory::writeByte(HL, Memory::readByte(HL) & 0xF7);
-                    cyclesDelta = 4;
-                    break;
-                case 0xA7:
-                    AF = AF & 0xEFFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xA0:
-                    BC = BC & 0xEFFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xA1:
-                    BC = BC & 0xFFEF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xA2:
-                    DE = DE & 0xEFFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xA3:
-                    DE = DE & 0xFFEF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xA4:
-                    HL = HL & 0xEFFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xA5:
-                    HL = HL & 0xFFEF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xA6:
-                    Memory::writeByte(HL, Memory::readByte(HL) & 0xEF);
-                    cyclesDelta = 4;
-                    break;
-                case 0xAF:
-                    AF = AF & 0xDFFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xA8:
-                    BC = BC & 0xDFFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xA9:
-                    BC = BC & 0xFFDF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xAA:
-                    DE = DE & 0xDFFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xAB:
-                    DE = DE & 0xFFDF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xAC:
-                    HL = HL & 0xDFFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xAD:
-                    HL = HL & 0xFFDF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xAE:
-                    Memory::writeByte(HL, Memory::readByte(HL) & 0xDF);
-                    cyclesDelta = 4;
-                    break;
-                case 0xB7:
-                    AF = AF & 0xBFFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xB0:
-                    BC = BC & 0xBFFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xB1:
-                    BC = BC & 0xFFBF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xB2:
-                    DE = DE & 0xBFFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xB3:
-                    DE = DE & 0xFFBF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xB4:
-                    HL = HL & 0xBFFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xB5:
-                    HL = HL & 0xFFBF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xB6:
-                    Memory::writeByte(HL, Memory::readByte(HL) & 0xBF);
-                    cyclesDelta = 4;
-                    break;
-                case 0xBF:
-                    AF = AF & 0x7FFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xB8:
-                    BC = BC & 0x7FFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xB9:
-                    BC = BC & 0xFF7F;
-                    cyclesDelta = 2;
-                    break;
-                case 0xBA:
-                    DE = DE & 0x7FFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xBB:
-                    DE = DE & 0xFF7F;
-                    cyclesDelta = 2;
-                    break;
-                case 0xBC:
-                    HL = HL & 0x7FFF;
-                    cyclesDelta = 2;
-                    break;
-                case 0xBD:
-                    HL = HL & 0xFF7F;
-                    cyclesDelta = 2;
-                    break;
-                case 0xBE:
-                    Memory::writeByte(HL, Memory::readByte(HL) & 0x7F);
-                    cyclesDelta = 4;
-                    break;
+template <>
+bool CPU::opcode<0x13>() {
+    DE++;
+    return false;
+}
+
+template <>
+bool CPU::opcode<0x23>() {
+    HL++;
+    return false;
+}
+
+template <>
+bool CPU::opcode<0x33>() {
+    SP++;
+    return false;
+}
+
+// DEC nn
+template <>
+bool CPU::opcode<0x0B>() {
+    BC--;
+    return false;
+}
+
+template <>
+bool CPU::opcode<0x1B>() {
+    DE--;
+    return false;
+}
+
+template <>
+bool CPU::opcode<0x2B>() {
+    HL--;
+    return false;
+}
+
+template <>
+bool CPU::opcode<0x3B>() {
+    SP--;
+    return false;
+}
+
+// RLCA
+template <>
+bool CPU::opcode<0x07>() {
+    bool c;
+    c = (AF >> 15) & 0x01;
+    AF = LD_Nn_Nn(AF, ((AF & 0xFF00) << 1) | (c << 8));
+    SET_FLAGS(c << 4);
+    return false;
+}
+
+// RLA
+template <>
+bool CPU::opcode<0x17>() {
+    bool c;
+    c = (AF >> 15) & 0x01;
+    AF = LD_Nn_Nn(AF, ((AF & 0xFF00) << 1) | (CARRY_F(AF_FLAGS) << 4));
+    SET_FLAGS(c << 4);
+    return false;
+}
+
+// RRCA
+template <>
+bool CPU::opcode<0x0F>() {
+    bool c;
+    c = (AF >> 8) & 0x01;
+    AF = LD_Nn_Nn(AF, (AF >> 1) | (c << 15));
+    SET_FLAGS(c << 4);
+    return false;
+}
+
+// RRA
+template <>
+bool CPU::opcode<0x1F>() {
+    bool c;
+    c = (AF >> 8) & 0x01;
+    AF = LD_Nn_Nn(AF, (AF >> 1) | (CARRY_F(AF_FLAGS) << 11));
+    SET_FLAGS(c << 4);
+    return false;
+}
+
+// DAA
+template <>
+bool CPU::opcode<0x27>() {
+    const uint16_t result = daaTable[(AF & 0xFF00) >> 5 | (AF_FLAGS & (SUB_V | HALF_V | CARRY_V)) >> 4];
+    AF = LD_Nn_Nn(AF, result);
+    SET_FLAGS(result & 0x00FF);
+    return false;
+}
+
+// CPL
+template <>
+bool CPU::opcode<0x2F>() {
+    AF = LD_Nn_Nn(AF, ~AF);
+    SET_FLAGS(ZERO_F(AF_FLAGS) | SUB_V | HALF_V | CARRY_F(AF_FLAGS));
+    return false;
+}
+
+// CCF
+template <>
+bool CPU::opcode<0x3F>() {
+    SET_FLAGS(ZERO_F(AF_FLAGS) | (CARRY_F(AF_FLAGS) == 0 ? CARRY_V : 0));
+    return false;
+}
+
+// SCF
+template <>
+bool CPU::opcode<0x37>() {
+    SET_FLAGS(ZERO_F(AF_FLAGS) | CARRY_V);
+    return false;
+}
+
+// DI
+template <>
+bool CPU::opcode<0xF3>() {
+    disableIRQ = 2;
+    return false;
+}
+
+// EI
+template <>
+bool CPU::opcode<0xFB>() {
+    enableIRQ = 2;
+    return false;
+}
+
+// JP nn
+template <>
+bool CPU::opcode<0xC3>() {
+    PC = operandNn();
+    return false;
+}
+
+// JP cc,nn
+template <>
+bool CPU::opcode<0xC2>() {
+    uint16_t nn;
+    nn = operandNn();
+    if (ZERO_F(AF_FLAGS) == 0) {
+        PC = nn;
+        return true;
+    }
+    return false;
+}
+
+template <>
+bool CPU::opcode<0xCA>() {
+    uint16_t nn;
+    nn = operandNn();
+    if (ZERO_F(AF_FLAGS) == ZERO_V) {
+        PC = nn;
+        return true;
+    }
+    return false;
+}
+
+template <>
+bool CPU::opcode<0xD2>() {
+    uint16_t nn;
+    nn = operandNn();
+    if (CARRY_F(AF_FLAGS) == 0) {
+        PC = nn;
+        return true;
+    }
+    return false;
+}
+
+template <>
+bool CPU::opcode<0xDA>() {
+    uint16_t nn;
+    nn = operandNn();
+    if (CARRY_F(AF_FLAGS) == CARRY_V) {
+        PC = nn;
+        return true;
+    }
+    return false;
+}
+
+// JP (HL)
+template <>
+bool CPU::opcode<0xE9>() {
+    PC = HL;
+    return false;
+}
+
+// JR n
+template <>
+bool CPU::opcode<0x18>() {
+    PC += (int8_t)operandN();
+    return false;
+}
+
+// JR cc,n
+template <>
+bool CPU::opcode<0x20>() {
+    uint8_t n;
+    n = operandN();
+    if (ZERO_F(AF_FLAGS) == 0) {
+        PC += (int8_t)n;
+        return true;
+    }
+    return false;
+}
+
+template <>
+bool CPU::opcode<0x28>() {
+    uint8_t n;
+    n = operandN();
+    if (ZERO_F(AF_FLAGS) == ZERO_V) {
+        PC += (int8_t)n;
+        return true;
+    }
+    return false;
+}
+
+template <>
+bool CPU::opcode<0x30>() {
+    uint8_t n;
+    n = operandN();
+    if (CARRY_F(AF_FLAGS) == 0) {
+        PC += (int8_t)n;
+        return true;
+    }
+    return false;
+}
+
+template <>
+bool CPU::opcode<0x38>() {
+    uint8_t n;
+    n = operandN();
+    if (CARRY_F(AF_FLAGS) == CARRY_V) {
+        PC += (int8_t)n;
+        return true;
+    }
+    return false;
+}
+
+// CALL nn
+template <>
+bool CPU::opcode<0xCD>() {
+    uint16_t nn;
+    nn = operandNn();
+    pushStack(PC);
+    PC = nn;
+    return false;
+}
+
+// CALL cc,nn
+template <>
+bool CPU::opcode<0xC4>() {
+    uint16_t nn;
+    nn = operandNn();
+    if (ZERO_F(AF_FLAGS) == 0) {
+        pushStack(PC);
+        PC = nn;
+        return true;
+    }
+    return false;
+}
+
+template <>
+bool CPU::opcode<0xCC>() {
+    uint16_t nn;
+    nn = operandNn();
+    if (ZERO_F(AF_FLAGS) == ZERO_V) {
+        pushStack(PC);
+        PC = nn;
+        return true;
+    }
+    return false;
+}
+
+template <>
+bool CPU::opcode<0xD4>() {
+    uint16_t nn;
+    nn = operandNn();
+    if (CARRY_F(AF_FLAGS) == 0) {
+        pushStack(PC);
+        PC = nn;
+        return true;
+    }
+    return false;
+}
+
+template <>
+bool CPU::opcode<0xDC>() {
+    uint16_t nn;
+    nn = operandNn();
+    if (CARRY_F(AF_FLAGS) == CARRY_V) {
+        pushStack(PC);
+        PC = nn;
+        return true;
+    }
+    return false;
+}
 
-                // SWAP n
-                case 0x37:
-                    AF = LD_Nn_Nn(AF, ((AF & 0xF000) >> 4) | ((AF & 0x0F00) << 4));
-                    AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00));
-                    cyclesDelta = 2;
-                    break;
-                case 0x30:
-                    BC = LD_Nn_Nn(BC, ((BC & 0xF000) >> 4) | ((BC & 0x0F00) << 4));
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0xFF00));
-                    cyclesDelta = 2;
-                    break;
-                case 0x31:
-                    BC = LD_nN_nN(BC, ((BC & 0x00F0) >> 4) | ((BC & 0x000F) << 4));
-                    AF = LD_nN_n(AF, ZERO_S(BC & 0x00FF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x32:
-                    DE = LD_Nn_Nn(DE, ((DE & 0xF000) >> 4) | ((DE & 0x0F00) << 4));
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0xFF00));
-                    cyclesDelta = 2;
-                    break;
-                case 0x33:
-                    DE = LD_nN_nN(DE, ((DE & 0x00F0) >> 4) | ((DE & 0x000F) << 4));
-                    AF = LD_nN_n(AF, ZERO_S(DE & 0x00FF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x34:
-                    HL = LD_Nn_Nn(HL, ((HL & 0xF000) >> 4) | ((HL & 0x0F00) << 4));
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0xFF00));
-                    cyclesDelta = 2;
-                    break;
-                case 0x35:
-                    HL = LD_nN_nN(HL, ((HL & 0x00F0) >> 4) | ((HL & 0x000F) << 4));
-                    AF = LD_nN_n(AF, ZERO_S(HL & 0x00FF));
-                    cyclesDelta = 2;
-                    break;
-                case 0x36:
-                    Memory::writeByte(HL, ((Memory::readByte(HL) & 0xF0) >> 4) | ((Memory::readByte(HL) & 0x0F) << 4));
-                    AF = LD_nN_n(AF, ZERO_S(Memory::readByte(HL)));
-                    cyclesDelta = 4;
-                    break;
+// RST n
+template <>
+bool CPU::opcode<0xC7>() {
+    pushStack(PC);
+    PC = 0x00;
+    return false;
+}
 
-                default:
-                    Serial.printf("%02x NOT IMPLEMENTED (at %04x)\n\n", op, PC - 2);
-                    stopAndRestart();
-            }
+template <>
+bool CPU::opcode<0xCF>() {
+    pushStack(PC);
+    PC = 0x08;
+    return false;
+}
 
-            break;
+template <>
+bool CPU::opcode<0xD7>() {
+    pushStack(PC);
+    PC = 0x10;
+    return false;
+}
 
-        // DAA
-        case 0x27:
-            n = 0;
-            if (HALF_F(AF) == HALF_V || (SUB_F(AF) == 0 && (AF & 0x0F00) > 0x0900)) {
-                n = 6;
-            }
-            if (CARRY_F(AF) == CARRY_V || (SUB_F(AF) == 0 && (AF & 0xFF00) > 0x9900)) {
-                n = n | 0x60;
-            }
-            AF = LD_Nn_n(AF, (AF >> 8) + (SUB_F(AF) == 0 ? n : -n));
-            AF = LD_nN_n(AF, ZERO_S(AF & 0xFF00) | SUB_F(AF) | (n > 6 ? CARRY_V : 0));
-            cyclesDelta = 1;
-            break;
+template <>
+bool CPU::opcode<0xDF>() {
+    pushStack(PC);
+    PC = 0x18;
+    return false;
+}
 
-        // CPL
-        case 0x2F:
-            AF = LD_Nn_Nn(AF, ~AF);
-            AF = LD_nN_n(AF, ZERO_F(AF) | SUB_V | HALF_V | CARRY_F(AF));
-            cyclesDelta = 1;
-            break;
+template <>
+bool CPU::opcode<0xE7>() {
+    pushStack(PC);
+    PC = 0x20;
+    return false;
+}
 
-        // CCF
-        case 0x3F:
-            AF = LD_nN_n(AF, ZERO_F(AF) | (CARRY_F(AF) == 0 ? CARRY_V : 0));
-            cyclesDelta = 1;
-            break;
+template <>
+bool CPU::opcode<0xEF>() {
+    pushStack(PC);
+    PC = 0x28;
+    return false;
+}
 
-        // SCF
-        case 0x37:
-            AF = LD_nN_n(AF, ZERO_F(AF) | CARRY_V);
-            cyclesDelta = 1;
-            break;
+template <>
+bool CPU::opcode<0xF7>() {
+    pushStack(PC);
+    PC = 0x30;
+    return false;
+}
 
-        // DI
-        case 0xF3:
-            disableIRQ = 2;
-            cyclesDelta = 1;
-            break;
+template <>
+bool CPU::opcode<0xFF>() {
+    pushStack(PC);
+    PC = 0x38;
+    return false;
+}
 
-        // EI
-        case 0xFB:
-            enableIRQ = 2;
-            cyclesDelta = 1;
-            break;
+// RET
+template <>
+bool CPU::opcode<0xC9>() {
+    PC = popStack();
+    return false;
+}
 
-        // JP nn
-        case 0xC3:
-            PC = readNn();
-            cyclesDelta = 3;
-            break;
+// RET cc
+template <>
+bool CPU::opcode<0xC0>() {
+    if (ZERO_F(AF_FLAGS) == 0) {
+        PC = popStack();
+        return true;
+    }
+    return false;
+}
 
-        // JP cc,nn
-        case 0xC2:
-            nn = readNn();
-            if (ZERO_F(AF) == 0) {
-                PC = nn;
-            }
-            cyclesDelta = 3;
-            break;
-        case 0xCA:
-            nn = readNn();
-            if (ZERO_F(AF) == ZERO_V) {
-                PC = nn;
-            }
-            cyclesDelta = 3;
-            break;
-        case 0xD2:
-            nn = readNn();
-            if (CARRY_F(AF) == 0) {
-                PC = nn;
-            }
-            cyclesDelta = 3;
-            break;
-        case 0xDA:
-            nn = readNn();
-            if (CARRY_F(AF) == CARRY_V) {
-                PC = nn;
-            }
-            cyclesDelta = 3;
-            break;
+template <>
+bool CPU::opcode<0xC8>() {
+    if (ZERO_F(AF_FLAGS) == ZERO_V) {
+        PC = popStack();
+        return true;
+    }
+    return false;
+}
 
-        // JP (HL)
-        case 0xE9:
-            PC = HL;
-            cyclesDelta = 1;
-            break;
+template <>
+bool CPU::opcode<0xD0>() {
+    if (CARRY_F(AF_FLAGS) == 0) {
+        PC = popStack();
+        return true;
+    }
+    return false;
+}
 
-        // JR n
-        case 0x18:
-            PC += (int8_t)readOp();
-            cyclesDelta = 2;
-            break;
+template <>
+bool CPU::opcode<0xD8>() {
+    if (CARRY_F(AF_FLAGS) == CARRY_V) {
+        PC = popStack();
+        return true;
+    }
+    return false;
+}
 
-        // JR cc,n
-        case 0x20:
-            n = readOp();
-            if (ZERO_F(AF) == 0) {
-                PC += (int8_t)n;
-            }
-            cyclesDelta = 2;
+// RETI
+template <>
+bool CPU::opcode<0xD9>() {
+    PC = popStack();
+    enableIRQ = 2;
+    return false;
+}
+
+/**
+ * 0xCB prefixed opcode handlers
+ */
+
+template <uint8_t code>
+bool CPU::opcodeCB() {
+    /**
+     * Generic handler of all 0xCB prefixed opcodes
+     * Bits 0-2 encode the operand, bits 3-5 the operation or bit and bits 6-7 the group.
+     */
+    const uint8_t bit = 1 << ((code >> 3) & 0x07);
+
+    if (code < 0x40) {
+        // RLC, RRC, RL, RR, SLA, SRA, SWAP, SRL r
+        writeRegister<code & 0x07>(shift<(code >> 3) & 0x07>(readRegister<code & 0x07>()));
+    } else if (code < 0x80) {
+        // BIT b,r
+        SET_FLAGS(ZERO_S(readRegister<code & 0x07>() & bit) | HALF_V | CARRY_F(AF_FLAGS));
+    } else if (code < 0xC0) {
+        // RES b,r
+        writeRegister<code & 0x07>(readRegister<code & 0x07>() & ~bit);
+    } else {
+        // SET b,r
+        writeRegister<code & 0x07>(readRegister<code & 0x07>() | bit);
+    }
+    return false;
+}
+
+bool CPU::decodeCB() {
+    /**
+     * Handle the 0xCB prefixed opcode in operand
+     * Does the same as opcodeCB, but decodes the opcode at runtime
+     */
+    const uint8_t r = operand & 0x07;
+    const uint8_t bit = 1 << ((operand >> 3) & 0x07);
+    uint8_t n;
+
+    switch (r) {
+        case 0:
+            n = readRegister<0>();
             break;
-        case 0x28:
-            n = readOp();
-            if (ZERO_F(AF) == ZERO_V) {
-                PC += (int8_t)n;
-            }
-            cyclesDelta = 2;
+        case 1:
+            n = readRegister<1>();
             break;
-        case 0x30:
-            n = readOp();
-            if (CARRY_F(AF) == 0) {
-                PC += (int8_t)n;
-            }
-            cyclesDelta = 2;
+        case 2:
+            n = readRegister<2>();
             break;
-        case 0x38:
-            n = readOp();
-            if (CARRY_F(AF) == CARRY_V) {
-                PC += (int8_t)n;
-            }
-            cyclesDelta = 2;
+        case 3:
+            n = readRegister<3>();
             break;
-
-        // CALL nn
-        case 0xCD:
-            nn = readNn();
-            pushStack(PC);
-            PC = nn;
-            cyclesDelta = 3;
+        case 4:
+            n = readRegister<4>();
             break;
-
-        // CALL cc,nn
-        case 0xC4:
-            nn = readNn();
-            if (ZERO_F(AF) == 0) {
-                pushStack(PC);
-                PC = nn;
-            }
-            cyclesDelta = 3;
+        case 5:
+            n = readRegister<5>();
             break;
-        case 0xCC:
-            nn = readNn();
-            if (ZERO_F(AF) == ZERO_V) {
-                pushStack(PC);
-                PC = nn;
-            }
-            cyclesDelta = 3;
+        case 6:
+            n = readRegister<6>();
             break;
-        case 0xD4:
-            nn = readNn();
-            if (CARRY_F(AF) == 0) {
-                pushStack(PC);
-                PC = nn;
-            }
-            cyclesDelta = 3;
+        default:
+            n = readRegister<7>();
             break;
-        case 0xDC:
-            nn = readNn();
-            if (CARRY_F(AF) == CARRY_V) {
-                pushStack(PC);
-                PC = nn;
+    }
+
+    switch (operand >> 6) {
+        case 0:
+            // RLC, RRC, RL, RR, SLA, SRA, SWAP, SRL r
+            switch ((operand >> 3) & 0x07) {
+                case SHIFT_RLC:
+                    n = shift<SHIFT_RLC>(n);
+                    break;
+                case SHIFT_RRC:
+                    n = shift<SHIFT_RRC>(n);
+                    break;
+                case SHIFT_RL:
+                    n = shift<SHIFT_RL>(n);
+                    break;
+                case SHIFT_RR:
+                    n = shift<SHIFT_RR>(n);
+                    break;
+                case SHIFT_SLA:
+                    n = shift<SHIFT_SLA>(n);
+                    break;
+                case SHIFT_SRA:
+                    n = shift<SHIFT_SRA>(n);
+                    break;
+                case SHIFT_SWAP:
+                    n = shift<SHIFT_SWAP>(n);
+                    break;
+                default:
+                    n = shift<SHIFT_SRL>(n);
+                    break;
             }
-            cyclesDelta = 3;
             break;
+        case 1:
+            // BIT b,r
+            SET_FLAGS(ZERO_S(n & bit) | HALF_V | CARRY_F(AF_FLAGS));
+            return false;
+        case 2:
+            // RES b,r
+            n &= ~bit;
+            break;
+        default:
+            // SET b,r
+            n |= bit;
+            break;
+    }
 
-        // RST n
-        case 0xC7:
-            pushStack(PC);
-            PC = 0x00;
-            cyclesDelta = 8;
+    switch (r) {
+        case 0:
+            writeRegister<0>(n);
             break;
-        case 0xCF:
-            pushStack(PC);
-            PC = 0x08;
-            cyclesDelta = 8;
+        case 1:
+            writeRegister<1>(n);
             break;
-        case 0xD7:
-            pushStack(PC);
-            PC = 0x10;
-            cyclesDelta = 8;
+        case 2:
+            writeRegister<2>(n);
             break;
-        case 0xDF:
-            pushStack(PC);
-            PC = 0x18;
-            cyclesDelta = 8;
+        case 3:
+            writeRegister<3>(n);
             break;
-        case 0xE7:
-            pushStack(PC);
-            PC = 0x20;
-            cyclesDelta = 8;
+        case 4:
+            writeRegister<4>(n);
             break;
-        case 0xEF:
-            pushStack(PC);
-            PC = 0x28;
-            cyclesDelta = 8;
+        case 5:
+            writeRegister<5>(n);
             break;
-        case 0xF7:
-            pushStack(PC);
-            PC = 0x30;
-            cyclesDelta = 8;
+        case 6:
+            writeRegister<6>(n);
             break;
-        case 0xFF:
-            pushStack(PC);
-            PC = 0x38;
-            cyclesDelta = 8;
+        default:
+            writeRegister<7>(n);
             break;
+    }
+    return false;
+}
 
-        // RET
-        case 0xC9:
-            PC = popStack();
-            cyclesDelta = 2;
-            break;
+/**
+ * Dispatch tables
+ */
 
-        // RET cc
-        case 0xC0:
-            if (ZERO_F(AF) == 0) {
-                PC = popStack();
-            }
-            cyclesDelta = 2;
-            break;
-        case 0xC8:
-            if (ZERO_F(AF) == ZERO_V) {
-                PC = popStack();
-            }
-            cyclesDelta = 2;
-            break;
-        case 0xD0:
-            if (CARRY_F(AF) == 0) {
-                PC = popStack();
-            }
-            cyclesDelta = 2;
-            break;
-        case 0xD8:
-            if (CARRY_F(AF) == CARRY_V) {
-                PC = popStack();
-            }
-            cyclesDelta = 2;
-            break;
+// Machine cycles per opcode
+// 0xCB is decoded through cbTable, unused opcodes are 0
+static constexpr uint8_t opCycles[256] = {
+    1, 3, 2, 2, 1, 1, 2, 1, 5, 2, 2, 2, 1, 1, 2, 1,  // 0x00
+    1, 3, 2, 2, 1, 1, 2, 1, 2, 2, 2, 2, 1, 1, 2, 1,  // 0x10
+    2, 3, 2, 2, 1, 1, 2, 1, 2, 2, 2, 2, 1, 1, 2, 1,  // 0x20
+    2, 3, 2, 2, 3, 3, 3, 1, 2, 2, 2, 2, 1, 1, 2, 1,  // 0x30
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 0x40
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 0x50
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 0x60
+    2, 2, 2, 2, 2, 2, 1, 2, 1, 1, 1, 1, 1, 1, 2, 1,  // 0x70
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 0x80
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 0x90
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 0xA0
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 0xB0
+    2, 3, 3, 3, 3, 4, 2, 8, 2, 2, 3, 0, 3, 3, 2, 8,  // 0xC0
+    2, 3, 3, 0, 3, 4, 2, 8, 2, 2, 3, 0, 3, 0, 2, 8,  // 0xD0
+    3, 3, 8, 0, 0, 4, 2, 8, 4, 1, 4, 0, 0, 0, 2, 8,  // 0xE0
+    3, 3, 8, 1, 0, 4, 2, 8, 3, 2, 4, 1, 0, 0, 2, 8,  // 0xF0
+};
+
+// Machine cycles per opcode if a conditional branch is taken
+static constexpr uint8_t opCyclesTaken[256] = {
+    1, 3, 2, 2, 1, 1, 2, 1, 5, 2, 2, 2, 1, 1, 2, 1,  // 0x00
+    1, 3, 2, 2, 1, 1, 2, 1, 2, 2, 2, 2, 1, 1, 2, 1,  // 0x10
+    3, 3, 2, 2, 1, 1, 2, 1, 3, 2, 2, 2, 1, 1, 2, 1,  // 0x20
+    3, 3, 2, 2, 3, 3, 3, 1, 3, 2, 2, 2, 1, 1, 2, 1,  // 0x30
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 0x40
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 0x50
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 0x60
+    2, 2, 2, 2, 2, 2, 1, 2, 1, 1, 1, 1, 1, 1, 2, 1,  // 0x70
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 0x80
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 0x90
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 0xA0
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 0xB0
+    5, 3, 4, 3, 6, 4, 2, 8, 5, 2, 4, 0, 6, 3, 2, 8,  // 0xC0
+    5, 3, 4, 0, 6, 4, 2, 8, 5, 2, 4, 0, 6, 0, 2, 8,  // 0xD0
+    3, 3, 8, 0, 0, 4, 2, 8, 4, 1, 4, 0, 0, 0, 2, 8,  // 0xE0
+    3, 3, 8, 1, 0, 4, 2, 8, 3, 2, 4, 1, 0, 0, 2, 8,  // 0xF0
+};
+
+// Machine cycles per 0xCB prefixed opcode
+static constexpr uint8_t cbCycles[256] = {
+    2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,  // 0x00
+    2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,  // 0x10
+    2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,  // 0x20
+    2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,  // 0x30
+    2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,  // 0x40
+    2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,  // 0x50
+    2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,  // 0x60
+    2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,  // 0x70
+    2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,  // 0x80
+    2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,  // 0x90
+    2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,  // 0xA0
+    2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,  // 0xB0
+    2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,  // 0xC0
+    2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,  // 0xD0
+    2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,  // 0xE0
+    2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,  // 0xF0
+};
+
+// Instruction length in bytes per opcode
+const uint8_t CPU::opLength[256] = {
+    1, 3, 1, 1, 1, 1, 2, 1, 3, 1, 1, 1, 1, 1, 2, 1,  // 0x00
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,  // 0x10
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,  // 0x20
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,  // 0x30
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // 0x40
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // 0x50
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // 0x60
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // 0x70
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // 0x80
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // 0x90
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // 0xA0
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // 0xB0
+    1, 1, 3, 3, 3, 1, 2, 1, 1, 1, 3, 2, 3, 3, 2, 1,  // 0xC0
+    1, 1, 3, 1, 3, 1, 2, 1, 1, 1, 3, 1, 3, 1, 2, 1,  // 0xD0
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1,  // 0xE0
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1,  // 0xF0
+};
+
+#define OP_ENTRY(n) {&CPU::opcode<n>, opCycles[n], opCyclesTaken[n]},
+#ifdef CPU_FUSION
+/**
+ * Fused sequences
+ * Only the first instruction of a sequence has been fetched by step. totalCycles is advanced
+ * in between, so reads and writes of timer registers happen at the same cycle as unfused.
+ */
 
-        // RETI
-        case 0xD9:
-            PC = popStack();
-            enableIRQ = 2;
-            cyclesDelta = 2;
-            break;
+void CPU::fetchFused() {
+    /**
+     * Fetch the next instruction of a fused sequence
+     */
+    const DecodedOp *decoded = BlockCache::fetch(PC);
+    op = decoded->opcode;
+    operand = decoded->operand;
+    PC += decoded->length;
+}
 
-        default:
-            Serial.printf("%02x NOT IMPLEMENTED (at %04x)\n\n", op, PC - 1);
-            stopAndRestart();
-            break;
+template <uint8_t op1, uint8_t op2>
+bool CPU::fused() {
+    opcode<op1>();
+    totalCycles += opCycles[op1];
+    fetchFused();
+    const bool taken = opcode<op2>();
+    totalCycles -= opCycles[op1];
+    return taken;
+}
+
+template <uint8_t op1, uint8_t op2, uint8_t op3>
+bool CPU::fused() {
+    opcode<op1>();
+    totalCycles += opCycles[op1];
+    fetchFused();
+    opcode<op2>();
+    totalCycles += opCycles[op2];
+    fetchFused();
+    const bool taken = opcode<op3>();
+    totalCycles -= opCycles[op1] + opCycles[op2];
+    return taken;
+}
+
+#define FUSED_ENTRY2(op1, op2) \
+    {{&CPU::fused<op1, op2>, opCycles[op1] + opCycles[op2], opCycles[op1] + opCyclesTaken[op2]}, 2, opCycles[op1]},
+#define FUSED_ENTRY3(op1, op2, op3)                                                                                                           \
+    {{&CPU::fused<op1, op2, op3>, opCycles[op1] + opCycles[op2] + opCycles[op3], opCycles[op1] + opCycles[op2] + opCyclesTaken[op3]}, 3, \
+     opCycles[op1] + opCycles[op2]},
+
+const CPU::FusedEntry CPU::fusedTable[] = {{{NULL, 0, 0}, 0, 0}, FUSIONS(FUSED_ENTRY2, FUSED_ENTRY3)};
+#endif
+
+#ifdef CPU_COMPACT_CB
+#define CB_ENTRY(n) {&CPU::decodeCB, cbCycles[n], cbCycles[n]},
+#else
+#define CB_ENTRY(n) {&CPU::opcodeCB<n>, cbCycles[n], cbCycles[n]},
+#endif
+
+const CPU::OpEntry CPU::opTable[256] = {OPCODES(OP_ENTRY)};
+const CPU::OpEntry CPU::cbTable[256] = {OPCODES(CB_ENTRY)};
+
+#ifdef CPU_THREADED_DISPATCH
+#define OP_LABEL(n) &&op_##n,
+#define CB_LABEL(n) &&cb_##n,
+#define OP_CASE(n)       \
+    op_##n:              \
+    entry = &opTable[n]; \
+    taken = opcode<n>(); \
+    goto dispatched;
+#define CB_CASE(n)         \
+    cb_##n:                \
+    entry = &cbTable[n];   \
+    taken = opcodeCB<n>(); \
+    goto dispatched;
+#endif
+
+void CPU::begin() {
+    /**
+     * Enable the CPU
+     */
+    cpuEnabled = 1;
+}
+
+void CPU::cpuStep() {
+    /**
+     * Perform one CPU operation
+     */
+    run(1);
+}
+
+uint32_t CPU::run(uint32_t budget) {
+    /**
+     * Perform CPU operations until the budget is spent
+     * Due events are dispatched in front of each operation, operations in between run without interruption.
+     * totalCycles is kept current so peripherals can derive their state from it at any time.
+     * @param budget Machine cycles to spend, at least one operation is performed
+     * @return Machine cycles spent
+     */
+    if (!cpuEnabled) return 0;
+
+    const uint64_t start = totalCycles;
+    const uint64_t end = start + budget;
+
+    do {
+        if (totalCycles >= Scheduler::nextDeadline()) {
+            Scheduler::dispatch(totalCycles);
+        }
+
+        const uint64_t horizon = Scheduler::nextDeadline() - totalCycles;
+        totalCycles += step(horizon < 0xFF ? horizon : 0xFF);
+    } while (totalCycles < end);
+
+    return totalCycles - start;
+}
+
+inline uint8_t CPU::step(const uint8_t horizon) {
+    /**
+     * Perform one CPU operation
+     * This will check for interrupts, decode and act upon the current opcode
+     * @param horizon Machine cycles until the next scheduled event
+     * @return Machine cycles spent
+     */
+    uint16_t opPC;
+    const DecodedOp *decoded;
+
+#ifdef HALT_AT_ZERO
+    if (PC == 0) {
+        Serial.printf("PC at %02x\n", PC);
+        dumpRegister();
+        stopAndRestart();
+    }
+#endif
+
+#ifdef HALT_AFTER_CYCLE
+    if (totalCycles > HALT_AFTER_CYCLE) {
+        Serial.printf("0x8000 - 0x97FF (Tile Data):\n");
+        for (uint16_t i = 0x8000; i < 0x97FF; i += 2) {
+            Serial.printf("%02x-%02x ", Memory::readByte(i), Memory::readByte(i + 1));
+        }
+        Serial.printf("\n");
+        Serial.printf("0x9800 - 0x9BFF (Background Map):\n");
+        for (uint16_t i = 0x9800; i < 0x9BFF; i++) {
+            Serial.printf("%02x ", Memory::readByte(i));
+        }
+        Serial.printf("\n");
+        Serial.printf("0x9C00 - 0x9FFF (Background Maps):\n");
+        for (uint16_t i = 0x9C00; i < 0x9FFF; i++) {
+            Serial.printf("%02x ", Memory::readByte(i));
+        }
+        Serial.printf("\n");
+        Serial.printf("0xFE00 - 0xFEA0 (OAM):\n");
+        for (uint16_t i = 0xFE00; i < 0xFEA0; i += 4) {
+            Serial.printf("%02x-%02x-%02x-%02x ", Memory::readByte(i), Memory::readByte(i + 1), Memory::readByte(i + 2), Memory::readByte(i + 3));
+        }
+        Serial.printf("\n");
+        Serial.printf("0xFF40 (LCDC): %02x\n", Memory::readByte(0xFF40));
+        Serial.printf("0xFF41 (STAT): %02x\n", Memory::readByte(0xFF41));
+        stopAndRestart();
+    }
+#endif
+
+    // Check for interrupts
+    // Any pending interrupt wakes up a halted CPU, it is serviced from the next operation on if IME is set
+    if (halted) {
+        if (!Interrupts::pending()) {
+#ifdef CPU_PROFILER
+            // Halted time counts for the HALT instruction
+            Profiler::sample(PC - 1);
+#endif
+            // Interrupts are only raised by scheduled events, so skip ahead to the next one
+            cyclesDelta = horizon > 0 ? horizon : 1;
+            return cyclesDelta;
+        }
+        halted = 0;
+    } else if (Interrupts::ready()) {
+        const uint16_t vector = Interrupts::acknowledge();
+        pushStack(PC);
+        PC = vector;
+    }
+
+#ifdef DEBUG_AFTER_PC
+    if (PC == DEBUG_AFTER_PC && debugAfterCycle == 0) {
+        debugAfterCycle = totalCycles;
+    }
+#endif
+
+#ifdef CPU_PROFILER
+    Profiler::sample(PC);
+#endif
+
+#ifdef CPU_NATIVE_CODE
+    // Run the native code of the block at PC instead if possible
+    if (NativeCode::startsAt(PC)) {
+        cyclesDelta = NativeCode::run(horizon);
+        if (cyclesDelta != 0) {
+            goto retired;
+        }
+    }
+#endif
+
+    // Fetch the instruction along with its immediate data
+    opPC = PC;
+    decoded = BlockCache::fetch(PC);
+    if (decoded) {
+        op = decoded->opcode;
+        operand = decoded->operand;
+        PC += decoded->length;
+    } else {
+        op = readOp();
+        if (opLength[op] == 3) {
+            operand = readNn();
+        } else if (opLength[op] == 2) {
+            operand = readOp();
+        }
+    }
+
+#ifdef CPU_FUSION_HISTOGRAM
+    if (decoded) {
+        Fusion::record(opPC, decoded);
+    }
+#endif
+
+#ifdef CPU_PROFILER
+    Profiler::count(op, operand);
+#endif
+
+#ifdef DEBUG_AFTER_CYCLE
+    if (debugAfterCycle > 0 && totalCycles >= debugAfterCycle) {
+        delay(20);
+        Serial.printf("Cycle %llu: %02x at %04x - ", totalCycles, op, PC - opLength[op]);
+        dumpRegister();
+
+        /*for (uint16_t i = 0x8000; i <= 0x97FF; i++) {
+            Serial.printf("%02x ", Memory::readByte(i));
+        }
+
+        Serial.printf("\n");
+        stopAndRestart();*/
+    }
+#endif
+
+    // Decode and execute
+    const OpEntry *entry;
+    bool taken;
+
+#ifdef CPU_FUSION
+    // Run a fused sequence as a whole if it ends before the next event
+    if (decoded && decoded->fusion != 0 && fusedTable[decoded->fusion].leadCycles < horizon && (enableIRQ | disableIRQ) == 0) {
+        const FusedEntry &fused = fusedTable[decoded->fusion];
+        // Idle loops are tracked by the address of their branch, the last instruction
+        for (uint8_t i = 0; i + 1 < fused.count; i++) {
+            opPC += decoded[i].length;
+        }
+        entry = &fused.entry;
+        taken = entry->handler();
+        goto dispatched;
+    }
+#endif
+
+#ifdef CPU_THREADED_DISPATCH
+    static void *const opLabels[256] = {OPCODES(OP_LABEL)};
+
+#ifdef CPU_COMPACT_CB
+    if (op == 0xCB) {
+        entry = &cbTable[operand];
+        taken = decodeCB();
+        goto dispatched;
+    }
+    goto *opLabels[op];
+
+    OPCODES(OP_CASE)
+#else
+    static void *const cbLabels[256] = {OPCODES(CB_LABEL)};
+
+    if (op == 0xCB) {
+        goto *cbLabels[operand];
+    }
+    goto *opLabels[op];
+
+    OPCODES(OP_CASE)
+    OPCODES(CB_CASE)
+#endif
+
+dispatched:
+#else
+    if (op == 0xCB) {
+        entry = &cbTable[operand];
+    } else {
+        entry = &opTable[op];
+    }
+    taken = entry->handler();
+#ifdef CPU_FUSION
+dispatched:
+#endif
+#endif
+
+    cyclesDelta = taken ? entry->cyclesTaken : entry->cycles;
+
+    // Skip further iterations of a loop that just polls memory
+    if (taken && IdleLoop::enabled && PC <= opPC && horizon > cyclesDelta && enableIRQ == 0 && disableIRQ == 0) {
+        cyclesDelta += IdleLoop::skip(opPC, totalCycles + cyclesDelta, horizon - cyclesDelta);
+    }
+
+#ifdef CPU_NATIVE_CODE
+retired:
+#endif
+    if ((enableIRQ | disableIRQ) != 0) {
+        if (enableIRQ != 0 && --enableIRQ == 0) {
+            Interrupts::setMaster(true);
+        }
+
+        if (disableIRQ != 0 && --disableIRQ == 0) {
+            Interrupts::setMaster(false);
+        }
     }
 
-    totalCycles += cyclesDelta;
+    return cyclesDelta;
+}
+
+#ifdef CPU_RECOMPILED
+/**
+ * Statically recompiled code
+ */
+#include <CartHelpers.h>
+
+#include "Recompiled.inc"
+
+void *CPU::findRecompiled(const uint16_t bank, const uint16_t pc, uint8_t &entry) {
+    /**
+     * Find the recompiled code of the instruction at pc
+     * @return Block to run starting with instruction entry or NULL
+     */
+    static const bool matching = (Memory::readByte(CART_CHECKSUM) << 8 | Memory::readByte(CART_CHECKSUM + 1)) == RECOMPILED_CHECKSUM;
+    static bool reported = false;
+
+    if (!matching) {
+        if (!reported) {
+            Serial.println("Recompiled code doesn't match the ROM, interpreting it");
+            reported = true;
+        }
+        return NULL;
+    }
 
-    if (enableIRQ != 0 && --enableIRQ == 0) {
-        IME = 1;
+    const uint32_t key = (uint32_t)bank << 16 | pc;
+    uint32_t lower = 0;
+    uint32_t upper = recompiledCount;
+    while (lower < upper) {
+        const uint32_t middle = (lower + upper) / 2;
+        if (recompiledEntries[middle].key < key) {
+            lower = middle + 1;
+        } else {
+            upper = middle;
+        }
     }
 
-    if (disableIRQ != 0 && --disableIRQ == 0) {
-        IME = 0;
+    if (lower == recompiledCount || recompiledEntries[lower].key != key) {
+        return NULL;
     }
-}
\ No newline at end of file
+
+    entry = recompiledEntries[lower].entry;
+    return (void *)recompiledEntries[lower].code;
+}
+#endif
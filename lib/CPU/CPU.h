@@ -23,17 +23,96 @@
 class CPU {
    public:
     static volatile bool cpuEnabled;
-    static volatile uint64_t totalCycles;
+    static uint64_t totalCycles;
 
+    static void begin();
     static void cpuStep();
+    static uint32_t run(uint32_t budget);
     static void stopAndRestart();
+    static void bankSwitched();
+
+    // Instruction length in bytes per opcode, including the opcode itself
+    static const uint8_t opLength[256];
 
    protected:
+    friend class IdleLoop;
+    friend class Jit;
+    friend class NativeCode;
+
+    // Opcode handlers return true if a conditional branch was taken
+    typedef bool (*OpHandler)();
+
+    struct OpEntry {
+        OpHandler handler;
+        // Machine cycles
+        uint8_t cycles;
+        // Machine cycles if a conditional branch was taken
+        uint8_t cyclesTaken;
+    };
+
+    static const OpEntry opTable[256];
+    static const OpEntry cbTable[256];
+
+#ifdef CPU_FUSION
+    // Fused sequence of instructions, see Fusion
+    struct FusedEntry {
+        // Handler and machine cycles of the whole sequence
+        OpEntry entry;
+        uint8_t count;
+        // Machine cycles in front of the last instruction
+        uint8_t leadCycles;
+    };
+
+    // Indexed by DecodedOp::fusion, the first entry is unused
+    static const FusedEntry fusedTable[];
+
+    template <uint8_t op1, uint8_t op2>
+    static bool fused();
+    template <uint8_t op1, uint8_t op2, uint8_t op3>
+    static bool fused();
+    static void fetchFused();
+#endif
+
+    template <uint8_t code>
+    static bool opcode();
+    template <uint8_t code>
+    static bool opcodeCB();
+    static bool decodeCB();
+
+    // 8 bit operands and operations shared by the generic opcode handlers
+    template <uint8_t r>
+    static uint8_t readRegister();
+    template <uint8_t r>
+    static void writeRegister(const uint8_t n);
+    template <uint8_t operation>
+    static void alu(const uint8_t n2);
+    template <uint8_t operation>
+    static uint8_t shift(const uint8_t n);
+
     static uint8_t readOp();
     static uint16_t readNn();
+    static uint8_t operandN();
+    static uint16_t operandNn();
     static void pushStack(const uint16_t data);
     static uint16_t popStack();
 
+#ifdef CPU_RECOMPILED
+    // Statically recompiled blocks keyed by ROM bank << 16 | address, see tools/recompile.py
+    struct RecompiledEntry {
+        uint32_t key;
+        uint16_t (*code)(uint32_t horizon, uint32_t entry);
+        // Index of the instruction within its block
+        uint8_t entry;
+    };
+
+    static const RecompiledEntry recompiledEntries[];
+    static const uint32_t recompiledCount;
+
+    template <uint32_t key>
+    static uint16_t recompiled(uint32_t horizon, uint32_t entry);
+    static void *findRecompiled(const uint16_t bank, const uint16_t pc, uint8_t &entry);
+#endif
+
    private:
     // Registers
     static uint16_t AF;
@@ -46,8 +125,12 @@ class CPU {
     // Init OP
     static uint8_t op;
 
-    // Init IME
-    static bool IME;
+    // Immediate data of the current instruction
+    static uint16_t operand;
+
+    // Region of plain memory PC is fetched from directly, see Memory::getFetchWindow
+    static const uint8_t *fetchData;
+    static uint16_t fetchStart, fetchSize;
 
     // Virtual HALT
     static bool halted;
@@ -58,15 +141,28 @@ class CPU {
     // IRQ control
     static uint8_t enableIRQ, disableIRQ;
 
-    // Divider interval
-    static uint8_t divider;
-
-    // Timer control
-    static uint8_t timerCycles, timerTotalCycles;
-
     static uint8_t cyclesDelta;
 
+    static uint8_t step(const uint8_t horizon);
+    static void moveFetchWindow();
+
     // Debug
     static void dumpRegister();
     static void dumpStack();
 };
+
+inline uint8_t CPU::operandN() {
+    /**
+     * Get the 8 bit immediate data of the current instruction
+     * @return One byte of program data
+     */
+    return operand;
+}
+
+inline uint16_t CPU::operandNn() {
+    /**
+     * Get the 16 bit immediate data of the current instruction
+     * @return Two bytes of program data
+     */
+    return operand;
+}
@@ -0,0 +1,212 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#include "Fusion.h"
+
+#include <Arduino.h>
+
+#define SEQUENCE2(op1, op2)      {2, op1, op2, 0},
+#define SEQUENCE3(op1, op2, op3) {3, op1, op2, op3},
+
+const uint8_t Fusion::sequences[][4] = {FUSIONS(SEQUENCE2, SEQUENCE3)};
+const uint8_t Fusion::sequenceCount = sizeof(sequences) / sizeof(sequences[0]);
+
+#ifdef CPU_FUSION_HISTOGRAM
+Fusion::Count Fusion::histogram[FUSION_HISTOGRAM_SIZE] = {};
+
+uint8_t Fusion::run[2] = {0, 0};
+uint8_t Fusion::runLength = 0;
+uint16_t Fusion::runNext = 0;
+#endif
+
+bool Fusion::canLead(const uint8_t opcode) {
+    /**
+     * Check if an instruction can be followed by others in a fused sequence
+     * It must not write memory, change the program flow or the interrupt master enable.
+     */
+    switch (opcode) {
+        // LD (BC),A, LD (DE),A, LDI (HL),A, LDD (HL),A, LD (nn),SP
+        case 0x02:
+        case 0x12:
+        case 0x22:
+        case 0x32:
+        case 0x08:
+        // INC (HL), DEC (HL), LD (HL),n
+        case 0x34:
+        case 0x35:
+        case 0x36:
+        // LD (HL),r
+        case 0x70:
+        case 0x71:
+        case 0x72:
+        case 0x73:
+        case 0x74:
+        case 0x75:
+        case 0x77:
+        // LDH (n),A, LD (C),A, LD (nn),A
+        case 0xE0:
+        case 0xE2:
+        case 0xEA:
+        // PUSH nn
+        case 0xC5:
+        case 0xD5:
+        case 0xE5:
+        case 0xF5:
+        // DI, EI and the 0xCB prefix
+        case 0xF3:
+        case 0xFB:
+        case 0xCB:
+            return false;
+
+        default:
+            return canEnd(opcode) && !BlockCache::endsBlock(opcode);
+    }
+}
+
+bool Fusion::canEnd(const uint8_t opcode) {
+    /**
+     * Check if an instruction can end a fused sequence
+     */
+    switch (opcode) {
+        // STOP, HALT, DI, EI, RETI and the 0xCB prefix
+        case 0x10:
+        case 0x76:
+        case 0xF3:
+        case 0xFB:
+        case 0xD9:
+        case 0xCB:
+            return false;
+
+        default:
+            return true;
+    }
+}
+
+uint8_t Fusion::match(const DecodedOp *ops, const uint8_t count) {
+    /**
+     * Find the fused sequence starting with the first of some decoded instructions
+     * @param ops: Decoded instructions of a block
+     * @param count: Number of instructions left in the block
+     * @return Index of the sequence in FUSIONS plus one, 0 if none matches
+     */
+    for (uint8_t i = 0; i < sequenceCount; i++) {
+        const uint8_t length = sequences[i][0];
+        if (length > count) {
+            continue;
+        }
+
+        uint8_t j = 0;
+        while (j < length && ops[j].opcode == sequences[i][1 + j]) {
+            j++;
+        }
+        if (j == length) {
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+#ifdef CPU_FUSION_HISTOGRAM
+void Fusion::record(const uint16_t pc, const DecodedOp *decoded) {
+    /**
+     * Count the sequences ending with an instruction that is about to run
+     * @param pc: Address of the instruction
+     * @param decoded: The decoded instruction
+     */
+    const uint8_t opcode = decoded->opcode;
+
+    // Only instructions running right after each other can be fused
+    if (pc != runNext) {
+        runLength = 0;
+    }
+
+    if (canEnd(opcode)) {
+        if (runLength >= 1) {
+            count(2 << 24 | run[1] << 8 | opcode);
+        }
+        if (runLength >= 2) {
+            count(3u << 24 | run[0] << 16 | run[1] << 8 | opcode);
+        }
+    }
+
+    if (canLead(opcode)) {
+        run[0] = run[1];
+        run[1] = opcode;
+        if (runLength < 2) {
+            runLength++;
+        }
+    } else {
+        runLength = 0;
+    }
+    runNext = pc + decoded->length;
+}
+
+void Fusion::count(const uint32_t key) {
+    /**
+     * Increase the count of a sequence, sequences that don't fit anymore are dropped
+     * @param key: Length << 24 | opcodes
+     */
+    uint32_t slot = (key ^ (key >> 11) ^ (key >> 24)) & (FUSION_HISTOGRAM_SIZE - 1);
+    for (uint16_t probe = 0; probe < FUSION_HISTOGRAM_SIZE; probe++) {
+        Count &entry = histogram[slot];
+        if (entry.key == key || entry.count == 0) {
+            entry.key = key;
+            entry.count++;
+            return;
+        }
+        slot = (slot + 1) & (FUSION_HISTOGRAM_SIZE - 1);
+    }
+}
+
+void Fusion::report() {
+    /**
+     * Print the most frequent pairs and triples
+     */
+    for (uint8_t length = 2; length <= 3; length++) {
+        // Insert each sequence of this length into the ranking
+        const Count *top[FUSION_REPORT_SIZE] = {NULL};
+        for (uint16_t i = 0; i < FUSION_HISTOGRAM_SIZE; i++) {
+            const Count *entry = &histogram[i];
+            if (entry->count == 0 || entry->key >> 24 != length) {
+                continue;
+            }
+            for (uint8_t rank = 0; rank < FUSION_REPORT_SIZE; rank++) {
+                if (!top[rank] || entry->count > top[rank]->count) {
+                    const Count *swapped = top[rank];
+                    top[rank] = entry;
+                    entry = swapped;
+                    if (!entry) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        Serial.printf("Most frequent instruction %s:\n", length == 2 ? "pairs" : "triples");
+        for (uint8_t rank = 0; rank < FUSION_REPORT_SIZE && top[rank]; rank++) {
+            const uint32_t key = top[rank]->key;
+            if (length == 2) {
+                Serial.printf("  %10u  %02x %02x\n", top[rank]->count, (key >> 8) & 0xFF, key & 0xFF);
+            } else {
+                Serial.printf("  %10u  %02x %02x %02x\n", top[rank]->count, (key >> 16) & 0xFF, (key >> 8) & 0xFF, key & 0xFF);
+            }
+        }
+    }
+}
+#endif
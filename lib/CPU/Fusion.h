@@ -0,0 +1,87 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "BlockCache.h"
+
+// Fused instruction sequences, e2(op1, op2) for pairs and e3(op1, op2, op3) for triples
+// Picked from the report of a CPU_FUSION_HISTOGRAM build, longer sequences have to come first.
+#define FUSIONS(e2, e3)                                   \
+    e3(0xF0, 0xFE, 0x20) /* LDH A,(n); CP n; JR NZ,n */   \
+    e3(0xF0, 0xAE, 0x24) /* LDH A,(n); XOR (HL); INC H */ \
+    e3(0xF0, 0xAD, 0x6F) /* LDH A,(n); XOR L; LD L,A */   \
+    e2(0x6F, 0x26)       /* LD L,A; LD H,n */             \
+    e2(0x2A, 0x12)       /* LD A,(HL+); LD (DE),A */      \
+    e2(0x05, 0x20)       /* DEC B; JR NZ,n */             \
+    e2(0x0D, 0x20)       /* DEC C; JR NZ,n */             \
+    e2(0xFE, 0x20)       /* CP n; JR NZ,n */              \
+    e2(0xD6, 0x30)       /* SUB n; JR NC,n */
+
+// Number of distinct sequences the histogram can count, must be a power of two
+#define FUSION_HISTOGRAM_SIZE 4096
+
+// Number of pairs and triples listed by Fusion::report
+#define FUSION_REPORT_SIZE 16
+
+/**
+ * Fusion of instruction sequences
+ *
+ * Blocks are scanned for the sequences in FUSIONS when they are decoded. The interpreter runs a
+ * matching sequence through a single handler with the combined cycles of its instructions, as long
+ * as it ends before the next scheduled event. Only the last instruction of a sequence may write
+ * memory, so neither the block nor pending interrupts can change in between.
+ *
+ * Enabled by building with -DCPU_FUSION. Building with -DCPU_FUSION_HISTOGRAM counts the sequences
+ * that could be fused, the native build prints the most frequent ones when it's done.
+ */
+class Fusion {
+   public:
+    static bool canLead(const uint8_t opcode);
+    static bool canEnd(const uint8_t opcode);
+    static uint8_t match(const DecodedOp *ops, const uint8_t count);
+
+#ifdef CPU_FUSION_HISTOGRAM
+    static void record(const uint16_t pc, const DecodedOp *decoded);
+    static void report();
+#endif
+
+   private:
+    // Sequences of FUSIONS as length and opcodes
+    static const uint8_t sequences[][4];
+    static const uint8_t sequenceCount;
+
+#ifdef CPU_FUSION_HISTOGRAM
+    struct Count {
+        // Length << 24 | opcodes
+        uint32_t key;
+        uint32_t count;
+    };
+
+    static Count histogram[FUSION_HISTOGRAM_SIZE];
+
+    // Opcodes of the current run of instructions that can lead a sequence
+    static uint8_t run[2];
+    static uint8_t runLength;
+    static uint16_t runNext;
+
+    static void count(const uint32_t key);
+#endif
+};
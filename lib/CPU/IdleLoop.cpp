@@ -0,0 +1,212 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#include "IdleLoop.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+#include "CPU.h"
+#include "Memory.h"
+#include "Scheduler.h"
+
+bool IdleLoop::enabled = false;
+
+// Titles of the ROMs whose idle loops are known to be safe to skip
+static const char *const idleLoopTitles[] = {
+    "TETRIS",
+};
+
+uint32_t IdleLoop::skippedLoops = 0;
+uint64_t IdleLoop::skippedCycles = 0;
+
+uint16_t IdleLoop::loopBranch = 0;
+uint8_t IdleLoop::loopCycles = 0;
+uint64_t IdleLoop::loopEnd = 0;
+
+void IdleLoop::begin(const char *title) {
+    /**
+     * Enable skipping idle loops if the ROM is known to busy-wait
+     * @param title: Title from the cartridge header, see Cartridge::getGameName
+     */
+    enabled = false;
+    for (uint8_t i = 0; i < sizeof(idleLoopTitles) / sizeof(idleLoopTitles[0]); i++) {
+        if (strcmp(title, idleLoopTitles[i]) == 0) {
+            enabled = true;
+        }
+    }
+}
+
+uint8_t IdleLoop::skip(const uint16_t branch, const uint64_t now, const uint8_t remaining) {
+    /**
+     * Skip iterations of the loop a branch was just taken into
+     * The previous iteration has to have run in one go, without an event or interrupt in between,
+     * so the values read by the one that just ended are still current.
+     * @param branch Address of the taken branch, the loop starts at PC
+     * @param now Machine cycle after the branch
+     * @param remaining Machine cycles until the next scheduled event
+     * @return Machine cycles skipped
+     */
+    const bool contiguous = branch == loopBranch && now - loopEnd == loopCycles && Scheduler::lastDispatch() <= loopEnd;
+    loopEnd = now;
+
+    if (!contiguous) {
+        // Code or registers may have changed in between, unless this is a known loop that isn't idle
+        if (branch != loopBranch || loopCycles != 0) {
+            loopBranch = branch;
+            loopCycles = scan(branch);
+        }
+        return 0;
+    }
+
+    // Only skip iterations that end in front of the next event
+    const uint8_t skipped = remaining - remaining % loopCycles;
+    if (skipped > 0) {
+        loopEnd += skipped;
+        skippedLoops++;
+        skippedCycles += skipped;
+    }
+
+    return skipped;
+}
+
+uint8_t IdleLoop::scan(const uint16_t branch) {
+    /**
+     * Check whether the code between PC and a branch back to it is an idle loop
+     * @param branch Address of the branch
+     * @return Machine cycles per iteration or 0 if it isn't idle
+     */
+    const uint16_t start = CPU::PC;
+    if (branch < start || branch - start >= IDLE_LOOP_MAX_SIZE) {
+        return 0;
+    }
+
+    uint8_t cycles = 0;
+    uint16_t pc = start;
+
+    while (pc != branch) {
+        const uint8_t op = Memory::readByte(pc);
+        const uint8_t n = Memory::readByte(pc + 1);
+        uint16_t location = 0;
+
+        switch (op) {
+            // LDH A,(n)
+            case 0xF0:
+                location = 0xFF00 + n;
+                break;
+
+            // LD A,(C)
+            case 0xF2:
+                location = 0xFF00 + (CPU::BC & 0xFF);
+                break;
+
+            // LD A,(nn)
+            case 0xFA:
+                location = n | Memory::readByte(pc + 2) << 8;
+                break;
+
+            // LD A,(BC)
+            case 0x0A:
+                location = CPU::BC;
+                break;
+
+            // LD A,(DE)
+            case 0x1A:
+                location = CPU::DE;
+                break;
+
+            // LD A,(HL), AND (HL), OR (HL), CP (HL)
+            case 0x7E:
+            case 0xA6:
+            case 0xB6:
+            case 0xBE:
+                location = CPU::HL;
+                break;
+
+            // AND n, OR n, CP n, AND A, OR A
+            case 0xE6:
+            case 0xF6:
+            case 0xFE:
+            case 0xA7:
+            case 0xB7:
+                break;
+
+            // BIT b,A and BIT b,(HL)
+            case 0xCB:
+                if (n < 0x40 || n >= 0x80 || ((n & 0x07) != 0x07 && (n & 0x07) != 0x06)) {
+                    return 0;
+                }
+                if ((n & 0x07) == 0x06) {
+                    location = CPU::HL;
+                }
+                break;
+
+            default:
+                return 0;
+        }
+
+        // Operations without a memory operand leave location at 0, which is ROM
+        if (!readsStable(location)) {
+            return 0;
+        }
+
+        cycles += op == 0xCB ? CPU::cbTable[n].cycles : CPU::opTable[op].cycles;
+        pc += CPU::opLength[op];
+        if (pc > branch) {
+            return 0;
+        }
+    }
+
+    // The loop has to end in a conditional branch back to its start
+    const uint8_t op = Memory::readByte(branch);
+    uint16_t target;
+    switch (op) {
+        // JR cc,n
+        case 0x20:
+        case 0x28:
+        case 0x30:
+        case 0x38:
+            target = branch + 2 + (int8_t)Memory::readByte(branch + 1);
+            break;
+
+        // JP cc,nn
+        case 0xC2:
+        case 0xCA:
+        case 0xD2:
+        case 0xDA:
+            target = Memory::readByte(branch + 1) | Memory::readByte(branch + 2) << 8;
+            break;
+
+        default:
+            return 0;
+    }
+
+    if (target != start) {
+        return 0;
+    }
+
+    return cycles + CPU::opTable[op].cyclesTaken;
+}
+
+bool IdleLoop::readsStable(const uint16_t location) {
+    /**
+     * Check whether a location keeps its value until the next scheduled event
+     * Everything but memory derived from the cycle counter does as long as the CPU doesn't write.
+     */
+    return location != MEM_DIVIDER && location != MEM_TIMA;
+}
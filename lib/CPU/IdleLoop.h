@@ -0,0 +1,57 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#pragma once
+
+#include <Arduino.h>
+
+// Maximum size of a loop in bytes, including its branch
+#define IDLE_LOOP_MAX_SIZE 16
+
+/**
+ * Detection and fast-forwarding of idle loops
+ *
+ * Games wait for VBlank by polling LY or a flag in RAM that is set by an interrupt handler.
+ * Such a loop only loads A from memory, masks and compares it, and branches back to its start.
+ * Once it has run through without an event in between, every further iteration leaves the CPU
+ * in the same state until the memory it reads changes, which only happens when the next
+ * scheduled event is dispatched. Those iterations are skipped by just accounting their cycles.
+ *
+ * Has to be enabled per ROM, IdleLoop::begin does so for the titles in idleLoopTitles.
+ */
+class IdleLoop {
+   public:
+    static bool enabled;
+
+    // Loops fast-forwarded and the machine cycles skipped
+    static uint32_t skippedLoops;
+    static uint64_t skippedCycles;
+
+    static void begin(const char *title);
+    static uint8_t skip(const uint16_t branch, const uint64_t now, const uint8_t remaining);
+
+   private:
+    // Branch of the loop seen last, machine cycles per iteration or 0 if it isn't idle
+    static uint16_t loopBranch;
+    static uint8_t loopCycles;
+    // Cycle its last iteration ended at
+    static uint64_t loopEnd;
+
+    static uint8_t scan(const uint16_t branch);
+    static bool readsStable(const uint16_t location);
+};
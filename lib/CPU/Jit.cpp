@@ -0,0 +1,1189 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#ifdef CPU_JIT
+
+#include "Jit.h"
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "CPU.h"
+#include "Memory.h"
+#include "NativeCode.h"
+
+// Guard flags
+#define GUARD_READ  0x01
+#define GUARD_WRITE 0x02
+
+// Memory access kinds
+#define ACCESS_NONE   0
+#define ACCESS_BC     1
+#define ACCESS_DE     2
+#define ACCESS_HL     3
+#define ACCESS_C      4  // 0xFF00 + C
+#define ACCESS_PUSH   5  // SP - 1 and SP - 2
+#define ACCESS_POP    6  // SP and SP + 1
+#define ACCESS_STATIC 7  // Immediate address, checked at compile time
+
+uint8_t *Jit::code = NULL;
+uint8_t *Jit::codeCursor = NULL;
+Jit::Compiled Jit::compiled[0x10000] = {};
+uint8_t Jit::guard[0x10000] = {0};
+uint8_t Jit::hostFlags[0x100] = {0};
+uint8_t Jit::memoryOperand = 0;
+
+// Operations of ADD, ADC, SUB, SBC, AND, XOR, OR and CP as encoded in bits 3-5 of the opcode
+#define ALU_ADD 0
+#define ALU_ADC 1
+#define ALU_SUB 2
+#define ALU_SBC 3
+#define ALU_AND 4
+#define ALU_XOR 5
+#define ALU_OR  6
+#define ALU_CP  7
+
+// Opcodes of the same x86 operations, "op al, r/m8" is one above and "op al, imm8" four above
+static const uint8_t hostAlu[8] = {0x00, 0x10, 0x28, 0x18, 0x20, 0x30, 0x08, 0x38};
+
+/**
+ * Minimal x86-64 code emitter
+ * rax, rcx and rdx are used as scratch registers. rbx holds the horizon, rbp the cycles spent
+ * and r12 the flags table, all of them survive calls to the opcode handlers.
+ * Nothing is written past the limit, see overflowed.
+ */
+class Assembler {
+   public:
+    uint8_t *cursor;
+    uint8_t *const limit;
+    bool overflowed;
+
+    Assembler(uint8_t *buffer, uint8_t *end) : cursor(buffer), limit(end), overflowed(false) {}
+
+    void byte(const uint8_t b) {
+        if (cursor == limit) {
+            overflowed = true;
+            return;
+        }
+        *cursor++ = b;
+    }
+    void imm16(const uint16_t v) {
+        byte(v);
+        byte(v >> 8);
+    }
+    void imm32(const uint32_t v) {
+        imm16(v);
+        imm16(v >> 16);
+    }
+    void imm64(const uint64_t v) {
+        imm32(v);
+        imm32(v >> 32);
+    }
+
+    // push rbx; push rbp; push r12; mov ebx, edi; xor ebp, ebp; movabs r12, table
+    void enter(const uint8_t *table) {
+        byte(0x53);
+        byte(0x55);
+        byte(0x41);
+        byte(0x54);
+        byte(0x89);
+        byte(0xFB);
+        byte(0x31);
+        byte(0xED);
+        byte(0x49);
+        byte(0xBC);
+        imm64((uintptr_t)table);
+    }
+    // pop r12; pop rbp; pop rbx; ret
+    void leave() {
+        byte(0x41);
+        byte(0x5C);
+        byte(0x5D);
+        byte(0x5B);
+        byte(0xC3);
+    }
+    // lea eax, [rbp + imm32]
+    void cyclesEax(const uint32_t v) {
+        byte(0x8D);
+        byte(0x85);
+        imm32(v);
+    }
+    // add ebp, imm32
+    void addEbp(const uint32_t v) {
+        byte(0x81);
+        byte(0xC5);
+        imm32(v);
+    }
+    // add eax, ebp
+    void addEaxEbp() {
+        byte(0x01);
+        byte(0xE8);
+    }
+    // mov ebp, eax
+    void movEbpEax() {
+        byte(0x89);
+        byte(0xC5);
+    }
+    // or eax, imm32
+    void orEax(const uint32_t v) {
+        byte(0x0D);
+        imm32(v);
+    }
+    // cmp eax, ebx
+    void compareEaxEbx() {
+        byte(0x39);
+        byte(0xD8);
+    }
+    // mov ecx, [rdx]
+    void loadEcxRdx() {
+        byte(0x8B);
+        byte(0x0A);
+    }
+    // cmp ecx, [rax]
+    void compareEcxRax() {
+        byte(0x3B);
+        byte(0x08);
+    }
+    // mov rax, [rax + offset]
+    void loadRaxRax(const uint8_t offset) {
+        byte(0x48);
+        byte(0x8B);
+        byte(0x40);
+        byte(offset);
+    }
+    // movzx ecx, ah; movabs rdx, pages; mov rdx, [rdx + rcx * 8]; test rdx, rdx
+    void pageRdx(const void *pages) {
+        byte(0x0F);
+        byte(0xB6);
+        byte(0xCC);
+        movRdx((uintptr_t)pages);
+        byte(0x48);
+        byte(0x8B);
+        byte(0x14);
+        byte(0xCA);
+        byte(0x48);
+        byte(0x85);
+        byte(0xD2);
+    }
+    // movzx eax, al; add rdx, rax
+    void offsetRdx() {
+        byte(0x0F);
+        byte(0xB6);
+        byte(0xC0);
+        byte(0x48);
+        byte(0x01);
+        byte(0xC2);
+    }
+    // inc dword [rax + rcx * 4]
+    void incDwordRaxRcx() {
+        byte(0xFF);
+        byte(0x04);
+        byte(0x88);
+    }
+    // mov al, [rax]
+    void loadAlRax() {
+        byte(0x8A);
+        byte(0x00);
+    }
+    // mov [rcx], al
+    void storeAlRcx() {
+        byte(0x88);
+        byte(0x01);
+    }
+    // mov byte [rdx], imm8
+    void storeByteRdx(const uint8_t v) {
+        byte(0xC6);
+        byte(0x02);
+        byte(v);
+    }
+    // jmp rel32, returns the location of rel32
+    uint8_t *jmp() {
+        byte(0xE9);
+        imm32(0);
+        return cursor - 4;
+    }
+    // inc dword [rax]
+    void incDwordRax() {
+        byte(0xFF);
+        byte(0x00);
+    }
+    // test rax, rax
+    void testRax() {
+        byte(0x48);
+        byte(0x85);
+        byte(0xC0);
+    }
+    // jmp rax
+    void jumpRax() {
+        byte(0xFF);
+        byte(0xE0);
+    }
+    // movabs rax, imm64
+    void movRax(const uint64_t v) {
+        byte(0x48);
+        byte(0xB8);
+        imm64(v);
+    }
+    // movabs rcx, imm64
+    void movRcx(const uint64_t v) {
+        byte(0x48);
+        byte(0xB9);
+        imm64(v);
+    }
+    // mov eax, imm32
+    void movEax(const uint32_t v) {
+        byte(0xB8);
+        imm32(v);
+    }
+    // mov ecx, imm32
+    void movEcx(const uint32_t v) {
+        byte(0xB9);
+        imm32(v);
+    }
+    // mov word [ptr], imm16
+    void storeWord(const void *ptr, const uint16_t v) {
+        movRax((uintptr_t)ptr);
+        byte(0x66);
+        byte(0xC7);
+        byte(0x00);
+        imm16(v);
+    }
+    // mov byte [ptr], imm8
+    void storeByte(const void *ptr, const uint8_t v) {
+        movRax((uintptr_t)ptr);
+        byte(0xC6);
+        byte(0x00);
+        byte(v);
+    }
+    // mov cl, [src]; mov [dst], cl
+    void copyByte(const void *dst, const void *src) {
+        movRax((uintptr_t)src);
+        byte(0x8A);
+        byte(0x08);
+        movRax((uintptr_t)dst);
+        byte(0x88);
+        byte(0x08);
+    }
+    // movzx eax, word [ptr]
+    void loadWord(const void *ptr) {
+        movRax((uintptr_t)ptr);
+        byte(0x0F);
+        byte(0xB7);
+        byte(0x00);
+    }
+    // movzx eax, byte [ptr]
+    void loadByte(const void *ptr) {
+        movRax((uintptr_t)ptr);
+        byte(0x0F);
+        byte(0xB6);
+        byte(0x00);
+    }
+    // add eax, imm32; and eax, 0xFFFF
+    void addWord(const int32_t v) {
+        byte(0x05);
+        imm32(v);
+        byte(0x25);
+        imm32(0xFFFF);
+    }
+    // test byte [table + rax], imm8
+    void testTable(const uint8_t *table, const uint8_t mask) {
+        movRcx((uintptr_t)table);
+        byte(0xF6);
+        byte(0x04);
+        byte(0x01);
+        byte(mask);
+    }
+    // cmp dword [ptr], imm32
+    void compareDword(const void *ptr, const uint32_t v) {
+        movRax((uintptr_t)ptr);
+        byte(0x81);
+        byte(0x38);
+        imm32(v);
+    }
+    // call imm64
+    void call(const uint64_t target) {
+        movRax(target);
+        byte(0xFF);
+        byte(0xD0);
+    }
+    // test al, al
+    void testAl() {
+        byte(0x84);
+        byte(0xC0);
+    }
+    // cmovnz eax, ecx
+    void cmovnzEaxEcx() {
+        byte(0x0F);
+        byte(0x45);
+        byte(0xC1);
+    }
+    // cmovz eax, ecx
+    void cmovzEaxEcx() {
+        byte(0x0F);
+        byte(0x44);
+        byte(0xC1);
+    }
+    // test byte [rdx], imm8
+    void testRdx(const uint8_t mask) {
+        byte(0xF6);
+        byte(0x02);
+        byte(mask);
+    }
+    // mov [rdx], ax
+    void storeAxRdx() {
+        byte(0x66);
+        byte(0x89);
+        byte(0x02);
+    }
+    // movabs rdx, imm64
+    void movRdx(const uint64_t v) {
+        byte(0x48);
+        byte(0xBA);
+        imm64(v);
+    }
+    // mov al, [rdx + offset]
+    void loadAlRdx(const uint8_t offset) {
+        byte(0x8A);
+        byte(0x42);
+        byte(offset);
+    }
+    // mov [rdx + offset], al
+    void storeAlRdx(const uint8_t offset) {
+        byte(0x88);
+        byte(0x42);
+        byte(offset);
+    }
+    // bt word [rdx], bit
+    void bitToCarry(const uint8_t bit) {
+        byte(0x66);
+        byte(0x0F);
+        byte(0xBA);
+        byte(0x22);
+        byte(bit);
+    }
+    // <operation> al, [rcx], see hostAlu
+    void aluAlRcx(const uint8_t operation) {
+        byte(hostAlu[operation] + 0x02);
+        byte(0x01);
+    }
+    // <operation> al, imm8, see hostAlu
+    void aluAl(const uint8_t operation, const uint8_t v) {
+        byte(hostAlu[operation] + 0x04);
+        byte(v);
+    }
+    // inc byte [rcx] or dec byte [rcx]
+    void stepByteRcx(const bool decrement) {
+        byte(0xFE);
+        byte(decrement ? 0x09 : 0x01);
+    }
+    // inc word [rcx] or dec word [rcx]
+    void stepWordRcx(const bool decrement) {
+        byte(0x66);
+        byte(0xFF);
+        byte(decrement ? 0x09 : 0x01);
+    }
+    // not byte [rdx + offset]
+    void notRdx(const uint8_t offset) {
+        byte(0xF6);
+        byte(0x52);
+        byte(offset);
+    }
+    // lahf; movzx eax, ah; mov al, [r12 + rax]
+    void flagsFromHost() {
+        byte(0x9F);
+        byte(0x0F);
+        byte(0xB6);
+        byte(0xC4);
+        byte(0x41);
+        byte(0x8A);
+        byte(0x04);
+        byte(0x04);
+    }
+    // jne rel32, returns the location of rel32
+    uint8_t *jne() { return jump(0x85); }
+    // je rel32, returns the location of rel32
+    uint8_t *je() { return jump(0x84); }
+    // jae rel32, returns the location of rel32
+    uint8_t *jae() { return jump(0x83); }
+    // Point a rel32 to the current location
+    void bind(uint8_t *rel) {
+        if (overflowed) {
+            return;
+        }
+        const int32_t distance = cursor - (rel + 4);
+        memcpy(rel, &distance, 4);
+    }
+
+   private:
+    uint8_t *jump(const uint8_t condition) {
+        byte(0x0F);
+        byte(condition);
+        imm32(0);
+        return cursor - 4;
+    }
+};
+
+void Jit::emitAlu(Assembler &a, const uint8_t operation, const uint8_t *src, const uint8_t n, const bool flags) {
+    /**
+     * Emit an 8 bit arithmetic or logical operation on A, see CPU::alu
+     * x86 computes the zero, half carry and carry flags the same way, N is set separately.
+     * @param operation: One of ALU_ADD, ALU_ADC, ALU_SUB, ALU_SBC, ALU_AND, ALU_XOR, ALU_OR, ALU_CP
+     * @param src: Location of the operand register, null for the immediate operand
+     * @param n: The immediate operand
+     * @param flags: False if the flags are overwritten before anything can read them
+     */
+    if (operation == ALU_CP && !flags) {
+        return;
+    }
+
+    a.movRdx((uintptr_t)&CPU::AF);
+    if (operation == ALU_ADC || operation == ALU_SBC) {
+        a.bitToCarry(4);
+    }
+    a.loadAlRdx(1);
+    if (src) {
+        a.movRcx((uintptr_t)src);
+        a.aluAlRcx(operation);
+    } else {
+        a.aluAl(operation, n);
+    }
+    if (operation != ALU_CP) {
+        a.storeAlRdx(1);
+    }
+    if (!flags) {
+        return;
+    }
+    a.flagsFromHost();
+
+    switch (operation) {
+        case ALU_SUB:
+        case ALU_SBC:
+        case ALU_CP:
+            a.aluAl(ALU_OR, 0x40);
+            break;
+        case ALU_AND:
+            // The half carry flag of x86 is undefined after logical operations
+            a.aluAl(ALU_AND, 0x80);
+            a.aluAl(ALU_OR, 0x20);
+            break;
+        case ALU_XOR:
+        case ALU_OR:
+            a.aluAl(ALU_AND, 0x80);
+            break;
+        default:
+            break;
+    }
+    a.storeAlRdx(0);
+}
+
+void Jit::emitStep(Assembler &a, uint8_t *dst, const bool decrement, const bool flags) {
+    /**
+     * Emit INC r or DEC r
+     * x86 leaves the carry flag alone as well, so it is loaded from F first.
+     * @param dst: Location of the register
+     * @param decrement: True for DEC r
+     * @param flags: False if the flags are overwritten before anything can read them
+     */
+    if (!flags) {
+        a.movRcx((uintptr_t)dst);
+        a.stepByteRcx(decrement);
+        return;
+    }
+    a.movRdx((uintptr_t)&CPU::AF);
+    a.bitToCarry(4);
+    a.movRcx((uintptr_t)dst);
+    a.stepByteRcx(decrement);
+    a.flagsFromHost();
+    if (decrement) {
+        a.aluAl(ALU_OR, 0x40);
+    }
+    a.storeAlRdx(0);
+}
+
+void Jit::emitLink(Assembler &a, const uint16_t target, const uint8_t cycles) {
+    /**
+     * Emit the exit to a known address
+     * Jumps right into the code compiled for the target if it's still valid, returns to NativeCode::run otherwise.
+     * @param target: Address of the next instruction
+     * @param cycles: Machine cycles spent since the code was entered or linked to
+     */
+    a.addEbp(cycles);
+    const uint32_t *tag = BlockCache::tag(target);
+    if (tag) {
+        a.movRdx((uintptr_t)tag);
+        a.loadEcxRdx();
+        a.movRax((uintptr_t)&compiled[target]);
+        a.compareEcxRax();
+        uint8_t *const stale = a.jne();
+        a.loadRaxRax(offsetof(Compiled, linked));
+        a.testRax();
+        uint8_t *const missing = a.je();
+        a.jumpRax();
+        a.bind(stale);
+        a.bind(missing);
+    }
+    a.storeWord(&CPU::PC, target);
+    a.cyclesEax(0);
+    a.leave();
+}
+
+bool Jit::emitPointer(Assembler &a, const DecodedOp &op, const uint16_t next, const bool flags) {
+    /**
+     * Emit a load or store through BC, DE or HL, the address is in eax already
+     * Mapped pages are accessed right away, see Memory::readByte and Memory::writeByte. The handler takes care of the others.
+     * @param op: The decoded instruction
+     * @param next: Address of the next instruction
+     * @param flags: False if the flags of ALU (HL) are overwritten before anything can read them
+     * @return False if the instruction is none of those
+     */
+    const uint8_t opcode = op.opcode;
+    const bool load = (opcode >= 0x40 && opcode < 0xC0 && (opcode & 0x07) == 0x06 && opcode != 0x76) || (opcode & 0xCF) == 0x0A;
+    const bool store = (opcode >= 0x70 && opcode < 0x78 && opcode != 0x76) || (opcode & 0xCF) == 0x02 || opcode == 0x36;
+    if (!load && !store) {
+        return false;
+    }
+#ifdef CPU_LAZY_FLAGS
+    if (opcode >= 0x80) {
+        return false;
+    }
+#endif
+
+    a.pageRdx(store ? (const void *)Memory::writePages : (const void *)Memory::readPages);
+    uint8_t *const unmapped = a.je();
+    a.offsetRdx();
+
+    if (store) {
+        a.movRax((uintptr_t)BlockCache::pageGeneration);
+        a.incDwordRaxRcx();
+        if (opcode == 0x36) {
+            a.storeByteRdx(op.operand);
+        } else {
+            a.movRax((uintptr_t)register8(opcode < 0x40 ? 7 : opcode & 0x07));
+            a.loadAlRax();
+            a.storeAlRdx(0);
+        }
+    } else {
+        a.loadAlRdx(0);
+        if (opcode >= 0x80) {
+            a.movRcx((uintptr_t)&memoryOperand);
+            a.storeAlRcx();
+            emitAlu(a, (opcode >> 3) & 0x07, &memoryOperand, 0, flags);
+        } else {
+            a.movRcx((uintptr_t)register8(opcode < 0x40 ? 7 : (opcode >> 3) & 0x07));
+            a.storeAlRcx();
+        }
+    }
+
+    // LD (HL+),A, LD A,(HL+), LD (HL-),A, LD A,(HL-)
+    if (opcode >= 0x20 && opcode < 0x40) {
+        a.movRcx((uintptr_t)&CPU::HL);
+        a.stepWordRcx(opcode >= 0x30);
+    }
+
+    uint8_t *const done = a.jmp();
+    a.bind(unmapped);
+    a.storeWord(&CPU::PC, next);
+    if (op.length > 1) {
+        a.storeWord(&CPU::operand, op.operand);
+    }
+    a.call((uintptr_t)CPU::opTable[opcode].handler);
+    a.bind(done);
+    return true;
+}
+
+uint8_t *Jit::workRam(const DecodedOp &op) {
+    /**
+     * Get the location of the immediate address of LDH and LD A,(nn) or LD (nn),A in WRAM or HRAM
+     * @param op: The decoded instruction
+     * @return The location or null if the address is elsewhere
+     */
+    const uint16_t address = (op.opcode & 0x0F) == 0x00 ? 0xFF00 + op.operand : op.operand;
+    if (address >= MEM_RAM_INTERNAL && address < MEM_RAM_ECHO) {
+        return Memory::wram + (address - MEM_RAM_INTERNAL);
+    } else if (address >= MEM_HIGH_RAM && address < MEM_INT_EN_REG) {
+        return Memory::hram + (address - MEM_HIGH_RAM);
+    }
+    return NULL;
+}
+
+uint8_t *Jit::resolve() {
+    /**
+     * Get the code to continue with after a jump to a computed address, called from compiled code
+     * @return The code compiled for PC past its entry or null if there is none
+     */
+    const uint32_t *tag = BlockCache::tag(CPU::PC);
+    const Compiled &entry = compiled[CPU::PC];
+    return tag && entry.tag == *tag ? entry.linked : NULL;
+}
+
+bool Jit::flagsOverwritten(const BlockCache::Block &block, const uint8_t index, const uint8_t count) {
+    /**
+     * Check if the flags set by an instruction are overwritten before anything can read them
+     * Only instructions translated without exits may be in between.
+     * @param block: The block being compiled
+     * @param index: Index of the instruction setting the flags
+     * @param count: Number of instructions being compiled
+     * @return True if a later ALU operation on a register or an immediate sets all flags
+     */
+    for (uint8_t i = index + 1; i < count; i++) {
+        const uint8_t opcode = block.ops[i].opcode;
+        const bool hl = (opcode & 0x07) == 0x06 || ((opcode >> 3) & 0x07) == 0x06;
+
+        // ADD, SUB, AND, XOR, OR and CP r or n, ADC and SBC read the carry flag
+        if (((opcode >= 0x80 && opcode < 0xC0 && (opcode & 0x07) != 0x06) || (opcode & 0xC7) == 0xC6) && ((opcode >> 3) & 0x07) != ALU_ADC &&
+            ((opcode >> 3) & 0x07) != ALU_SBC) {
+            return true;
+        }
+
+        // NOP, LD r1,r2, LD r,n, LD n,nn, INC nn, DEC nn
+        const bool load = (opcode >= 0x40 && opcode < 0x80 && !hl) || ((opcode & 0xC7) == 0x06 && opcode < 0x40 && opcode != 0x36);
+        const bool pair = (opcode & 0xCF) == 0x01 || (opcode & 0xC7) == 0x03;
+        if (opcode != 0x00 && !load && !pair) {
+            return false;
+        }
+    }
+    return false;
+}
+
+static uint8_t memoryAccess(const DecodedOp &op, uint8_t &mask) {
+    /**
+     * Describe the memory access of an instruction
+     * @param op: The decoded instruction
+     * @param mask: Set to the guard flags that apply to the accessed address
+     * @return The kind of access
+     */
+    const uint8_t opcode = op.opcode;
+    mask = GUARD_READ;
+
+    // LD r,(HL) and ALU (HL)
+    if (opcode >= 0x40 && opcode < 0xC0 && (opcode & 0x07) == 0x06 && opcode != 0x76) {
+        return ACCESS_HL;
+    }
+
+    // LD (HL),r
+    if (opcode >= 0x70 && opcode < 0x78 && opcode != 0x76) {
+        mask = GUARD_WRITE;
+        return ACCESS_HL;
+    }
+
+    switch (opcode) {
+        case 0x02:
+            mask = GUARD_WRITE;
+            return ACCESS_BC;
+        case 0x0A:
+            return ACCESS_BC;
+        case 0x12:
+            mask = GUARD_WRITE;
+            return ACCESS_DE;
+        case 0x1A:
+            return ACCESS_DE;
+
+        case 0x22:
+        case 0x32:
+        case 0x36:
+            mask = GUARD_WRITE;
+            return ACCESS_HL;
+        case 0x2A:
+        case 0x3A:
+            return ACCESS_HL;
+        case 0x34:
+        case 0x35:
+            mask = GUARD_READ | GUARD_WRITE;
+            return ACCESS_HL;
+
+        case 0x08:
+        case 0xE0:
+        case 0xEA:
+            mask = GUARD_WRITE;
+            return ACCESS_STATIC;
+        case 0xF0:
+        case 0xFA:
+            return ACCESS_STATIC;
+
+        case 0xE2:
+            mask = GUARD_WRITE;
+            return ACCESS_C;
+        case 0xF2:
+            return ACCESS_C;
+
+        // PUSH, CALL, RST
+        case 0xC5:
+        case 0xD5:
+        case 0xE5:
+        case 0xF5:
+        case 0xCD:
+        case 0xC4:
+        case 0xCC:
+        case 0xD4:
+        case 0xDC:
+        case 0xC7:
+        case 0xCF:
+        case 0xD7:
+        case 0xDF:
+        case 0xE7:
+        case 0xEF:
+        case 0xF7:
+        case 0xFF:
+            mask = GUARD_WRITE;
+            return ACCESS_PUSH;
+
+        // POP, RET, RETI
+        case 0xC1:
+        case 0xD1:
+        case 0xE1:
+        case 0xF1:
+        case 0xC9:
+        case 0xC0:
+        case 0xC8:
+        case 0xD0:
+        case 0xD8:
+        case 0xD9:
+            return ACCESS_POP;
+
+        case 0xCB:
+            if ((op.operand & 0x07) != 0x06) {
+                return ACCESS_NONE;
+            }
+            // BIT b,(HL) only reads
+            if (op.operand < 0x40 || op.operand >= 0x80) {
+                mask = GUARD_READ | GUARD_WRITE;
+            }
+            return ACCESS_HL;
+
+        default:
+            return ACCESS_NONE;
+    }
+}
+
+uint8_t *Jit::register8(const uint8_t index) {
+    /**
+     * Get the location of an 8 bit register, in opcode order B, C, D, E, H, L, (HL), A
+     * @return The location or null for (HL)
+     */
+    switch (index) {
+        case 0:
+            return (uint8_t *)&CPU::BC + 1;
+        case 1:
+            return (uint8_t *)&CPU::BC;
+        case 2:
+            return (uint8_t *)&CPU::DE + 1;
+        case 3:
+            return (uint8_t *)&CPU::DE;
+        case 4:
+            return (uint8_t *)&CPU::HL + 1;
+        case 5:
+            return (uint8_t *)&CPU::HL;
+        case 7:
+            return (uint8_t *)&CPU::AF + 1;
+        default:
+            return NULL;
+    }
+}
+
+bool Jit::begin() {
+    /**
+     * Allocate the code buffer and set up the address guard
+     * @return False if no executable memory is available
+     */
+    void *buffer = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED) {
+        Serial.println("JIT: Unable to allocate executable memory, falling back to the interpreter");
+        return false;
+    }
+    code = (uint8_t *)buffer;
+    codeCursor = code;
+
+    for (uint32_t location = 0; location <= 0xFFFF; location++) {
+        guard[location] = (NATIVE_GUARD_READ(location) ? GUARD_READ : 0) | (NATIVE_GUARD_WRITE(location) ? GUARD_WRITE : 0);
+    }
+
+    // lahf: SF ZF - AF - PF - CF
+    for (uint16_t value = 0; value <= 0xFF; value++) {
+        hostFlags[value] = ((value & 0x40) << 1) | ((value & 0x10) << 1) | ((value & 0x01) << 4);
+    }
+
+    return true;
+}
+
+void Jit::flush() {
+    /**
+     * Drop all compiled code
+     */
+    for (uint16_t i = 0; i < BLOCK_CACHE_SIZE; i++) {
+        BlockCache::blocks[i].native = NULL;
+        BlockCache::blocks[i].hits = 0;
+    }
+    memset(compiled, 0, sizeof(compiled));
+    codeCursor = code;
+}
+
+void *Jit::find(const uint16_t pc, const uint32_t tag) {
+    /**
+     * Get code compiled earlier for a block that got evicted from the BlockCache since
+     * @param pc: Start address of the block
+     * @param tag: Bank or page generation of the block
+     * @return The native code or null if the block has not been compiled
+     */
+    const Compiled &entry = compiled[pc];
+    return entry.tag == tag ? entry.native : NULL;
+}
+
+bool Jit::compilable(const DecodedOp &op) {
+    /**
+     * Check if an instruction can be part of compiled code
+     * @param op: The decoded instruction
+     * @return False if the instruction has to be interpreted
+     */
+    switch (op.opcode) {
+        // STOP, HALT, DI, EI
+        case 0x10:
+        case 0x76:
+        case 0xF3:
+        case 0xFB:
+            return false;
+
+        case 0xCB:
+            return true;
+
+        default:
+            // Invalid opcodes have no cycle count
+            return CPU::opTable[op.opcode].cycles != 0;
+    }
+}
+
+void Jit::compile(BlockCache::Block &block) {
+    /**
+     * Translate a block into native code
+     * Sets block.native unless the block can't be compiled
+     * @param block: The block to compile
+     */
+    static const bool available = begin();
+    if (!available) {
+        return;
+    }
+
+    struct Exit {
+        uint8_t *jump;
+        uint16_t pc;
+        uint16_t result;
+        bool storePC;
+    };
+
+    Exit exits[BLOCK_MAX_OPS * 8];
+    uint8_t exitCount = 0;
+
+    // Compile the longest prefix the compiled code can handle
+    uint8_t count = 0;
+    uint8_t lead = 0;
+    uint16_t location = block.pc;
+    while (count < block.count) {
+        const DecodedOp &op = block.ops[count];
+        if (!compilable(op)) {
+            break;
+        }
+
+        uint8_t mask;
+        if (memoryAccess(op, mask) == ACCESS_STATIC) {
+            const uint16_t address = (op.opcode == 0xE0 || op.opcode == 0xF0) ? 0xFF00 + op.operand : op.operand;
+            if ((guard[address] & mask) || (op.opcode == 0x08 && (guard[(uint16_t)(address + 1)] & mask))) {
+                break;
+            }
+        }
+
+        if (count > 0) {
+            const DecodedOp &previous = block.ops[count - 1];
+            lead += previous.opcode == 0xCB ? CPU::cbTable[previous.operand].cycles : CPU::opTable[previous.opcode].cycles;
+        }
+        location += op.length;
+        count++;
+    }
+
+    if (count == 0) {
+        return;
+    }
+
+    if (codeCursor + JIT_MAX_BLOCK_SIZE > code + JIT_CODE_SIZE) {
+        flush();
+    }
+
+    // The buffer is never writable and executable at the same time, unlock the pages of this block only
+    uint8_t *const pages = (uint8_t *)((uintptr_t)codeCursor & ~(uintptr_t)(JIT_PAGE_SIZE - 1));
+    const size_t pagesSize = codeCursor + JIT_MAX_BLOCK_SIZE - pages;
+    if (mprotect(pages, pagesSize, PROT_READ | PROT_WRITE) != 0) {
+        return;
+    }
+
+    // Writes to the page of a RAM block end the block
+    const bool ram = block.pc >= MEM_VRAM;
+    const uint8_t page = block.pc >> 8;
+
+    Assembler a(codeCursor, codeCursor + JIT_MAX_BLOCK_SIZE);
+    a.enter(hostFlags);
+    uint8_t *const linked = a.cursor;
+
+    // If the last instruction starts before the next event, all of them do. Otherwise run a copy
+    // of the block that stops in front of the first instruction past the event
+    a.cyclesEax(lead);
+    a.compareEaxEbx();
+    uint8_t *const partial = a.jae();
+
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        const bool checked = pass == 1;
+        if (checked) {
+            a.bind(partial);
+        }
+
+        uint8_t cycles = 0;
+        bool returned = false;
+        location = block.pc;
+
+        for (uint8_t i = 0; i < count; i++) {
+            const DecodedOp &op = block.ops[i];
+            const CPU::OpEntry &entry = op.opcode == 0xCB ? CPU::cbTable[op.operand] : CPU::opTable[op.opcode];
+            const uint16_t next = location + op.length;
+            const bool last = i == count - 1;
+
+            if (checked) {
+                a.cyclesEax(cycles);
+                a.compareEaxEbx();
+                Exit &exit = exits[exitCount++];
+                exit.jump = a.jae();
+                exit.pc = location;
+                exit.result = cycles;
+                exit.storePC = true;
+            }
+
+            // Guard dynamic memory accesses
+            uint8_t mask;
+            const uint8_t access = memoryAccess(op, mask);
+            uint8_t guards = 0;
+            switch (access) {
+                case ACCESS_BC:
+                    a.loadWord(&CPU::BC);
+                    guards = 1;
+                    break;
+                case ACCESS_DE:
+                    a.loadWord(&CPU::DE);
+                    guards = 1;
+                    break;
+                case ACCESS_HL:
+                    a.loadWord(&CPU::HL);
+                    guards = 1;
+                    break;
+                case ACCESS_C:
+                    a.loadByte(&CPU::BC);
+                    a.addWord(0xFF00);
+                    guards = 1;
+                    break;
+                case ACCESS_PUSH:
+                case ACCESS_POP:
+                    guards = 2;
+                    break;
+                default:
+                    break;
+            }
+            for (uint8_t g = 0; g < guards; g++) {
+                if (access == ACCESS_PUSH) {
+                    a.loadWord(&CPU::SP);
+                    a.addWord(-1 - g);
+                } else if (access == ACCESS_POP) {
+                    a.loadWord(&CPU::SP);
+                    if (g) {
+                        a.addWord(1);
+                    }
+                }
+                a.testTable(guard, mask);
+                Exit &exit = exits[exitCount++];
+                exit.jump = a.jne();
+                exit.pc = location;
+                exit.result = cycles | NATIVE_BAILED;
+                exit.storePC = true;
+            }
+
+            // An interrupt may see the flags at the exits in front of each instruction
+            const bool flags = checked || !flagsOverwritten(block, i, count);
+
+            // Translate loads, jumps and, with flags computed right away, arithmetics. Call the handler otherwise
+            const uint8_t opcode = op.opcode;
+            uint8_t *const dst = register8((opcode >> 3) & 0x07);
+            uint8_t *const src = register8(opcode & 0x07);
+
+            if (opcode == 0x00) {
+                // NOP
+            } else if (opcode >= 0x40 && opcode < 0x80 && dst && src) {
+                // LD r1,r2
+                if (dst != src) {
+                    a.copyByte(dst, src);
+                }
+            } else if ((opcode & 0xC7) == 0x06 && opcode < 0x40 && dst) {
+                // LD r,n
+                a.storeByte(dst, op.operand);
+            } else if (opcode == 0x01 || opcode == 0x11 || opcode == 0x21 || opcode == 0x31) {
+                // LD n,nn
+                uint16_t *const targets[] = {&CPU::BC, &CPU::DE, &CPU::HL, &CPU::SP};
+                a.storeWord(targets[opcode >> 4], op.operand);
+            } else if (opcode == 0x03 || opcode == 0x13 || opcode == 0x23 || opcode == 0x33 || opcode == 0x0B || opcode == 0x1B || opcode == 0x2B ||
+                       opcode == 0x3B) {
+                // INC nn, DEC nn
+                uint16_t *const targets[] = {&CPU::BC, &CPU::DE, &CPU::HL, &CPU::SP};
+                a.movRcx((uintptr_t)targets[opcode >> 4]);
+                a.stepWordRcx(opcode & 0x08);
+    #ifndef CPU_LAZY_FLAGS
+            } else if (opcode >= 0x80 && opcode < 0xC0 && src) {
+                // ADD, ADC, SUB, SBC, AND, XOR, OR, CP r
+                emitAlu(a, (opcode >> 3) & 0x07, src, 0, flags);
+            } else if ((opcode & 0xC7) == 0xC6) {
+                // ADD, ADC, SUB, SBC, AND, XOR, OR, CP n
+                emitAlu(a, (opcode >> 3) & 0x07, NULL, op.operand, flags);
+            } else if ((opcode & 0xC6) == 0x04 && dst) {
+                // INC r, DEC r
+                emitStep(a, dst, opcode & 0x01, flags);
+            } else if (opcode == 0x2F || opcode == 0x37 || opcode == 0x3F) {
+                // CPL, SCF, CCF
+                a.movRdx((uintptr_t)&CPU::AF);
+                if (opcode == 0x2F) {
+                    a.notRdx(1);
+                }
+                a.loadAlRdx(0);
+                if (opcode == 0x2F) {
+                    a.aluAl(ALU_OR, 0x60);
+                } else {
+                    a.aluAl(ALU_AND, opcode == 0x37 ? 0x80 : 0x90);
+                    a.aluAl(opcode == 0x37 ? ALU_OR : ALU_XOR, 0x10);
+                }
+                a.storeAlRdx(0);
+            } else if (last && (opcode == 0x20 || opcode == 0x28 || opcode == 0x30 || opcode == 0x38 || opcode == 0xC2 || opcode == 0xCA ||
+                                opcode == 0xD2 || opcode == 0xDA)) {
+                // JR cc,n and JP cc,nn, the condition is encoded in bits 3-4 of the opcode: NZ, Z, NC, C
+                const uint16_t target = opcode < 0x40 ? next + (int8_t)op.operand : op.operand;
+                const bool set = opcode & 0x08;
+                a.movRdx((uintptr_t)&CPU::AF);
+                a.testRdx(opcode & 0x10 ? 0x10 : 0x80);
+                uint8_t *const taken = set ? a.jne() : a.je();
+                emitLink(a, next, cycles + entry.cycles);
+                a.bind(taken);
+                emitLink(a, target, cycles + entry.cyclesTaken);
+                returned = true;
+    #endif
+            } else if (access != ACCESS_NONE && access != ACCESS_STATIC && emitPointer(a, op, next, flags)) {
+                // LD r,(HL), LD (HL),r, ALU (HL) and the like
+            } else if ((opcode == 0xE0 || opcode == 0xEA || opcode == 0xF0 || opcode == 0xFA) && workRam(op)) {
+                // LDH (n),A, LD (nn),A, LDH A,(n), LD A,(nn) on WRAM or HRAM, see Memory::writeByteInternal
+                uint8_t *const target = workRam(op);
+                if (opcode < 0xF0) {
+                    a.copyByte(target, register8(7));
+                    a.movRax((uintptr_t)&BlockCache::pageGeneration[(opcode == 0xE0 ? 0xFF : op.operand >> 8)]);
+                    a.incDwordRax();
+                } else {
+                    a.copyByte(register8(7), target);
+                }
+            } else if (opcode == 0xC3) {
+                // JP nn
+                emitLink(a, op.operand, cycles + entry.cycles);
+                returned = true;
+            } else if (opcode == 0x18) {
+                // JR n
+                emitLink(a, next + (int8_t)op.operand, cycles + entry.cycles);
+                returned = true;
+            } else {
+                a.storeWord(&CPU::PC, next);
+                // 0xCB prefixed opcodes need it too with CPU_COMPACT_CB
+                if (op.length > 1) {
+                    a.storeWord(&CPU::operand, op.operand);
+                }
+                a.call((uintptr_t)entry.handler);
+
+                if (last && BlockCache::endsBlock(opcode)) {
+                    // Conditional branches select their cycles at runtime
+                    if (entry.cyclesTaken != entry.cycles) {
+                        a.testAl();
+                        a.movEax(cycles + entry.cycles);
+                        a.movEcx(cycles + entry.cyclesTaken);
+                        a.cmovnzEaxEcx();
+                        a.addEaxEbp();
+                    } else {
+                        a.cyclesEax(cycles + entry.cycles);
+                    }
+
+                    // RETI enables interrupts after the next instruction, NativeCode::run has to see it
+                    if (opcode != 0xD9) {
+                        a.movEbpEax();
+                        a.call((uintptr_t)&resolve);
+                        a.testRax();
+                        uint8_t *const missing = a.je();
+                        a.jumpRax();
+                        a.bind(missing);
+                        a.cyclesEax(0);
+                    }
+                    a.leave();
+                    returned = true;
+                }
+
+            }
+
+            // Stop when the block rewrote itself
+            if (!last && ram && (mask & GUARD_WRITE) && access != ACCESS_NONE) {
+                a.compareDword(&BlockCache::pageGeneration[page], block.tag);
+                Exit &exit = exits[exitCount++];
+                exit.jump = a.jne();
+                exit.pc = next;
+                exit.result = cycles + entry.cycles;
+                exit.storePC = true;
+            }
+
+            cycles += entry.cycles;
+            location = next;
+        }
+
+        if (!returned) {
+            emitLink(a, location, cycles);
+        }
+    }
+
+    for (uint8_t i = 0; i < exitCount; i++) {
+        a.bind(exits[i].jump);
+        if (exits[i].storePC) {
+            a.storeWord(&CPU::PC, exits[i].pc);
+        }
+        a.cyclesEax(exits[i].result & 0xFF);
+        if (exits[i].result & NATIVE_BAILED) {
+            a.orEax(NATIVE_BAILED);
+        }
+        a.leave();
+    }
+
+    // Code that can't be run anymore has to go, a block that didn't fit is left to the interpreter
+    if (mprotect(pages, pagesSize, PROT_READ | PROT_EXEC) != 0) {
+        flush();
+        return;
+    }
+    if (a.overflowed) {
+        return;
+    }
+
+    block.native = codeCursor;
+    block.entry = 0;
+    compiled[block.pc].tag = block.tag;
+    compiled[block.pc].native = codeCursor;
+    compiled[block.pc].linked = linked;
+    codeCursor = a.cursor;
+}
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#pragma once
+
+#ifdef CPU_JIT
+
+#if !defined(PLATFORM_NATIVE) || !defined(__x86_64__)
+#error "CPU_JIT is only available for the native build on x86-64"
+#endif
+
+#include <Arduino.h>
+
+#include "BlockCache.h"
+
+// Executions of a block before it gets compiled
+#define JIT_HOT_THRESHOLD 8
+
+// Size of the code buffer, all compiled code is dropped once it is full
+#define JIT_CODE_SIZE (4 * 1024 * 1024)
+
+// Upper bound for the code size of a single block
+#define JIT_MAX_BLOCK_SIZE 16384
+
+// Granularity of mprotect
+#define JIT_PAGE_SIZE 4096
+
+class Assembler;
+
+/**
+ * Dynamic recompiler for the native build
+ *
+ * Hot blocks of the BlockCache are translated into x86-64 code. Loads, jumps, INC, DEC and,
+ * unless built with CPU_LAZY_FLAGS, ALU and flag operations on registers and conditional branches
+ * are translated directly. Memory is accessed through the page tables of Memory where it's mapped.
+ * Every other instruction becomes a call to its opcode handler.
+ * A block checks the horizon once, on entry, and takes a copy that checks it in front of every
+ * instruction only if the event falls into the block. Flags nothing reads are not computed.
+ * Blocks jump right into the code of the block they continue with as long as it's still valid,
+ * so compiled code only returns to NativeCode at events and at instructions it can't run.
+ *
+ * Instructions that access I/O or MBC registers drop back to the interpreter, a write
+ * to the page of a running RAM block ends it right after the write.
+ * Blocks that don't fit into JIT_MAX_BLOCK_SIZE or can't be made executable are left to the interpreter.
+ */
+class Jit {
+   public:
+    static void *find(const uint16_t pc, const uint32_t tag);
+    static void compile(BlockCache::Block &block);
+
+   private:
+    static uint8_t *code;
+    static uint8_t *codeCursor;
+
+    // Code compiled for each address and the bank or page generation it was compiled for,
+    // outlives the cache slot of its block
+    struct Compiled {
+        uint32_t tag;
+        void *native;
+        // Past the entry, for compiled code to jump to
+        uint8_t *linked;
+    };
+    static Compiled compiled[0x10000];
+
+    // Addresses compiled code must not touch, see Jit::begin
+    static uint8_t guard[0x10000];
+
+    // Flags register per value of lahf after an x86 operation: ZF, AF and CF become Z, H and C
+    static uint8_t hostFlags[0x100];
+
+    // Memory operand of ALU (HL), see emitPointer
+    static uint8_t memoryOperand;
+
+    static bool begin();
+    static void flush();
+    static bool compilable(const DecodedOp &op);
+    static uint8_t *register8(const uint8_t index);
+    static bool emitPointer(Assembler &a, const DecodedOp &op, const uint16_t next, const bool flags);
+    static uint8_t *workRam(const DecodedOp &op);
+    static uint8_t *resolve();
+    static bool flagsOverwritten(const BlockCache::Block &block, const uint8_t index, const uint8_t count);
+    static void emitAlu(Assembler &a, const uint8_t operation, const uint8_t *src, const uint8_t n, const bool flags);
+    static void emitStep(Assembler &a, uint8_t *dst, const bool decrement, const bool flags);
+    static void emitLink(Assembler &a, const uint16_t target, const uint8_t cycles);
+};
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#include "NativeCode.h"
+
+#ifdef CPU_NATIVE_CODE
+
+#include <Arduino.h>
+
+#include "CPU.h"
+#include "Jit.h"
+#include "Memory.h"
+
+bool NativeCode::interpretNext = false;
+
+uint8_t NativeCode::run(const uint8_t horizon) {
+    /**
+     * Run the native code of the block at PC and of the blocks it continues with
+     * @param horizon Machine cycles until the next scheduled event
+     * @return Machine cycles spent or 0 if the instruction at PC has to be interpreted
+     */
+    if (interpretNext) {
+        interpretNext = false;
+        return 0;
+    }
+
+    const uint8_t limit = horizon < NATIVE_MAX_HORIZON ? horizon : NATIVE_MAX_HORIZON;
+    uint8_t cycles = 0;
+
+    // EI, DI and RETI take effect after the next instruction
+    while (cycles < limit && CPU::enableIRQ == 0 && CPU::disableIRQ == 0) {
+        uint8_t entry;
+        const NativeBlock native = find(CPU::PC, entry);
+        if (!native) {
+            break;
+        }
+
+        BlockCache::cursor = BlockCache::cursorEnd;
+        const uint16_t result = native(limit - cycles, entry);
+        cycles += result & 0xFF;
+
+        // The instruction the block stopped at is up to the interpreter
+        if ((result & NATIVE_BAILED) || (result & 0xFF) == 0) {
+            interpretNext = (result & NATIVE_BAILED) && cycles != 0;
+            break;
+        }
+    }
+
+    return cycles;
+}
+
+NativeBlock NativeCode::find(const uint16_t pc, uint8_t &entry) {
+    /**
+     * Get the native code of the block at pc, compile it if it's due
+     * @param pc: Start address of the block
+     * @param entry: Set to the index of the first instruction to run
+     * @return The native code or null if the block has to be interpreted
+     */
+    if (!startsAt(pc) || !BlockCache::lookup(pc)) {
+        return NULL;
+    }
+
+    // Let the interpreter continue with this block in case it doesn't run here
+    BlockCache::nextPC = pc;
+
+    BlockCache::Block &block = BlockCache::slot(pc);
+    if (!block.native) {
+        if (block.hits == NATIVE_UNAVAILABLE) {
+            return NULL;
+        }
+#ifdef CPU_RECOMPILED
+        if (block.hits == 0 && pc < MEM_VRAM) {
+            block.native = CPU::findRecompiled(block.tag, pc, block.entry);
+        }
+#endif
+#ifdef CPU_JIT
+        if (!block.native && block.hits == 0) {
+            block.native = Jit::find(pc, block.tag);
+        }
+        if (!block.native) {
+            if (++block.hits < JIT_HOT_THRESHOLD) {
+                return NULL;
+            }
+            Jit::compile(block);
+        }
+#endif
+        if (!block.native) {
+            block.hits = NATIVE_UNAVAILABLE;
+            return NULL;
+        }
+    }
+
+    entry = block.entry;
+    return (NativeBlock)block.native;
+}
+
+#endif
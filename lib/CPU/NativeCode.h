@@ -0,0 +1,88 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#pragma once
+
+#include "BlockCache.h"
+
+#ifdef CPU_NATIVE_CODE
+
+#include <Arduino.h>
+#include <Memory.h>
+
+// Result flag of native code that stopped in front of an instruction
+#define NATIVE_BAILED 0x100
+
+// Most machine cycles native code may return, keeps results clear of NATIVE_BAILED and below 0xFF
+#define NATIVE_MAX_CYCLES 0xFE
+
+// Most machine cycles of a single instruction, see opCyclesTaken
+#define NATIVE_MAX_OP_CYCLES 8
+
+// Native code starts no instruction past the horizon, so keeping it below this keeps results within NATIVE_MAX_CYCLES
+#define NATIVE_MAX_HORIZON (NATIVE_MAX_CYCLES - NATIVE_MAX_OP_CYCLES)
+
+// Hit count of blocks without native code
+#define NATIVE_UNAVAILABLE 0xFF
+
+// Addresses native code has to leave to the interpreter:
+// I/O registers have to be accessed in sync with the PPU and timers, writes to cartridge ROM switch banks
+#define NATIVE_GUARD_READ(location)  ((location) >= MEM_IO_REGS && ((location) < MEM_HIGH_RAM || (location) == MEM_INT_EN_REG))
+#define NATIVE_GUARD_WRITE(location) (NATIVE_GUARD_READ(location) || (location) < MEM_VRAM)
+
+// Native code of a block
+// Takes the cycles until the next event and the index of the first instruction to run.
+// Returns the machine cycles spent, NATIVE_BAILED if an instruction was left to the interpreter.
+typedef uint16_t (*NativeBlock)(uint32_t horizon, uint32_t entry);
+
+/**
+ * Runs blocks of native code in place of the interpreter
+ *
+ * Native code either comes from the JIT (CPU_JIT) or from the static recompiler (CPU_RECOMPILED).
+ * It stops in front of the first instruction that would run after the next scheduled event,
+ * so running it yields exactly the same state as interpreting it.
+ * Blocks run back to back until then, as only events and the instructions left to the
+ * interpreter can raise an interrupt or enable one.
+ */
+class NativeCode {
+   public:
+    static uint8_t run(const uint8_t horizon);
+    static bool startsAt(const uint16_t pc);
+
+   private:
+    static bool interpretNext;
+
+    static NativeBlock find(const uint16_t pc, uint8_t &entry);
+};
+
+inline bool NativeCode::startsAt(const uint16_t pc) {
+    /**
+     * Check if native code may run from pc on, cheap enough to check in front of every instruction
+     * @param pc: Address of the next instruction
+     * @return False if pc is in a block the interpreter is in the middle of or native code can't exist there
+     */
+#ifndef CPU_JIT
+    // Only cartridge ROM is recompiled ahead of time
+    if (pc >= MEM_VRAM) {
+        return false;
+    }
+#endif
+    return pc != BlockCache::nextPC || BlockCache::cursor == BlockCache::cursorEnd;
+}
+
+#endif
@@ -0,0 +1,236 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#include "Profiler.h"
+
+#ifdef CPU_PROFILER
+
+#include <Arduino.h>
+#include <Cartridge.h>
+#include <Memory.h>
+
+#ifdef PLATFORM_NATIVE
+#include <stdio.h>
+#endif
+
+Profiler::Sample Profiler::samples[PROFILER_ADDRESS_SLOTS] = {};
+uint64_t Profiler::sampleCount = 0;
+uint64_t Profiler::nextSample = 0;
+
+uint32_t Profiler::opcodes[256] = {};
+uint32_t Profiler::opcodesCB[256] = {};
+uint32_t Profiler::pairs[256 * 256] = {};
+uint16_t Profiler::previousOpcode = 0x100;
+
+uint32_t Profiler::bankSwitches[PROFILER_BANKS] = {};
+uint32_t Profiler::bankSwitchCount = 0;
+uint16_t Profiler::currentBank = 1;
+
+// Addresses that didn't fit into the samples
+static uint64_t lostSamples = 0;
+
+static void rank(uint32_t *ranking, uint32_t *counts, uint32_t index, uint32_t count) {
+    /**
+     * Insert an entry into a ranking of PROFILER_REPORT_SIZE entries sorted by count
+     * @param ranking: Indices of the ranked entries
+     * @param counts: Counts of the ranked entries, 0 for free places
+     */
+    for (uint8_t place = 0; place < PROFILER_REPORT_SIZE && count > 0; place++) {
+        if (count > counts[place]) {
+            const uint32_t swappedIndex = ranking[place];
+            const uint32_t swappedCount = counts[place];
+            ranking[place] = index;
+            counts[place] = count;
+            index = swappedIndex;
+            count = swappedCount;
+        }
+    }
+}
+
+void Profiler::addSample(const uint16_t pc, const uint32_t weight) {
+    /**
+     * Add samples to the instruction at pc
+     * @param pc: Address of the instruction
+     * @param weight: Number of sample periods that elapsed
+     */
+    uint16_t bank = 0;
+    if (pc < MEM_ROM_BANK) {
+        bank = Cartridge::getRomBank(MEM_ROM);
+    } else if (pc < MEM_VRAM) {
+        bank = Cartridge::getRomBank(MEM_ROM_BANK);
+    }
+    const uint32_t key = (uint32_t)bank << 16 | pc;
+    sampleCount += weight;
+
+    // Open addressing, the program runs from far less addresses than there are slots
+    uint32_t slot = (key ^ key >> 13) & (PROFILER_ADDRESS_SLOTS - 1);
+    for (uint16_t probe = 0; probe < PROFILER_ADDRESS_SLOTS; probe++) {
+        Sample &entry = samples[slot];
+        if (entry.count == 0) {
+            entry.key = key;
+        }
+        if (entry.key == key) {
+            entry.count += weight;
+            return;
+        }
+        slot = (slot + 1) & (PROFILER_ADDRESS_SLOTS - 1);
+    }
+    lostSamples += weight;
+}
+
+void Profiler::count(const uint8_t opcode, const uint16_t operand) {
+    /**
+     * Count an instruction run by the interpreter
+     * @param opcode: Opcode of the instruction
+     * @param operand: Immediate data, holding the second opcode byte of 0xCB prefixed instructions
+     */
+    opcodes[opcode]++;
+    if (opcode == 0xCB) {
+        opcodesCB[operand & 0xFF]++;
+    }
+    if (previousOpcode < 0x100) {
+        pairs[previousOpcode << 8 | opcode]++;
+    }
+    previousOpcode = opcode;
+}
+
+void Profiler::bankSwitched() {
+    /**
+     * Count a write to the memory bank controller that switched the ROM bank
+     */
+    const uint16_t bank = Cartridge::getRomBank(MEM_ROM_BANK);
+    if (bank == currentBank) {
+        return;
+    }
+    currentBank = bank;
+    bankSwitchCount++;
+    if (bank < PROFILER_BANKS) {
+        bankSwitches[bank]++;
+    }
+}
+
+void Profiler::printLabel(const uint32_t key, const char *symFile) {
+    /**
+     * Print the label nearest in front of an address
+     * @param key: Bank << 16 | address
+     * @param symFile: Path of a .sym file, or NULL
+     */
+#ifdef PLATFORM_NATIVE
+    FILE *file = symFile ? fopen(symFile, "r") : NULL;
+    if (!file) {
+        return;
+    }
+
+    const uint16_t bank = key >> 16;
+    const uint16_t address = key & 0xFFFF;
+    char line[256];
+    char label[256] = "";
+    int32_t nearest = -1;
+    while (fgets(line, sizeof(line), file)) {
+        // Lines are "BB:AAAA Label", comments start with a semicolon
+        unsigned int symBank, symAddress;
+        char symLabel[256];
+        if (line[0] == ';' || sscanf(line, "%x:%x %255s", &symBank, &symAddress, symLabel) != 3) {
+            continue;
+        }
+        // Banks only tell ROM apart, the RAM banks aren't tracked
+        if ((address < MEM_VRAM && symBank != bank) || symAddress > address || (int32_t)symAddress <= nearest) {
+            continue;
+        }
+        if ((symAddress < MEM_ROM_BANK) != (address < MEM_ROM_BANK) || (symAddress < MEM_VRAM) != (address < MEM_VRAM)) {
+            continue;
+        }
+        nearest = symAddress;
+        strcpy(label, symLabel);
+    }
+    fclose(file);
+
+    if (nearest == address) {
+        Serial.printf("  %s", label);
+    } else if (nearest >= 0) {
+        Serial.printf("  %s+0x%x", label, address - nearest);
+    }
+#endif
+}
+
+void Profiler::report(const char *symFile) {
+    /**
+     * Print where the emulated time went and the most frequent opcodes, opcode pairs and ROM banks
+     * @param symFile: Path of a .sym file to resolve addresses with, or NULL
+     */
+    uint32_t ranking[PROFILER_REPORT_SIZE];
+    uint32_t counts[PROFILER_REPORT_SIZE];
+
+    // Hot addresses
+    memset(counts, 0, sizeof(counts));
+    for (uint16_t i = 0; i < PROFILER_ADDRESS_SLOTS; i++) {
+        rank(ranking, counts, i, samples[i].count);
+    }
+    Serial.printf("Hottest addresses in %llu samples every %u cycles:\n", (unsigned long long)sampleCount, PROFILER_SAMPLE_CYCLES);
+    for (uint8_t place = 0; place < PROFILER_REPORT_SIZE && counts[place]; place++) {
+        const uint32_t key = samples[ranking[place]].key;
+        Serial.printf("  %5.1f%%  %02x:%04x", 100.0 * counts[place] / sampleCount, key >> 16, key & 0xFFFF);
+        printLabel(key, symFile);
+        Serial.printf("\n");
+    }
+    if (lostSamples) {
+        Serial.printf("  %llu samples of addresses that didn't fit\n", (unsigned long long)lostSamples);
+    }
+
+    // Opcodes
+    uint64_t instructions = 0;
+    memset(counts, 0, sizeof(counts));
+    for (uint16_t i = 0; i < 256; i++) {
+        instructions += opcodes[i];
+        rank(ranking, counts, i, opcodes[i]);
+    }
+    Serial.printf("Most frequent opcodes in %llu instructions:\n", (unsigned long long)instructions);
+    for (uint8_t place = 0; place < PROFILER_REPORT_SIZE && counts[place]; place++) {
+        Serial.printf("  %10u  %5.1f%%  %02x\n", counts[place], 100.0 * counts[place] / instructions, ranking[place]);
+    }
+
+    memset(counts, 0, sizeof(counts));
+    for (uint16_t i = 0; i < 256; i++) {
+        rank(ranking, counts, i, opcodesCB[i]);
+    }
+    Serial.printf("Most frequent 0xCB prefixed opcodes:\n");
+    for (uint8_t place = 0; place < PROFILER_REPORT_SIZE && counts[place]; place++) {
+        Serial.printf("  %10u  %5.1f%%  cb %02x\n", counts[place], 100.0 * counts[place] / instructions, ranking[place]);
+    }
+
+    memset(counts, 0, sizeof(counts));
+    for (uint32_t i = 0; i < 256 * 256; i++) {
+        rank(ranking, counts, i, pairs[i]);
+    }
+    Serial.printf("Most frequent opcode pairs:\n");
+    for (uint8_t place = 0; place < PROFILER_REPORT_SIZE && counts[place]; place++) {
+        Serial.printf("  %10u  %5.1f%%  %02x %02x\n", counts[place], 100.0 * counts[place] / instructions, ranking[place] >> 8, ranking[place] & 0xFF);
+    }
+
+    // ROM banks
+    memset(counts, 0, sizeof(counts));
+    for (uint16_t i = 0; i < PROFILER_BANKS; i++) {
+        rank(ranking, counts, i, bankSwitches[i]);
+    }
+    Serial.printf("ROM bank switches: %u\n", bankSwitchCount);
+    for (uint8_t place = 0; place < PROFILER_REPORT_SIZE && counts[place]; place++) {
+        Serial.printf("  %10u  bank %u\n", counts[place], ranking[place]);
+    }
+}
+
+#endif
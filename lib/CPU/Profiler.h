@@ -0,0 +1,91 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#pragma once
+
+#include <Arduino.h>
+#include <CPU.h>
+
+// Machine cycles between two samples of PC
+#define PROFILER_SAMPLE_CYCLES 64
+
+// Number of distinct addresses the samples can hit, must be a power of two
+#define PROFILER_ADDRESS_SLOTS 8192
+
+// Number of ROM banks bank switches are counted for
+#define PROFILER_BANKS 512
+
+// Number of entries listed per section of Profiler::report
+#define PROFILER_REPORT_SIZE 24
+
+/**
+ * Profiler of the emulated program
+ *
+ * Samples the bank and address of the running instruction every PROFILER_SAMPLE_CYCLES, so the
+ * samples show where the emulated time goes, including halted and fast-forwarded cycles.
+ * Opcodes and opcode pairs are counted exactly, as are the switches to each ROM bank.
+ * Only instructions run by the interpreter are seen, so build without CPU_JIT, CPU_RECOMPILED
+ * and CPU_FUSION for complete opcode counts.
+ *
+ * Enabled by building with -DCPU_PROFILER. Takes about 330 KB of RAM, mostly for the opcode pairs,
+ * so it is meant for the native build. There, the report resolves addresses to the labels of a
+ * .sym file as written by RGBDS or no$gmb.
+ */
+class Profiler {
+   public:
+    static void sample(const uint16_t pc);
+    static void count(const uint8_t opcode, const uint16_t operand);
+    static void bankSwitched();
+    static void report(const char *symFile);
+
+   private:
+    struct Sample {
+        // Bank << 16 | address
+        uint32_t key;
+        uint32_t count;
+    };
+
+    static Sample samples[PROFILER_ADDRESS_SLOTS];
+    static uint64_t sampleCount;
+    static uint64_t nextSample;
+
+    static uint32_t opcodes[256];
+    static uint32_t opcodesCB[256];
+    static uint32_t pairs[256 * 256];
+    static uint16_t previousOpcode;
+
+    static uint32_t bankSwitches[PROFILER_BANKS];
+    static uint32_t bankSwitchCount;
+    static uint16_t currentBank;
+
+    static void addSample(const uint16_t pc, const uint32_t weight);
+    static void printLabel(const uint32_t key, const char *symFile);
+};
+
+inline void Profiler::sample(const uint16_t pc) {
+    /**
+     * Sample the instruction at pc if a sample is due
+     * Cycles since the last sample count for it, so time spent halted or skipped isn't lost
+     * @param pc: Address of the instruction about to run
+     */
+    if (CPU::totalCycles >= nextSample) {
+        const uint32_t weight = (CPU::totalCycles - nextSample) / PROFILER_SAMPLE_CYCLES + 1;
+        nextSample += (uint64_t)weight * PROFILER_SAMPLE_CYCLES;
+        addSample(pc, weight);
+    }
+}
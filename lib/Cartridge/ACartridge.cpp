@@ -119,3 +119,8 @@ uint8_t ACartridge::getRomCode() { return romCode; }
 uint8_t ACartridge::getRamCode() { return ramCode; }
 
 char* ACartridge::getGameName() { return name; }
+
+uint16_t ACartridge::getRomBank(uint16_t addr) {
+    // Without an MBC the cartridge ROM is mapped as is
+    return addr < CART_ROM_BANKED ? 0 : 1;
+}
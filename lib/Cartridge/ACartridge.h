@@ -29,6 +29,10 @@ class ACartridge {
     virtual uint8_t readByte(uint16_t addr) = 0;
     // Abstract writeByte. It should be defined in every MBC
     virtual void writeByte(uint16_t addr, uint8_t data) = 0;
+    // ROM bank currently mapped at addr. Carts with an MBC should override this
+    virtual uint16_t getRomBank(uint16_t addr);
+    // Start of the ROM bank currently mapped at addr. It should be defined in every MBC
+    virtual uint8_t* getRomData(uint16_t addr) = 0;
     virtual ~ACartridge();
     uint8_t getCartCode();
     uint8_t getRomCode();
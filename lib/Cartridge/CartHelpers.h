@@ -38,6 +38,7 @@
 #define ROM_CODE      0x148
 #define CART_CODE     0x147
 #define CART_NAME     0x134
+#define CART_CHECKSUM 0x14E
 #define ROM_BANK_SIZE 0x4000
 
 // Cartridge Memory Regions
@@ -56,6 +56,8 @@ uint8_t Cartridge::begin(const uint8_t* data) {
 
 void Cartridge::writeByte(const uint16_t addr, const uint8_t data) { cart->writeByte(addr, data); }
 uint8_t Cartridge::readByte(const uint16_t addr) { return cart->readByte(addr); }
+uint16_t Cartridge::getRomBank(const uint16_t addr) { return cart->getRomBank(addr); }
+const uint8_t* Cartridge::getRomData(const uint16_t addr) { return cart->getRomData(addr); }
 
 void Cartridge::getGameName(char* buf) {
     char* name;
@@ -25,6 +25,8 @@ class Cartridge {
     static uint8_t begin(const uint8_t* data);
     static void writeByte(const uint16_t addr, const uint8_t data);
     static uint8_t readByte(const uint16_t addr);
+    static uint16_t getRomBank(const uint16_t addr);
+    static const uint8_t* getRomData(const uint16_t addr);
     static void getGameName(char* buf);
 
    private:
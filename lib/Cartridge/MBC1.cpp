@@ -238,4 +238,21 @@ void MBC1::writeByte(uint16_t addr, uint8_t data) {
         }
         return;
     }
-}
\ No newline at end of file
+}
+
+uint16_t MBC1::getRomBank(uint16_t addr) {
+    // Mirror the bank selection in readByte
+    if (addr >= CART_ROM_BANKED) {
+        if (romBankCount <= 32) {
+            return primaryBankBits;
+        }
+        return (secondaryBankBits << 5) | primaryBankBits;
+    } else {
+        if (romBankCount <= 32) {
+            return 0;
+        }
+        return secondaryBankBits << 5;
+    }
+}
+
+uint8_t *MBC1::getRomData(uint16_t addr) { return romBanks[getRomBank(addr)]; }
\ No newline at end of file
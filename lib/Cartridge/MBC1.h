@@ -34,6 +34,8 @@ class MBC1 : public ACartridge {
     ~MBC1();
     uint8_t readByte(uint16_t addr) override;
     void writeByte(uint16_t addr, uint8_t data) override;
+    uint8_t* getRomData(uint16_t addr) override;
+    uint16_t getRomBank(uint16_t addr) override;
 
    private:
     // Enable/Disable the RAM
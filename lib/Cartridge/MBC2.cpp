@@ -107,4 +107,13 @@ void MBC2::writeByte(uint16_t addr, uint8_t data) {
     else {
         Serial.printf("ERROR: Attempted to write 0x%04x to invalid address 0x%04x in MBC2 cartridge\n", data, addr);
     }
-}
\ No newline at end of file
+}
+
+uint16_t MBC2::getRomBank(uint16_t addr) {
+    if (addr >= CART_ROM_BANKED) {
+        return romBankSelect;
+    }
+    return 0;
+}
+
+uint8_t *MBC2::getRomData(uint16_t addr) { return romBanks[getRomBank(addr)]; }
\ No newline at end of file
@@ -35,6 +35,8 @@ class MBC2 : public ACartridge {
     ~MBC2();
     uint8_t readByte(uint16_t addr) override;
     void writeByte(uint16_t addr, uint8_t data) override;
+    uint8_t* getRomData(uint16_t addr) override;
+    uint16_t getRomBank(uint16_t addr) override;
 
    private:
     // Enable/Disable the RAM
@@ -96,4 +96,9 @@ void NoMBC::writeByte(uint16_t addr, uint8_t data) {
     } else {
         return;
     }
+}
+
+uint8_t *NoMBC::getRomData(uint16_t addr) {
+    // Both banks are mapped as is
+    return rom + (addr & CART_ROM_BANKED);
 }
\ No newline at end of file
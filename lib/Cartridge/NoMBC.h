@@ -28,6 +28,7 @@ class NoMBC : public ACartridge {
     ~NoMBC();
     uint8_t readByte(uint16_t addr) override;
     void writeByte(uint16_t addr, uint8_t data) override;
+    uint8_t* getRomData(uint16_t addr) override;
 
    private:
     uint8_t* rom;
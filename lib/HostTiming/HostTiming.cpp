@@ -0,0 +1,208 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#include "HostTiming.h"
+
+#ifdef HOST_TIMING
+
+#ifdef PLATFORM_NATIVE
+#include <time.h>
+#endif
+
+static const char *names[HOST_TIMING_COUNT + 1] = {"other", "CPU", "PPU", "upload", "APU", "joypad", "frame"};
+
+uint32_t HostTiming::frames = 0;
+
+volatile uint32_t HostTiming::frameTicks[HOST_TIMING_COUNT] = {0};
+HostTiming::Statistics HostTiming::statistics[HOST_TIMING_COUNT + 1];
+
+volatile uint8_t HostTiming::stack[HOST_TIMING_DEPTH] = {HOST_TIMING_OTHER};
+volatile uint8_t HostTiming::depth = 0;
+volatile uint32_t HostTiming::last = 0;
+
+static inline uint32_t lock() {
+    /**
+     * Keep interrupts from changing the accounting until unlock is called
+     * APU timer interrupts enter and leave their own subsystem at any time.
+     * @return The previous interrupt mask, to be passed to unlock
+     */
+#ifdef PLATFORM_NATIVE
+    return 0;
+#else
+    uint32_t primask;
+    __asm__ volatile("mrs %0, primask\n" : "=r"(primask)::"memory");
+    __disable_irq();
+    return primask;
+#endif
+}
+
+static inline void unlock(const uint32_t primask) {
+    /**
+     * Restore the interrupt mask saved by lock, interrupts stay off if they already were
+     */
+#ifndef PLATFORM_NATIVE
+    if (!primask) {
+        __enable_irq();
+    }
+#endif
+}
+
+uint32_t HostTiming::now() {
+    /**
+     * Read the host's time, wrapping around every few seconds
+     * @return Ticks, see HOST_TIMING_TICKS_PER_US
+     */
+#ifdef PLATFORM_NATIVE
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint32_t)time.tv_sec * 1000000000 + time.tv_nsec;
+#else
+    return ARM_DWT_CYCCNT;
+#endif
+}
+
+void HostTiming::begin() {
+    /**
+     * Start the cycle counter and the accounting
+     */
+#ifndef PLATFORM_NATIVE
+    ARM_DEMCR |= ARM_DEMCR_TRCENA;
+    ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+    reset();
+}
+
+void HostTiming::charge() {
+    /**
+     * Charge the time since the last change to the current subsystem
+     * Interrupts have to be locked out, see lock.
+     */
+    const uint32_t time = now();
+    frameTicks[stack[depth]] += time - last;
+    last = time;
+}
+
+void HostTiming::enter(const uint8_t subsystem) {
+    /**
+     * Account the following time to a subsystem until leave is called
+     */
+    const uint32_t primask = lock();
+    charge();
+    if (depth < HOST_TIMING_DEPTH - 1) {
+        stack[++depth] = subsystem;
+    }
+    unlock(primask);
+}
+
+void HostTiming::leave() {
+    /**
+     * Account the following time to the subsystem that was interrupted by the last enter
+     */
+    const uint32_t primask = lock();
+    charge();
+    if (depth > 0) {
+        depth--;
+    }
+    unlock(primask);
+}
+
+void HostTiming::frame() {
+    /**
+     * Close the current frame and add its times to the statistics
+     */
+    // Take the frame's ticks at once, so interrupts can't add to them in between
+    uint32_t ticksPerSubsystem[HOST_TIMING_COUNT];
+    const uint32_t primask = lock();
+    charge();
+    for (uint8_t subsystem = 0; subsystem < HOST_TIMING_COUNT; subsystem++) {
+        ticksPerSubsystem[subsystem] = frameTicks[subsystem];
+        frameTicks[subsystem] = 0;
+    }
+    unlock(primask);
+
+    uint32_t frameTotal = 0;
+    for (uint8_t subsystem = 0; subsystem <= HOST_TIMING_COUNT; subsystem++) {
+        uint32_t ticks = frameTotal;
+        if (subsystem < HOST_TIMING_COUNT) {
+            ticks = ticksPerSubsystem[subsystem];
+            frameTotal += ticks;
+        }
+
+        Statistics &entry = statistics[subsystem];
+        entry.total += ticks;
+        if (ticks < entry.min) {
+            entry.min = ticks;
+        }
+        if (ticks > entry.max) {
+            entry.max = ticks;
+        }
+        const uint32_t bin = ticks / HOST_TIMING_TICKS_PER_US / HOST_TIMING_BIN_US;
+        entry.histogram[bin < HOST_TIMING_BINS ? bin : HOST_TIMING_BINS - 1]++;
+    }
+    frames++;
+}
+
+void HostTiming::report(Print &out) {
+    /**
+     * Print the time per frame of each subsystem in microseconds
+     * The histograms list the number of frames per HOST_TIMING_BIN_US, the last bin holds all longer frames.
+     */
+    if (frames == 0) {
+        return;
+    }
+
+    const uint32_t ticksPerUs = HOST_TIMING_TICKS_PER_US;
+    const uint64_t frameTotal = statistics[HOST_TIMING_COUNT].total;
+    out.printf("Host time per frame in %u frames:\n", frames);
+    out.printf("  %-7s %8s %8s %8s %7s\n", "", "min us", "avg us", "max us", "share");
+    for (uint8_t subsystem = 0; subsystem <= HOST_TIMING_COUNT; subsystem++) {
+        const Statistics &entry = statistics[subsystem];
+        out.printf("  %-7s %8u %8u %8u %6.1f%%\n", names[subsystem], entry.min / ticksPerUs, (uint32_t)(entry.total / frames / ticksPerUs),
+                   entry.max / ticksPerUs, frameTotal ? 100.0 * entry.total / frameTotal : 0.0);
+    }
+
+    out.printf("Frames per %u us:\n", HOST_TIMING_BIN_US);
+    for (uint8_t subsystem = 0; subsystem <= HOST_TIMING_COUNT; subsystem++) {
+        out.printf("  %-7s", names[subsystem]);
+        for (uint8_t bin = 0; bin < HOST_TIMING_BINS; bin++) {
+            out.printf(" %u", statistics[subsystem].histogram[bin]);
+        }
+        out.printf("\n");
+    }
+}
+
+void HostTiming::reset() {
+    /**
+     * Clear the statistics and start a new frame
+     */
+    for (uint8_t subsystem = 0; subsystem <= HOST_TIMING_COUNT; subsystem++) {
+        Statistics &entry = statistics[subsystem];
+        memset(&entry, 0, sizeof(entry));
+        entry.min = 0xFFFFFFFF;
+    }
+    frames = 0;
+
+    const uint32_t primask = lock();
+    for (uint8_t subsystem = 0; subsystem < HOST_TIMING_COUNT; subsystem++) {
+        frameTicks[subsystem] = 0;
+    }
+    last = now();
+    unlock(primask);
+}
+
+#endif
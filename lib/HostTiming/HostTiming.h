@@ -0,0 +1,101 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#pragma once
+
+#include <Arduino.h>
+
+// Subsystems host time is accounted to
+// Time outside of all others, e.g. the main loop and waiting for the display
+#define HOST_TIMING_OTHER  0
+#define HOST_TIMING_CPU    1
+// Mode changes and line rendering
+#define HOST_TIMING_PPU    2
+// Frame upload to the display
+#define HOST_TIMING_UPLOAD 3
+#define HOST_TIMING_APU    4
+#define HOST_TIMING_JOYPAD 5
+#define HOST_TIMING_COUNT  6
+
+// Maximum nesting of subsystems, e.g. CPU > PPU > upload > APU interrupt
+#define HOST_TIMING_DEPTH 8
+
+// Width and number of the bins of the per frame histograms in microseconds
+#define HOST_TIMING_BIN_US 1000
+#define HOST_TIMING_BINS   20
+
+// Frames between two reports on the Teensy, about 5 seconds
+#define HOST_TIMING_REPORT_FRAMES 300
+
+#ifdef PLATFORM_NATIVE
+// clock_gettime nanoseconds
+#define HOST_TIMING_TICKS_PER_US 1000
+#else
+// DWT cycle counter
+#define HOST_TIMING_TICKS_PER_US (F_CPU_ACTUAL / 1000000)
+#endif
+
+#ifdef HOST_TIMING
+#define HOST_TIMING_ENTER(subsystem) HostTiming::enter(subsystem)
+#define HOST_TIMING_LEAVE()          HostTiming::leave()
+#else
+#define HOST_TIMING_ENTER(subsystem)
+#define HOST_TIMING_LEAVE()
+#endif
+
+/**
+ * Host time spent per subsystem
+ *
+ * Enabled by building with -DHOST_TIMING. Subsystems enter and leave their accounting around
+ * their work, nested subsystems and interrupts are subtracted from the one they interrupted.
+ * The PPU closes each frame at VBlank, which collects the time of each subsystem in that frame
+ * into its minimum, average, maximum and a histogram.
+ * Enter, leave and frame keep interrupts off while they update the accounting, so the APU timer
+ * interrupts always see it consistent.
+ */
+class HostTiming {
+   public:
+    static uint32_t frames;
+
+    static void begin();
+    static void enter(const uint8_t subsystem);
+    static void leave();
+    static void frame();
+    static void report(Print &out);
+    static void reset();
+
+   private:
+    struct Statistics {
+        uint64_t total;
+        uint32_t min;
+        uint32_t max;
+        uint32_t histogram[HOST_TIMING_BINS];
+    };
+
+    // Ticks spent in the current frame per subsystem
+    static volatile uint32_t frameTicks[HOST_TIMING_COUNT];
+    // Per subsystem and for the whole frame
+    static Statistics statistics[HOST_TIMING_COUNT + 1];
+
+    static volatile uint8_t stack[HOST_TIMING_DEPTH];
+    static volatile uint8_t depth;
+    static volatile uint32_t last;
+
+    static uint32_t now();
+    static void charge();
+};
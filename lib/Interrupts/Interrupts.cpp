@@ -0,0 +1,78 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#include "Interrupts.h"
+
+#include <Memory.h>
+
+uint8_t Interrupts::flags = 0;
+uint8_t Interrupts::enable = 0;
+bool Interrupts::master = false;
+
+uint8_t Interrupts::pendingMask = 0;
+bool Interrupts::serviceable = false;
+
+void Interrupts::request(const uint8_t flag) {
+    /**
+     * Request an interrupt by setting its bit in IF
+     */
+    flags |= flag;
+    update();
+}
+
+uint16_t Interrupts::acknowledge() {
+    /**
+     * Start servicing the pending interrupt with the highest priority
+     * Clears its bit in IF as well as IME.
+     * @return Address of its handler
+     */
+    const uint8_t index = __builtin_ctz(pendingMask);
+    flags &= ~(1 << index);
+    master = false;
+    update();
+
+    // The handlers are 8 bytes apart, in order of priority
+    return PC_VBLANK + index * (PC_LCD_STAT - PC_VBLANK);
+}
+
+uint8_t Interrupts::readFlags() { return flags; }
+
+void Interrupts::writeFlags(const uint8_t data) {
+    flags = data;
+    update();
+}
+
+uint8_t Interrupts::readEnable() { return enable; }
+
+void Interrupts::writeEnable(const uint8_t data) {
+    enable = data;
+    update();
+}
+
+void Interrupts::setMaster(const bool enabled) {
+    master = enabled;
+    update();
+}
+
+void Interrupts::update() {
+    /**
+     * Recompute the pending interrupts after IF, IE or IME changed
+     */
+    pendingMask = flags & enable & 0x1F;
+    serviceable = master && pendingMask != 0;
+}
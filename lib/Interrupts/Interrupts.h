@@ -0,0 +1,69 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * Interrupt controller holding IF, IE and IME
+ *
+ * Whether an interrupt is to be serviced is kept up to date whenever one of them changes,
+ * so the CPU only has to test a single flag in front of each operation.
+ */
+class Interrupts {
+   public:
+    static void request(const uint8_t flag);
+    static uint16_t acknowledge();
+
+    static uint8_t readFlags();
+    static void writeFlags(const uint8_t data);
+    static uint8_t readEnable();
+    static void writeEnable(const uint8_t data);
+    static void setMaster(const bool enabled);
+
+    static uint8_t pending();
+    static bool ready();
+
+   private:
+    // IF, IE and IME
+    static uint8_t flags;
+    static uint8_t enable;
+    static bool master;
+
+    // Requested interrupts that are enabled, and whether IME lets them be serviced
+    static uint8_t pendingMask;
+    static bool serviceable;
+
+    static void update();
+};
+
+inline uint8_t Interrupts::pending() {
+    /**
+     * Get the interrupts that are requested and enabled, regardless of IME
+     * These wake up a halted CPU.
+     */
+    return pendingMask;
+}
+
+inline bool Interrupts::ready() {
+    /**
+     * Check whether an interrupt has to be serviced in front of the next operation
+     */
+    return serviceable;
+}
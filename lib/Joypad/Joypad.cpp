@@ -18,7 +18,11 @@
 
 #include "Joypad.h"
 
+#include "CPU.h"
+#include "HostTiming.h"
+#include "Interrupts.h"
 #include "Memory.h"
+#include "Scheduler.h"
 
 joypad_combined_t Joypad::previousValue = {.value = 0xFF};
 
@@ -31,9 +35,37 @@ void Joypad::begin() {
     pinMode(JOYPAD_DOWN, INPUT_PULLUP);
     pinMode(JOYPAD_B, INPUT_PULLUP);
     pinMode(JOYPAD_A, INPUT_PULLUP);
+
+    Memory::attachIO(MEM_JOYPAD, Joypad::writeSelect);
+
+    Scheduler::attach(EVENT_JOYPAD, Joypad::joypadStep);
+    Scheduler::schedule(EVENT_JOYPAD, SCHEDULE_NOW);
 }
 
 void Joypad::joypadStep() {
+    /**
+     * Poll the pins periodically
+     */
+    HOST_TIMING_ENTER(HOST_TIMING_JOYPAD);
+    update();
+    HOST_TIMING_LEAVE();
+    Scheduler::schedule(EVENT_JOYPAD, CPU::totalCycles + JOYPAD_POLL_CYCLES);
+}
+
+void Joypad::writeSelect(const uint16_t location, const uint8_t data) {
+    /**
+     * Select direction or button keys, only the select bits are writable
+     */
+    HOST_TIMING_ENTER(HOST_TIMING_JOYPAD);
+    Memory::writeByteInternal(location, (Memory::readByte(location) & 0xCF) | (data & 0x30), true);
+    update();
+    HOST_TIMING_LEAVE();
+}
+
+void Joypad::update() {
+    /**
+     * Read the pins of the selected keys into the joypad register
+     */
     joypad_register_t joypad = {.value = Memory::readByte(MEM_JOYPAD)};
 
     // Handle direction key input
@@ -47,7 +79,7 @@ void Joypad::joypadStep() {
         Memory::writeByteInternal(MEM_JOYPAD, joypad.value, true);
 
         if ((joypad.value & 0xF) != 0xF && Joypad::previousValue.parts.direction != (joypad.value & 0xF)) {
-            Memory::interrupt(IRQ_JOYPAD);
+            Interrupts::request(IRQ_JOYPAD);
         }
         Joypad::previousValue.parts.direction = joypad.value & 0xF;
     }
@@ -63,7 +95,7 @@ void Joypad::joypadStep() {
         Memory::writeByteInternal(MEM_JOYPAD, joypad.value, true);
 
         if ((joypad.value & 0xF) != 0xF && Joypad::previousValue.parts.button != (joypad.value & 0xF)) {
-            Memory::interrupt(IRQ_JOYPAD);
+            Interrupts::request(IRQ_JOYPAD);
         }
         Joypad::previousValue.parts.button = joypad.value & 0xF;
     }
@@ -30,6 +30,9 @@
 #define JOYPAD_B      22
 #define JOYPAD_A      23
 
+// Machine cycles between reads of the joypad pins
+#define JOYPAD_POLL_CYCLES 1140
+
 typedef union {
     struct {
         unsigned right : 1;
@@ -68,5 +71,8 @@ class Joypad {
    protected:
     static joypad_combined_t previousValue;
 
+    static void writeSelect(const uint16_t location, const uint8_t data);
+    static void update();
+
    private:
 };
\ No newline at end of file
@@ -21,7 +21,13 @@
 #include <Arduino.h>
 #include <string.h>
 
-#include "APU.h"
+#include "BlockCache.h"
+#include "CPU.h"
+#include "Interrupts.h"
+#include "Profiler.h"
+#include "Sprites.h"
+#include "TileCache.h"
+#include "Timer.h"
 
 #define MAX(a, b) (((a) > (b)) ? (a) : (b))
 
@@ -31,218 +37,147 @@ uint8_t Memory::wram[0x2000] = {0};
 uint8_t Memory::oam[0xA0] = {0};
 uint8_t Memory::ioreg[0x80] = {0};
 uint8_t Memory::hram[0x7F] = {0};
-uint8_t Memory::iereg = 0;
 
-void Memory::writeByteInternal(const uint16_t location, const uint8_t data, const bool internal) {
-    uint16_t d;
-    switch (location) {
-        // Handle write to Joypad registers at 0xFF00
-        // Register resides in I/O region
-        case MEM_JOYPAD:
-            if (internal) {
-                ioreg[location - MEM_IO_REGS] = data;
-            } else {
-                ioreg[location - MEM_IO_REGS] = (ioreg[location - MEM_IO_REGS] & 0xCF) | (data & 0x30);
-            }
-            break;
-
-        // Handle writes to LCD Status register
-        // Resides in I/O region
-        case MEM_LCD_STATUS:
-            if (internal) {
-                ioreg[location - MEM_IO_REGS] = data;
-            } else {
-                ioreg[location - MEM_IO_REGS] = (ioreg[location - MEM_IO_REGS] & 0x07) | (data | 0xF8);
-            }
-            break;
+const uint8_t *Memory::readPages[0x100] = {NULL};
+uint8_t *Memory::writePages[0x100] = {NULL};
 
-        // Handle writes to DMA transfer register
-        case MEM_DMA:
-            d = 0x0;
-            // DMA transfers occur from ROM/RAM to OAM in chunks of 0xA0 bytes
-            // The address of ROM/RAM to transfer to OAM is the data * 0x100
-            for (uint16_t s = data * 0x100; s < data * 0x100 + 0xA0; s++) {
-                oam[d] = readByte(s);
-                d++;
-            }
-            break;
+Memory::IOHandler Memory::ioHandlers[0x80] = {NULL};
 
-        // Handle writes to the Divider register
-        // Resides in I/O region
-        case MEM_DIVIDER:
-            if (internal) {
-                ioreg[location - MEM_IO_REGS] = data;
-            } else {
-                // Writes to the divider just clear it
-                ioreg[location - MEM_IO_REGS] = 0x00;
-            }
-            break;
+#ifdef MEMORY_TIMED_DMA
+uint64_t Memory::dmaEnd = 0;
+#endif
 
-        // Sound length counter
-        // Resides in I/O region
-        case MEM_SOUND_NR11:
-            ioreg[location - MEM_IO_REGS] = data;
-            if (!internal) {
-                APU::loadLength1();
-            }
-            break;
-        case MEM_SOUND_NR21:
-            ioreg[location - MEM_IO_REGS] = data;
-            if (!internal) {
-                APU::loadLength2();
-            }
-            break;
-        case MEM_SOUND_NR31:
-            ioreg[location - MEM_IO_REGS] = data;
-            if (!internal) {
-                APU::loadLength3();
-            }
-            break;
-        case MEM_SOUND_NR41:
+void Memory::writeByteInternal(const uint16_t location, const uint8_t data, const bool internal) {
+    // Handle writes to the IE register
+    if (location >= MEM_INT_EN_REG) {
+        Interrupts::writeEnable(data);
+    }
+    // Handle writes to High RAM
+    else if (location >= MEM_HIGH_RAM) {
+        hram[location - MEM_HIGH_RAM] = data;
+        BlockCache::invalidate(location);
+    }
+    // Handle writes to IO registers
+    // Writes by the CPU to registers with side effects go to the handler attached to them
+    else if (location >= MEM_IO_REGS) {
+        const IOHandler handler = ioHandlers[location - MEM_IO_REGS];
+        if (handler && !internal) {
+            handler(location, data);
+        } else {
             ioreg[location - MEM_IO_REGS] = data;
-            if (!internal) {
-                APU::loadLength4();
-            }
-            break;
+        }
+    }
+    // Handle writes to unusable memory
+    else if (location >= MEM_UNUSABLE) {
+        return;
+    }
+    // Handle writes to OAM
+    else if (location >= MEM_SPRITE_ATTR_TABLE) {
+#ifdef MEMORY_TIMED_DMA
+        // OAM is busy while a DMA transfer is running
+        if (CPU::totalCycles < dmaEnd) {
+            return;
+        }
+#endif
+        oam[location - MEM_SPRITE_ATTR_TABLE] = data;
+        Sprites::invalidate();
+    }
+    // Handle writes to echo memory
+    else if (location >= MEM_RAM_ECHO) {
+        // Just write to the beginning of internal RAM
+        wram[location - MEM_RAM_ECHO] = data;
+        BlockCache::invalidate(location - MEM_RAM_ECHO + MEM_RAM_INTERNAL);
+    }
+    // Handle writes to internal Work RAM
+    else if (location >= MEM_RAM_INTERNAL) {
+        wram[location - MEM_RAM_INTERNAL] = data;
+        BlockCache::invalidate(location);
+    }
+    // Handle writes to external cartridge RAM
+    else if (location >= MEM_RAM_EXTERNAL) {
+        Cartridge::writeByte(location, data);
+    }
+    // Handle writes to VRAM
+    else if (location >= MEM_VRAM_TILES) {
+        vram[location - MEM_VRAM_TILES] = data;
+        if (location < MEM_VRAM_MAP1) {
+            TileCache::invalidate(location);
+        }
+    }
+    // Handle writes to cart ROM
+    // These are usually mapped to MBC control registers in the cart
+    else if (location >= MEM_ROM) {
+        Cartridge::writeByte(location, data);
+        mapRom();
+        BlockCache::bankSwitched();
+        CPU::bankSwitched();
+#ifdef CPU_PROFILER
+        Profiler::bankSwitched();
+#endif
+    } else {
+        // Illegal operation
+        Serial.println("Illegal write operation on memory!");
+        Serial.printf("\tAttempted write of 0x%x to 0x%x\n", data, location);
+    }
+}
 
-        // Sound channel disable
-        // Resides in I/O region
-        case MEM_SOUND_NR12:
-            ioreg[location - MEM_IO_REGS] = data;
-            if (!internal) {
-                nrx2_register_t nrx2 = {.value = data};
-                if (nrx2.bits.volume == 0) {
-                    APU::disableDac1();
-                } else {
-                    APU::enableDac1();
-                }
-            }
-            break;
-        case MEM_SOUND_NR22:
-            ioreg[location - MEM_IO_REGS] = data;
-            if (!internal) {
-                nrx2_register_t nrx2 = {.value = data};
-                if (nrx2.bits.volume == 0) {
-                    APU::disableDac2();
-                } else {
-                    APU::enableDac2();
-                }
-            }
-            break;
-        case MEM_SOUND_NR30:
-            ioreg[location - MEM_IO_REGS] = data;
-            if (!internal) {
-                if ((data & 0x80) == 0) {
-                    APU::disableDac3();
-                } else {
-                    APU::enableDac3();
-                }
-            }
-            break;
-        case MEM_SOUND_NR42:
-            ioreg[location - MEM_IO_REGS] = data;
-            if (!internal) {
-                nrx2_register_t nrx2 = {.value = data};
-                if (nrx2.bits.volume == 0) {
-                    APU::disableDac4();
-                } else {
-                    APU::enableDac4();
-                }
-            }
-            break;
+void Memory::attachIO(const uint16_t location, IOHandler handler) {
+    /**
+     * Set the handler for writes by the CPU to an I/O register
+     * The handler is in charge of storing the value, see writeByteInternal.
+     */
+    ioHandlers[location - MEM_IO_REGS] = handler;
+}
 
-        // Sound channel enable
-        // Resides in I/O region
-        case MEM_SOUND_NR14:
-            ioreg[location - MEM_IO_REGS] = data;
-            if (!internal) {
-                if (data >> 7) {
-                    APU::triggerSquare1();
-                }
-            }
-            break;
-        case MEM_SOUND_NR24:
-            ioreg[location - MEM_IO_REGS] = data;
-            if (!internal) {
-                if (data >> 7) {
-                    APU::triggerSquare2();
-                }
-            }
-            break;
-        case MEM_SOUND_NR34:
-            ioreg[location - MEM_IO_REGS] = data;
-            if (!internal) {
-                if (data >> 7) {
-                    APU::triggerWave();
-                }
-            }
-            break;
-        case MEM_SOUND_NR44:
-            ioreg[location - MEM_IO_REGS] = data;
-            if (!internal) {
-                if (data >> 7) {
-                    APU::triggerNoise();
-                }
-            }
-            break;
+void Memory::writeJoypad(const uint16_t location, const uint8_t data) {
+    /**
+     * Only the select bits of the joypad register are writable
+     */
+    ioreg[location - MEM_IO_REGS] = (ioreg[location - MEM_IO_REGS] & 0xCF) | (data & 0x30);
+}
 
-        default:
-            // Handle writes to the IE register
-            if (location >= MEM_INT_EN_REG) {
-                iereg = data;
-            }
-            // Handle writes to High RAM
-            else if (location >= MEM_HIGH_RAM) {
-                hram[location - MEM_HIGH_RAM] = data;
-            }
-            // Handle writes to IO registers
-            else if (location >= MEM_IO_REGS) {
-                ioreg[location - MEM_IO_REGS] = data;
-            }
-            // Handle writes to unusable memory
-            else if (location >= MEM_UNUSABLE) {
-                return;
-            }
-            // Handle writes to OAM
-            else if (location >= MEM_SPRITE_ATTR_TABLE) {
-                oam[location - MEM_SPRITE_ATTR_TABLE] = data;
-            }
-            // Handle writes to echo memory
-            else if (location >= MEM_RAM_ECHO) {
-                // Just write to the beginning of internal RAM
-                wram[location - MEM_RAM_ECHO] = data;
-            }
-            // Handle writes to internal Work RAM
-            else if (location >= MEM_RAM_INTERNAL) {
-                wram[location - MEM_RAM_INTERNAL] = data;
-            }
-            // Handle writes to external cartridge RAM
-            if (location >= MEM_RAM_EXTERNAL) {
-                Cartridge::writeByte(location, data);
-            }
-            // Handle writes to VRAM
-            else if (location >= MEM_VRAM_TILES) {
-                vram[location - MEM_VRAM_TILES] = data;
-            }
-            // Handle writes to cart ROM
-            // These are usually mapped to MBC control registers in the cart
-            else if (location >= MEM_ROM) {
-                Cartridge::writeByte(location, data);
-            } else {
-                // Illegal operation
-                Serial.println("Illegal write operation on memory!");
-                Serial.printf("\tAttempted write of 0x%x to 0x%x\n", data, location);
-            }
-            break;
-    }
+void Memory::writeInterruptFlags(const uint16_t location, const uint8_t data) {
+    /**
+     * IF is kept by the interrupt controller
+     */
+    Interrupts::writeFlags(data);
 }
 
-void Memory::writeByte(const uint16_t location, const uint8_t data) { writeByteInternal(location, data, false); }
+void Memory::writeLcdStatus(const uint16_t location, const uint8_t data) {
+    /**
+     * The mode and coincidence bits of the LCD status register are read only
+     */
+    ioreg[location - MEM_IO_REGS] = (ioreg[location - MEM_IO_REGS] & 0x07) | (data | 0xF8);
+}
+
+void Memory::writeDma(const uint16_t location, const uint8_t data) {
+    /**
+     * Start a DMA transfer
+     * DMA transfers occur from ROM/RAM to OAM in chunks of 0xA0 bytes
+     * The address of ROM/RAM to transfer to OAM is the data * 0x100
+     */
+    ioreg[location - MEM_IO_REGS] = data;
+
+    // Copy plain memory in one go, anything else byte by byte
+    const uint8_t *source = readPages[data];
+    if (source) {
+        memcpy(oam, source, sizeof(oam));
+    } else {
+        for (uint8_t d = 0; d < sizeof(oam); d++) {
+            oam[d] = readByte(data * 0x100 + d);
+        }
+    }
+    Sprites::invalidate();
+
+#ifdef MEMORY_TIMED_DMA
+    dmaEnd = CPU::totalCycles + MEM_DMA_CYCLES;
+#endif
+}
 
-uint8_t Memory::readByte(const uint16_t location) {
+uint8_t Memory::readUnmapped(const uint16_t location) {
     // Handle reads of the IE register
     if (location >= MEM_INT_EN_REG) {
-        return iereg;
+        return Interrupts::readEnable();
     }
     // Handle reads from High RAM
     else if (location >= MEM_HIGH_RAM) {
@@ -250,6 +185,12 @@ uint8_t Memory::readByte(const uint16_t location) {
     }
     // Handle reads from IO registers
     else if (location >= MEM_IO_REGS) {
+        if (location == MEM_DIVIDER || location == MEM_TIMA) {
+            return Timer::readByte(location);
+        }
+        if (location == MEM_IRQ_FLAG) {
+            return Interrupts::readFlags();
+        }
         return ioreg[location - MEM_IO_REGS];
     }
     // Handle reads from unusable memory
@@ -259,6 +200,12 @@ uint8_t Memory::readByte(const uint16_t location) {
     }
     // Handle reads from OAM
     else if (location >= MEM_SPRITE_ATTR_TABLE) {
+#ifdef MEMORY_TIMED_DMA
+        // OAM is busy while a DMA transfer is running
+        if (CPU::totalCycles < dmaEnd) {
+            return 0xFF;
+        }
+#endif
         return oam[location - MEM_SPRITE_ATTR_TABLE];
     }
     // Handle reads from echo memory
@@ -271,7 +218,7 @@ uint8_t Memory::readByte(const uint16_t location) {
         return wram[location - MEM_RAM_INTERNAL];
     }
     // Handle reads from external cartridge RAM
-    if (location >= MEM_RAM_EXTERNAL) {
+    else if (location >= MEM_RAM_EXTERNAL) {
         return Cartridge::readByte(location);
     }
     // Handle reads from VRAM
@@ -288,9 +235,16 @@ uint8_t Memory::readByte(const uint16_t location) {
     }
 }
 
-void Memory::interrupt(uint8_t flag) { writeByte(MEM_IRQ_FLAG, readByte(MEM_IRQ_FLAG) | flag); }
-
 void Memory::initMemory() {
+    // Map plain memory into the page table
+    mapPages();
+
+    // Registers with side effects in memory, peripherals attach to theirs when they begin
+    attachIO(MEM_JOYPAD, writeJoypad);
+    attachIO(MEM_IRQ_FLAG, writeInterruptFlags);
+    attachIO(MEM_LCD_STATUS, writeLcdStatus);
+    attachIO(MEM_DMA, writeDma);
+
     // Init joypad flags
     writeByteInternal(MEM_JOYPAD, 0x2F, true);
 
@@ -314,4 +268,78 @@ void Memory::initMemory() {
     writeByteInternal(0xFF47, 0xFC, true);
     writeByteInternal(0xFF48, 0xFF, true);
     writeByteInternal(0xFF49, 0xFF, true);
+
+    // Pick up the initial ROM banks of the cartridge
+    BlockCache::bankSwitched();
+    CPU::bankSwitched();
+}
+
+const uint8_t *Memory::getFetchWindow(const uint16_t location, uint16_t &start, uint16_t &size) {
+    /**
+     * Get the region of plain memory around location that can be read from directly
+     * The region stays valid until the ROM banks are switched
+     * @param location: The address to fetch from
+     * @param start: Set to the first address of the region
+     * @param size: Set to the size of the region, 0 if location needs handling by readUnmapped
+     * @return The data at start
+     */
+    if (location < MEM_ROM_BANK) {
+        start = MEM_ROM;
+        size = MEM_ROM_BANK - MEM_ROM;
+        return readPages[MEM_ROM >> 8];
+    } else if (location < MEM_VRAM) {
+        start = MEM_ROM_BANK;
+        size = MEM_VRAM - MEM_ROM_BANK;
+        return readPages[MEM_ROM_BANK >> 8];
+    } else if (location < MEM_RAM_EXTERNAL) {
+        start = MEM_VRAM;
+        size = sizeof(vram);
+        return vram;
+    } else if (location >= MEM_RAM_INTERNAL && location < MEM_RAM_ECHO) {
+        start = MEM_RAM_INTERNAL;
+        size = sizeof(wram);
+        return wram;
+    } else if (location >= MEM_HIGH_RAM && location < MEM_INT_EN_REG) {
+        start = MEM_HIGH_RAM;
+        size = sizeof(hram);
+        return hram;
+    }
+
+    start = location;
+    size = 0;
+    return NULL;
+}
+
+void Memory::mapPages() {
+    /**
+     * Map the pages of plain memory
+     * Echo RAM and the VRAM tile data can only be read directly as writes have to invalidate the blocks
+     * of the WRAM page or the decoded tile, OAM, I/O, HRAM and cartridge RAM are always handled by
+     * readUnmapped and writeByteInternal.
+     */
+    for (uint16_t page = 0; page < 0x20; page++) {
+        readPages[(MEM_VRAM >> 8) + page] = vram + (page << 8);
+        if (MEM_VRAM + (page << 8) >= MEM_VRAM_MAP1) {
+            writePages[(MEM_VRAM >> 8) + page] = vram + (page << 8);
+        }
+        readPages[(MEM_RAM_INTERNAL >> 8) + page] = writePages[(MEM_RAM_INTERNAL >> 8) + page] = wram + (page << 8);
+    }
+    for (uint16_t page = MEM_RAM_ECHO >> 8; page < MEM_SPRITE_ATTR_TABLE >> 8; page++) {
+        readPages[page] = wram + ((page << 8) - MEM_RAM_ECHO);
+    }
+
+    mapRom();
+}
+
+void Memory::mapRom() {
+    /**
+     * Map the currently selected ROM banks
+     * Has to be called on every write to the MBC registers
+     */
+    const uint8_t *bank0 = Cartridge::getRomData(MEM_ROM);
+    const uint8_t *bank1 = Cartridge::getRomData(MEM_ROM_BANK);
+    for (uint16_t page = 0; page < 0x40; page++) {
+        readPages[(MEM_ROM >> 8) + page] = bank0 + (page << 8);
+        readPages[(MEM_ROM_BANK >> 8) + page] = bank1 + (page << 8);
+    }
 }
\ No newline at end of file
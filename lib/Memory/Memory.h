@@ -19,6 +19,7 @@
 #pragma once
 
 #include <Arduino.h>
+#include <BlockCache.h>
 #include <Cartridge.h>
 
 #include "MBC1.h"
@@ -258,20 +259,51 @@
 #define MEM_SOUND_NR52       0xFF26
 #define MEM_SOUND_WAVE_START 0xFF30
 
+// Machine cycles of an OAM DMA transfer
+#define MEM_DMA_CYCLES 160
+
 class Memory {
    public:
+    // Handler for writes by the CPU to an I/O register
+    typedef void (*IOHandler)(const uint16_t location, const uint8_t data);
+
     static void initMemory();
+    static void attachIO(const uint16_t location, IOHandler handler);
 
     static void writeByte(const uint16_t location, const uint8_t data);
     static void writeByteInternal(const uint16_t location, const uint8_t data, const bool internal);
     static uint8_t readByte(const uint16_t location);
 
-    static void interrupt(const uint8_t flag);
+    static const uint8_t* getFetchWindow(const uint16_t location, uint16_t& start, uint16_t& size);
+    static const uint8_t* getOam();
 
     static void getTitle(char* title);
 
    protected:
    private:
+    friend class Jit;
+
+    // Pages of 256 bytes that are accessed directly, NULL for those that need handling
+    static const uint8_t* readPages[0x100];
+    static uint8_t* writePages[0x100];
+
+    // Handlers of the I/O registers
+    // Addr: MEM_IO_REGS
+    static IOHandler ioHandlers[0x80];
+
+#ifdef MEMORY_TIMED_DMA
+    // Cycle the running DMA transfer ends at, OAM is inaccessible to the CPU until then
+    static uint64_t dmaEnd;
+#endif
+
+    static void mapPages();
+    static void mapRom();
+    static uint8_t readUnmapped(const uint16_t location);
+    static void writeJoypad(const uint16_t location, const uint8_t data);
+    static void writeInterruptFlags(const uint16_t location, const uint8_t data);
+    static void writeLcdStatus(const uint16_t location, const uint8_t data);
+    static void writeDma(const uint16_t location, const uint8_t data);
+
     // Video RAM
     // Addr: MEM_VRAM
     static uint8_t vram[0x2000];
@@ -287,7 +319,35 @@ class Memory {
     // High RAM
     // Addr: MEM_HIGH_RAM
     static uint8_t hram[0x7F];
-    // Interrupt Enable Register (IE)
-    // Addr: MEM_INT_EN_REG
-    static uint8_t iereg;
 };
+
+inline uint8_t Memory::readByte(const uint16_t location) {
+    /**
+     * Read a byte, directly from the page table if its page is mapped
+     */
+    const uint8_t* page = readPages[location >> 8];
+    if (page) {
+        return page[location & 0xFF];
+    }
+    return readUnmapped(location);
+}
+
+inline const uint8_t* Memory::getOam() {
+    /**
+     * Get OAM for the PPU, which can read it even while a DMA transfer is running
+     */
+    return oam;
+}
+
+inline void Memory::writeByte(const uint16_t location, const uint8_t data) {
+    /**
+     * Write a byte, directly to the page table if its page is mapped
+     */
+    uint8_t* page = writePages[location >> 8];
+    if (page) {
+        page[location & 0xFF] = data;
+        BlockCache::invalidate(location);
+        return;
+    }
+    writeByteInternal(location, data, false);
+}
@@ -57,22 +57,39 @@
 #include <string.h>
 
 #include "CPU.h"
+#include "HostTiming.h"
+#include "Interrupts.h"
 #include "Memory.h"
+#include "Scanline.h"
+#include "Scheduler.h"
+#include "Sprites.h"
+#include "TileCache.h"
 
 #define COLOR1 0x0000
 #define COLOR2 0x4BC4
 #define COLOR3 0x968B
 #define COLOR4 0xFFFF
 
+// Colors of the four shades from white to black
+static const uint16_t shades[4] = {COLOR4, COLOR3, COLOR2, COLOR1};
+
 uint16_t PPU::frames[2][160 * 144] = {{0}, {0}};
-uint64_t PPU::ticks = 0;
+uint16_t PPU::lineBuffer[160] = {0};
+uint16_t PPU::backgroundBuffer[160] = {0};
+uint16_t PPU::colors[16] = {0};
+uint32_t PPU::palettes = 0xFFFFFFFF;
+FT81x *PPU::display = NULL;
 uint8_t PPU::originX = 0, PPU::originY = 0, PPU::lcdc = 0, PPU::lcdStatus = 0;
+uint8_t PPU::line = 0;
+uint8_t PPU::nextMode = PPU_MODE_TRANSFER;
+uint64_t PPU::nextChange = SCHEDULE_NEVER;
+#ifdef PLATFORM_NATIVE
+bool PPU::frameHashes = false;
+#endif
 
-void PPU::getBackgroundForLine(const uint8_t y, uint16_t *frame, const uint8_t originX, const uint8_t originY) {
-    memset(frame + y * 160, 0x33, sizeof(uint16_t) * 160);
+void PPU::getBackgroundForLine(const uint8_t y, uint16_t *buffer, const uint8_t originX, const uint8_t originY) {
     uint8_t lcdc = Memory::readByte(MEM_LCDC);
-    uint8_t tileIndex, tileLineU, tileLineL;
-    int8_t signedTileIndex;
+    uint8_t tileIndex;
 
     uint8_t tilePosY = floor(y / 8) * 8;
     uint8_t tileLineY = y - tilePosY;
@@ -86,174 +103,331 @@ void PPU::getBackgroundForLine(const uint8_t y, uint16_t *frame, const uint8_t o
     }
 
     // Check to see which addressing method is being used for VRAM
-    uint16_t baseTilePtr = MEM_VRAM_TILES_B2;
     bool convertTileIndex = true;
     // If LCDC bit 4 is set, use VRAM Tiles Block0 as a base pointer
     // for the tiles and access them with an unsigned index (0 - 255)
-    // Otherwise, use VRAM Tiles Block1 as a base pointer for the
+    // Otherwise, use VRAM Tiles Block2 as a base pointer for the
     // tiles and access them with a signed index (-128 to 127)
     if ((lcdc & 0x10) == 0x10) {
-        baseTilePtr = MEM_VRAM_TILES;
         convertTileIndex = false;
     }
 
     for (uint8_t i = 0; i < 20; i++) {
         tileIndex = Memory::readByte(bgTileMap + i + 32 * (tilePosY / 8));
         // Check to see if the tile index needs to be converted to a signed number
+        uint16_t tile;
         if (convertTileIndex) {
             // Convert the tile index and use it
-            signedTileIndex = (int8_t)tileIndex;
-            tileLineL = Memory::readByte(baseTilePtr + signedTileIndex * 16 + tileLineY * 2);
-            tileLineU = Memory::readByte(baseTilePtr + signedTileIndex * 16 + tileLineY * 2 + 1);
+            tile = 256 + (int8_t)tileIndex;
         } else {
             // Use the tile index as an unsigned number
-            tileLineL = Memory::readByte(baseTilePtr + tileIndex * 16 + tileLineY * 2);
-            tileLineU = Memory::readByte(baseTilePtr + tileIndex * 16 + tileLineY * 2 + 1);
-        }
-        for (int8_t c = 0; c < 8; c++) {
-            frame[y * 160 + i * 8 + c] = (((tileLineU >> (7 - c)) << 1) & 0x2) | ((tileLineL >> (7 - c)) & 0x1);
+            tile = tileIndex;
         }
+        Scanline::copyRow(buffer + i * 8, TileCache::row(tile, tileLineY));
     }
 }
 
-void PPU::getSpritesForLine(const uint8_t y, uint16_t *frame) {
-    uint8_t spritePosX, spritePosY;
-    uint8_t tileIndex, attributes, tileLineU, tileLineL, pixel;
-    int16_t spriteLineY, x;
-
-    for (uint16_t i = 0xFE00; i < 0xFEA0; i += 4) {
-        spritePosY = Memory::readByte(i) - 16;
-        spriteLineY = y - spritePosY;
-        if (spriteLineY >= 0 && spriteLineY < 8) {
-            spritePosX = Memory::readByte(i + 1) - 8;
-            tileIndex = Memory::readByte(i + 2);
-            attributes = Memory::readByte(i + 3);
-
-            tileLineL = Memory::readByte(MEM_VRAM_TILES + tileIndex * 16 + spriteLineY * 2);
-            tileLineU = Memory::readByte(MEM_VRAM_TILES + tileIndex * 16 + spriteLineY * 2 + 1);
-
-            for (int8_t c = 0; c < 8; c++) {
-                x = spritePosX + c;
-                if (x >= 0) {
-                    if ((attributes & 0x80) == 0 || frame[y * 160 + x] == 0) {
-                        pixel = (((tileLineU >> (7 - c)) << 1) & 0x2) | ((tileLineL >> (7 - c)) & 0x1);
-                        if (pixel != 0) frame[y * 160 + x] = pixel;
-                    }
-                }
+void PPU::getSpritesForLine(const uint8_t y, uint16_t *buffer) {
+    /**
+     * Draw the sprites on a line over the background
+     * Sprites are drawn from the lowest to the highest priority, each opaque pixel replaces the ones
+     * of lower priority sprites. Where a sprite behind the background wins, the background shows
+     * unless its color is 0.
+     */
+    const uint8_t height = (lcdc & 0x04) ? 16 : 8;
+    uint8_t count;
+    const uint8_t *list = Sprites::forLine(y, height, count);
+    if (count == 0) {
+        return;
+    }
+    // Blank lines count as background color 0, PPU_BLANK only stands for the color they're shown with
+    if (lcdc & 0x01) {
+        memcpy(backgroundBuffer, buffer, sizeof(backgroundBuffer));
+    } else {
+        memset(backgroundBuffer, 0, sizeof(backgroundBuffer));
+    }
+
+    for (uint8_t n = 0; n < count; n++) {
+        const Sprites::Sprite &sprite = Sprites::get(list[n]);
+        if (sprite.x <= -8 || sprite.x >= 160) {
+            continue;
+        }
+
+        // Y flip
+        uint8_t row = y - sprite.y;
+        if (sprite.attributes & 0x40) {
+            row = height - 1 - row;
+        }
+        // 8x16 sprites use a pair of tiles, the lower bit of the tile index is ignored
+        const uint16_t tile = height == 16 ? (sprite.tile & 0xFE) + (row >> 3) : sprite.tile;
+        const uint8_t *pixels = TileCache::row(tile, row & 7);
+        // X flip
+        uint8_t flipped[8];
+        if (sprite.attributes & 0x20) {
+            Scanline::flipRow(flipped, pixels);
+            pixels = flipped;
+        }
+
+        const uint8_t palette = (sprite.attributes & 0x10) ? PPU_PALETTE_OBP1 : PPU_PALETTE_OBP0;
+        const bool behindBackground = sprite.attributes & 0x80;
+
+        // Merge all 8 pixels at once unless the sprite is clipped at the edge of the screen
+        if (sprite.x >= 0 && sprite.x <= 160 - 8) {
+            Scanline::mergeSprite(buffer + sprite.x, backgroundBuffer + sprite.x, pixels, palette, behindBackground);
+            continue;
+        }
+
+        for (uint8_t c = 0; c < 8; c++) {
+            const int16_t x = sprite.x + c;
+            if (x >= 0 && x < 160 && pixels[c] != 0) {
+                buffer[x] = (behindBackground && backgroundBuffer[x] != 0) ? backgroundBuffer[x] : palette | pixels[c];
             }
         }
     }
 }
 
-void PPU::mapColorsForFrame(uint16_t *frame) {
-    for (uint16_t i = 0; i < 160 * 144; i++) {
-        frame[i] = (frame[i] == 0x3) ? COLOR1 : ((frame[i] == 0x2) ? COLOR2 : ((frame[i] == 0x1) ? COLOR3 : COLOR4));
+void PPU::mapColorsForLine(const uint8_t y, uint16_t *frame) {
+    /**
+     * Write the line buffer to a line of the frame through the palettes as they are set right now
+     */
+    const uint32_t current = Memory::readByte(MEM_BGP) | Memory::readByte(MEM_OBP0) << 8 | Memory::readByte(MEM_OBP1) << 16;
+    if (current != palettes) {
+        palettes = current;
+        for (uint8_t i = 0; i < 4; i++) {
+            colors[PPU_PALETTE_BG + i] = shades[(palettes >> (2 * i)) & 0x3];
+            colors[PPU_PALETTE_OBP0 + i] = shades[(palettes >> (8 + 2 * i)) & 0x3];
+            colors[PPU_PALETTE_OBP1 + i] = shades[(palettes >> (16 + 2 * i)) & 0x3];
+        }
+        colors[PPU_BLANK] = COLOR4;
+    }
+
+    for (uint8_t x = 0; x < 160; x++) {
+        frame[y * 160 + x] = colors[lineBuffer[x]];
     }
 }
 
-void PPU::ppuStep(FT81x &ft81x) {
-    uint8_t y = Memory::readByte(MEM_LCD_Y) % 152;
-    static uint8_t sendingFrame = 1;
-    static uint8_t calculatingFrame = 0;
+#ifdef PLATFORM_NATIVE
+void PPU::printFrameHash(const uint16_t *frame) {
+    /**
+     * Print the number and the FNV-1a hash of a frame unless it's the same as the previous one
+     */
+    static uint32_t count = 0;
+    static uint64_t previous = 0;
 
-    while (ticks < CPU::totalCycles) {
-        ticks++;
-        const uint8_t cycleTicks = ticks % 114;
-
-        switch (cycleTicks) {
-            case 0:  // reading from OAM memory
-                // TODO: Disable access to OAM during this time
-                lcdStatus = Memory::readByte(MEM_LCD_STATUS);
-                // Set LCD STAT to Mode 2: Searching OAM
-                Memory::writeByteInternal(MEM_LCD_STATUS, (lcdStatus & 0xFC) | 0x02, true);
-                // Trigger an OAM interrupt through LCD STAT if enabled
-                if ((lcdStatus & 0x20) == 0x20) {
-                    Memory::interrupt(IRQ_LCD_STAT);
-                }
-                break;
+    uint64_t hash = 0xCBF29CE484222325;
+    const uint8_t *bytes = (const uint8_t *)frame;
+    for (uint32_t i = 0; i < 2 * 160 * 144; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3;
+    }
+    if (count == 0 || hash != previous) {
+        fprintf(stderr, "Frame %u: %016llx\n", count, (unsigned long long)hash);
+        previous = hash;
+    }
+    count++;
+}
+#endif
+
+void PPU::begin(FT81x &ft81x) {
+    /**
+     * Schedule the PPU to render to the given display
+     */
+    display = &ft81x;
+
+    Memory::attachIO(MEM_LCDC, writeLcdc);
+    Memory::attachIO(MEM_LCD_Y, writeLcdY);
+
+    lcdc = Memory::readByte(MEM_LCDC);
+    line = Memory::readByte(MEM_LCD_Y) % PPU_LINES;
+    nextMode = PPU_MODE_TRANSFER;
+    nextChange = (lcdc & 0x80) ? CPU::totalCycles + PPU_CYCLES_OAM : SCHEDULE_NEVER;
 
-            case 20:  // reading from both OAM and VRAM
-                // TODO: Disable access to all video memory during this time
-                lcdStatus = Memory::readByte(MEM_LCD_STATUS);
-                // Set LCD STAT to mode 0x3, Transfer Data to LCD Driver
-                Memory::writeByteInternal(MEM_LCD_STATUS, (lcdStatus & 0xFC) | 0x03,
-                                          true);  // BUG: Shouldn't this be 0x03? If things break, return 0x03 to 0x02
-                // Check if we the current line is the same as what's in LY Compare (LYC)
-                if (y == Memory::readByte(MEM_LCD_YC)) {
-                    // Set coincidence flag
-                    Memory::writeByteInternal(MEM_LCD_STATUS, (lcdStatus & 0xFB) | 0x04, true);
-                    // Trigger coincidence interrupt through LCD STAT if enabled
-                    if ((lcdStatus & 0x40) == 0x40) {
-                        Memory::interrupt(IRQ_LCD_STAT);
-                    }
-                } else {
-                    // Otherwise, clear the coincidence flag
-                    Memory::writeByteInternal(MEM_LCD_STATUS, (lcdStatus & 0xFB) | 0x00, true);
-                }
+    Scheduler::attach(EVENT_PPU, ppuStep);
+    Scheduler::schedule(EVENT_PPU, nextChange);
+}
+
+void PPU::ppuStep() {
+    /**
+     * Perform all mode changes due up to the current cycle
+     * Each one is due at the exact cycle its interrupts are requested at, so there's usually just one.
+     */
+    HOST_TIMING_ENTER(HOST_TIMING_PPU);
+
+    while (nextChange <= CPU::totalCycles) {
+        switch (nextMode) {
+            case PPU_MODE_OAM:
+                searchOam();
+                nextMode = PPU_MODE_TRANSFER;
+                nextChange += PPU_CYCLES_OAM;
                 break;
 
-            case 43:  // H-Blank and V-Blank period
-                lcdc = Memory::readByte(MEM_LCDC);
-                lcdStatus = Memory::readByte(MEM_LCD_STATUS);
-                // Check if LCD is enabled
-                if ((lcdc & 0x80) == 0x80) {
-                    y = (y + 1) % 152;
-                    // Update the current LCD Y coordinate
-                    Memory::writeByte(MEM_LCD_Y, y);
-                    // Get the X and Y posision of the background map
-                    originY = Memory::readByte(MEM_LCD_SCROLL_Y);
-                    originX = Memory::readByte(MEM_LCD_SCROLL_X);
-                    // Make sure we're in the visible portion of the screen
-                    if (y < 144) {
-                        // Because of how our screen works in the emulator, we
-                        // perform the entire line transfer immediately after
-                        // the Game Boy's "transfer" phase.
-                        // A cycle accurate system would transfer data over,
-                        // pixel by pixel, during the transfer phase. Instead,
-                        // We get the whole line at once as soon as we hit H-Blank
-                        // This will need to be rewritten if we ever need to
-                        // emulate some behavior that takes place mid-scanline
-
-                        // Check if background is enabled
-                        if ((lcdc & 0x01) == 0x01) {
-                            // Get the background for the current line
-                            getBackgroundForLine(y, frames[calculatingFrame], originX, originY);
-                        }
-                        // Check if sprites are enabled
-                        if ((lcdc & 0x02) == 0x02) {
-                            // Get the sprite for the current line
-                            getSpritesForLine(y, frames[calculatingFrame]);
-                        }
-                        // Set LCD STAT to mode 0, During H-Blank
-                        Memory::writeByteInternal(MEM_LCD_STATUS, (lcdStatus & 0xFC) | 0x00, true);
-                        // Trigger H-Blank interrupt through LCD STAT if enabled
-                        if ((lcdStatus & 0x08) == 0x08) {
-                            Memory::interrupt(IRQ_LCD_STAT);
-                        }
-                        // If we're outside viewable area, we're in VBLANK
-                    } else if (y == 144) {
-                        // Set LCD STAT to mode 1, VBlank
-                        Memory::writeByteInternal(MEM_LCD_STATUS, (lcdStatus & 0xFC) | 0x01, true);
-                        // Trigger a VBLANK interrupt
-                        Memory::interrupt(IRQ_VBLANK);
-
-                        // Map colors for the frame
-                        mapColorsForFrame(frames[calculatingFrame]);
-
-                        // Swap the sending and calculating frame
-                        sendingFrame = calculatingFrame;
-                        calculatingFrame = !calculatingFrame;
-                        // Write the sending frame to the screen
-                        ft81x.writeGRAM(0, 2 * 160 * 144, (uint8_t *)frames[sendingFrame]);
-                    }
-                } else {
-                    // If LCD is not enabled, always set LCD STAT to mode 1, Vertical Blanking
-                    Memory::writeByteInternal(MEM_LCD_STATUS, (lcdStatus & 0xFC) | 0x01, true);
-                }
+            case PPU_MODE_TRANSFER:
+                transfer();
+                nextMode = PPU_MODE_HBLANK;
+                nextChange += PPU_CYCLES_TRANSFER;
                 break;
 
             default:
+                hblank();
+                nextMode = PPU_MODE_OAM;
+                nextChange += PPU_CYCLES_LINE - PPU_CYCLES_OAM - PPU_CYCLES_TRANSFER;
                 break;
         }
     }
+
+    HOST_TIMING_LEAVE();
+
+    Scheduler::schedule(EVENT_PPU, nextChange);
+}
+
+void PPU::setMode(const uint8_t mode) {
+    /**
+     * Set the mode bits of the LCD status register
+     */
+    lcdStatus = (Memory::readByte(MEM_LCD_STATUS) & 0xFC) | mode;
+    Memory::writeByteInternal(MEM_LCD_STATUS, lcdStatus, true);
+}
+
+void PPU::searchOam() {
+    /**
+     * Start searching OAM for the sprites of the next line, unless it's in VBlank
+     */
+    // TODO: Disable access to OAM during this time
+    if ((line + 1) % PPU_LINES >= PPU_VISIBLE_LINES) {
+        return;
+    }
+
+    setMode(PPU_MODE_OAM);
+    // Trigger an OAM interrupt through LCD STAT if enabled
+    if ((lcdStatus & 0x20) == 0x20) {
+        Interrupts::request(IRQ_LCD_STAT);
+    }
+}
+
+void PPU::transfer() {
+    /**
+     * Start transferring the next line to the LCD driver and compare LY to LYC
+     */
+    // TODO: Disable access to all video memory during this time
+    if ((line + 1) % PPU_LINES < PPU_VISIBLE_LINES) {
+        setMode(PPU_MODE_TRANSFER);
+    }
+
+    // Check if we the current line is the same as what's in LY Compare (LYC)
+    lcdStatus = Memory::readByte(MEM_LCD_STATUS);
+    if (line == Memory::readByte(MEM_LCD_YC)) {
+        // Set coincidence flag
+        Memory::writeByteInternal(MEM_LCD_STATUS, lcdStatus | 0x04, true);
+        // Trigger coincidence interrupt through LCD STAT if enabled
+        if ((lcdStatus & 0x40) == 0x40) {
+            Interrupts::request(IRQ_LCD_STAT);
+        }
+    } else {
+        // Otherwise, clear the coincidence flag
+        Memory::writeByteInternal(MEM_LCD_STATUS, lcdStatus & 0xFB, true);
+    }
+}
+
+void PPU::hblank() {
+    /**
+     * Move on to the next line and render it, or enter VBlank after the last visible line
+     */
+    static uint8_t sendingFrame = 1;
+    static uint8_t calculatingFrame = 0;
+
+    line = (line + 1) % PPU_LINES;
+    // Update the current LCD Y coordinate
+    Memory::writeByteInternal(MEM_LCD_Y, line, true);
+
+    // Make sure we're in the visible portion of the screen
+    if (line < PPU_VISIBLE_LINES) {
+        // Get the X and Y posision of the background map
+        originY = Memory::readByte(MEM_LCD_SCROLL_Y);
+        originX = Memory::readByte(MEM_LCD_SCROLL_X);
+
+        // Because of how our screen works in the emulator, we
+        // perform the entire line transfer immediately after
+        // the Game Boy's "transfer" phase.
+        // A cycle accurate system would transfer data over,
+        // pixel by pixel, during the transfer phase. Instead,
+        // We get the whole line at once as soon as we hit H-Blank
+        // This will need to be rewritten if we ever need to
+        // emulate some behavior that takes place mid-scanline
+
+        // Check if background is enabled
+        if ((lcdc & 0x01) == 0x01) {
+            // Get the background for the current line
+            getBackgroundForLine(line, lineBuffer, originX, originY);
+        } else {
+            for (uint8_t x = 0; x < 160; x++) {
+                lineBuffer[x] = PPU_BLANK;
+            }
+        }
+        // Check if sprites are enabled
+        if ((lcdc & 0x02) == 0x02) {
+            // Get the sprite for the current line
+            getSpritesForLine(line, lineBuffer);
+        }
+        mapColorsForLine(line, frames[calculatingFrame]);
+        // Set LCD STAT to mode 0, During H-Blank
+        setMode(PPU_MODE_HBLANK);
+        // Trigger H-Blank interrupt through LCD STAT if enabled
+        if ((lcdStatus & 0x08) == 0x08) {
+            Interrupts::request(IRQ_LCD_STAT);
+        }
+        // If we're outside viewable area, we're in VBLANK
+    } else if (line == PPU_VISIBLE_LINES) {
+        // Set LCD STAT to mode 1, VBlank
+        setMode(PPU_MODE_VBLANK);
+        // Trigger a VBLANK interrupt, and through LCD STAT if enabled
+        Interrupts::request(IRQ_VBLANK);
+        if ((lcdStatus & 0x10) == 0x10) {
+            Interrupts::request(IRQ_LCD_STAT);
+        }
+
+        // Swap the sending and calculating frame
+        sendingFrame = calculatingFrame;
+        calculatingFrame = !calculatingFrame;
+        // Write the sending frame to the screen
+        HOST_TIMING_ENTER(HOST_TIMING_UPLOAD);
+        display->writeGRAM(0, 2 * 160 * 144, (uint8_t *)frames[sendingFrame]);
+        HOST_TIMING_LEAVE();
+#ifdef PLATFORM_NATIVE
+        if (frameHashes) {
+            printFrameHash(frames[sendingFrame]);
+        }
+#endif
+#ifdef HOST_TIMING
+        HostTiming::frame();
+#endif
+    }
+}
+
+void PPU::writeLcdc(const uint16_t location, const uint8_t data) {
+    /**
+     * Switch the LCD on or off, which starts or stops the PPU
+     */
+    const uint8_t previous = lcdc;
+    lcdc = data;
+    Memory::writeByteInternal(location, data, true);
+
+    if ((previous & 0x80) && !(data & 0x80)) {
+        // The LCD stays blank at line 0 in mode 0 while it's off
+        line = 0;
+        Memory::writeByteInternal(MEM_LCD_Y, 0, true);
+        setMode(PPU_MODE_HBLANK);
+        nextChange = SCHEDULE_NEVER;
+        Scheduler::schedule(EVENT_PPU, nextChange);
+    } else if (!(previous & 0x80) && (data & 0x80)) {
+        // Start over with line 0 right away, see hblank
+        line = PPU_LINES - 1;
+        nextMode = PPU_MODE_HBLANK;
+        nextChange = CPU::totalCycles;
+        Scheduler::schedule(EVENT_PPU, SCHEDULE_NOW);
+    }
+}
+
+void PPU::writeLcdY(const uint16_t location, const uint8_t data) {
+    /**
+     * LY is read only, the PPU keeps the current line
+     */
 }
@@ -22,21 +22,74 @@
 #include <FT81x.h>
 #include <Memory.h>
 
+// Modes in the LCD status register
+#define PPU_MODE_HBLANK   0
+#define PPU_MODE_VBLANK   1
+#define PPU_MODE_OAM      2
+#define PPU_MODE_TRANSFER 3
+
+// Machine cycles of a line and of its OAM search and transfer modes
+#define PPU_CYCLES_LINE     114
+#define PPU_CYCLES_OAM      20
+#define PPU_CYCLES_TRANSFER 23
+
+// Values in the line buffer are a color index plus the palette it's mapped with
+#define PPU_PALETTE_BG   0
+#define PPU_PALETTE_OBP0 4
+#define PPU_PALETTE_OBP1 8
+// Blank pixel where the background is disabled
+#define PPU_BLANK 12
+
+// Lines per frame, the visible lines followed by VBlank
+#define PPU_LINES         152
+#define PPU_VISIBLE_LINES 144
+
 class PPU {
    public:
-    static void ppuStep(FT81x &ft81x);
+    static void begin(FT81x &ft81x);
+    static void ppuStep();
+
+#ifdef PLATFORM_NATIVE
+    // Print a hash of every frame that differs from the previous one to stderr
+    static bool frameHashes;
+#endif
 
    protected:
+    // Display to send frames to
+    static FT81x *display;
     // Handle to Memory
     static Memory *mem;
     static uint16_t frames[2][160 * 144];
-    static uint64_t ticks;
     static uint8_t originX, originY, lcdc, lcdStatus;
 
-    static void getBackgroundForLine(const uint8_t y, uint16_t *frame, const uint8_t originX, const uint8_t originY);
-    static void getSpritesForLine(const uint8_t y, uint16_t *frame);
-    static void getWindowForLine(const uint8_t y, uint16_t *frame);
-    static void mapColorsForFrame(uint16_t *frame);
+    // Line being composed, see PPU_PALETTE_BG
+    static uint16_t lineBuffer[160];
+    // Background of the line before sprites are drawn, sprites behind the background show where it's 0
+    static uint16_t backgroundBuffer[160];
+    // Colors per line buffer value and the BGP, OBP0 and OBP1 values they are for
+    static uint16_t colors[16];
+    static uint32_t palettes;
+
+    // Current line, the value of LY
+    static uint8_t line;
+    // Mode the PPU changes to next and the cycle it does so, SCHEDULE_NEVER while the LCD is off
+    static uint8_t nextMode;
+    static uint64_t nextChange;
+
+    static void setMode(const uint8_t mode);
+    static void searchOam();
+    static void transfer();
+    static void hblank();
+    static void writeLcdc(const uint16_t location, const uint8_t data);
+    static void writeLcdY(const uint16_t location, const uint8_t data);
+
+    static void getBackgroundForLine(const uint8_t y, uint16_t *buffer, const uint8_t originX, const uint8_t originY);
+    static void getSpritesForLine(const uint8_t y, uint16_t *buffer);
+    static void getWindowForLine(const uint8_t y, uint16_t *buffer);
+    static void mapColorsForLine(const uint8_t y, uint16_t *frame);
+#ifdef PLATFORM_NATIVE
+    static void printFrameHash(const uint16_t *frame);
+#endif
 
    private:
 };
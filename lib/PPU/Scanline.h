@@ -0,0 +1,129 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#pragma once
+
+#include <Arduino.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/**
+ * Composition of 8 pixels of a line at once
+ *
+ * Lines hold one 16 bit value per pixel, the color index until the frame is mapped to colors.
+ * Rows of tiles come from TileCache with one byte per pixel.
+ * Uses SSE2 or NEON on hosts that have it, 32 bit SWAR on two pixels per word otherwise,
+ * which is what the Teensy's Cortex-M7 runs.
+ */
+class Scanline {
+   public:
+    static void copyRow(uint16_t *line, const uint8_t *pixels);
+    static void flipRow(uint8_t *flipped, const uint8_t *pixels);
+    static void mergeSprite(uint16_t *line, const uint16_t *background, const uint8_t *pixels, const uint8_t palette, const bool behindBackground);
+
+   private:
+    static uint32_t zeroLanes(const uint32_t word);
+};
+
+inline uint32_t Scanline::zeroLanes(const uint32_t word) {
+    /**
+     * Find the 16 bit lanes of a word that are 0
+     * @return 0xFFFF in each lane that is 0, 0 in the others
+     */
+    const uint32_t nonZero = (((word & 0x7FFF7FFF) + 0x7FFF7FFF) | word) & 0x80008000;
+    return ((nonZero ^ 0x80008000) >> 15) * 0xFFFF;
+}
+
+inline void Scanline::copyRow(uint16_t *line, const uint8_t *pixels) {
+    /**
+     * Copy a row of 8 pixels into a line
+     */
+#if defined(__SSE2__)
+    const __m128i row = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)pixels), _mm_setzero_si128());
+    _mm_storeu_si128((__m128i *)line, row);
+#elif defined(__ARM_NEON)
+    vst1q_u16(line, vmovl_u8(vld1_u8(pixels)));
+#else
+    for (uint8_t i = 0; i < 8; i += 2) {
+        const uint32_t word = pixels[i] | (uint32_t)pixels[i + 1] << 16;
+        memcpy(line + i, &word, sizeof(word));
+    }
+#endif
+}
+
+inline void Scanline::flipRow(uint8_t *flipped, const uint8_t *pixels) {
+    /**
+     * Mirror a row of 8 pixels horizontally
+     */
+    uint64_t row;
+    memcpy(&row, pixels, sizeof(row));
+    row = __builtin_bswap64(row);
+    memcpy(flipped, &row, sizeof(row));
+}
+
+inline void Scanline::mergeSprite(uint16_t *line, const uint16_t *background, const uint8_t *pixels, const uint8_t palette,
+                                  const bool behindBackground) {
+    /**
+     * Draw a row of 8 sprite pixels over a line
+     * Pixels of color 0 are transparent and leave the line alone. Opaque pixels of sprites behind the background
+     * are replaced by the background wherever its color isn't 0.
+     * @param background: The line as it was before any sprite was drawn
+     * @param palette: Added to the color index of the pixels drawn
+     */
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i sprite = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)pixels), zero);
+    const __m128i current = _mm_loadu_si128((const __m128i *)line);
+    const __m128i transparent = _mm_cmpeq_epi16(sprite, zero);
+    __m128i color = _mm_or_si128(sprite, _mm_set1_epi16(palette));
+    if (behindBackground) {
+        const __m128i back = _mm_loadu_si128((const __m128i *)background);
+        const __m128i uncovered = _mm_cmpeq_epi16(back, zero);
+        color = _mm_or_si128(_mm_and_si128(uncovered, color), _mm_andnot_si128(uncovered, back));
+    }
+    _mm_storeu_si128((__m128i *)line, _mm_or_si128(_mm_and_si128(transparent, current), _mm_andnot_si128(transparent, color)));
+#elif defined(__ARM_NEON)
+    const uint16x8_t sprite = vmovl_u8(vld1_u8(pixels));
+    uint16x8_t color = vorrq_u16(sprite, vdupq_n_u16(palette));
+    if (behindBackground) {
+        const uint16x8_t back = vld1q_u16(background);
+        color = vbslq_u16(vceqq_u16(back, vdupq_n_u16(0)), color, back);
+    }
+    vst1q_u16(line, vbslq_u16(vtstq_u16(sprite, sprite), color, vld1q_u16(line)));
+#else
+    for (uint8_t i = 0; i < 8; i += 2) {
+        const uint32_t sprite = pixels[i] | (uint32_t)pixels[i + 1] << 16;
+        uint32_t current, color = sprite | palette * 0x00010001;
+        memcpy(&current, line + i, sizeof(current));
+        if (behindBackground) {
+            uint32_t back;
+            memcpy(&back, background + i, sizeof(back));
+            const uint32_t uncovered = zeroLanes(back);
+            color = (color & uncovered) | (back & ~uncovered);
+        }
+        const uint32_t shown = ~zeroLanes(sprite);
+        const uint32_t word = (color & shown) | (current & ~shown);
+        memcpy(line + i, &word, sizeof(word));
+    }
+#endif
+}
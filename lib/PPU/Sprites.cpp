@@ -0,0 +1,69 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#include "Sprites.h"
+
+#include "Memory.h"
+
+Sprites::Sprite Sprites::sprites[SPRITE_COUNT];
+uint8_t Sprites::lists[SPRITE_LINES][SPRITES_PER_LINE];
+uint8_t Sprites::counts[SPRITE_LINES] = {0};
+bool Sprites::dirty = true;
+uint8_t Sprites::listHeight = 8;
+
+void Sprites::rebuild(const uint8_t height) {
+    /**
+     * Copy OAM and build the lists of all lines
+     */
+    for (uint8_t line = 0; line < SPRITE_LINES; line++) {
+        counts[line] = 0;
+    }
+
+    const uint8_t *oam = Memory::getOam();
+    for (uint8_t index = 0; index < SPRITE_COUNT; index++) {
+        const uint8_t *entry = oam + index * 4;
+        Sprite &sprite = sprites[index];
+        sprite.y = entry[0] - 16;
+        sprite.x = entry[1] - 8;
+        sprite.tile = entry[2];
+        sprite.attributes = entry[3];
+
+        // Sprites off screen to the left or right still count for the limit per line
+        const int16_t top = sprite.y < 0 ? 0 : sprite.y;
+        const int16_t bottom = sprite.y + height < SPRITE_LINES ? sprite.y + height : SPRITE_LINES;
+        for (int16_t line = top; line < bottom; line++) {
+            uint8_t &count = counts[line];
+            if (count == SPRITES_PER_LINE) {
+                continue;
+            }
+
+            // Insert in front of the sprites it has a lower priority than, those with a smaller or the same X
+            uint8_t *list = lists[line];
+            uint8_t position = count;
+            while (position > 0 && sprites[list[position - 1]].x <= sprite.x) {
+                list[position] = list[position - 1];
+                position--;
+            }
+            list[position] = index;
+            count++;
+        }
+    }
+
+    dirty = false;
+    listHeight = height;
+}
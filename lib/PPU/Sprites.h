@@ -0,0 +1,94 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#pragma once
+
+#include <Arduino.h>
+
+// Number of sprites in OAM
+#define SPRITE_COUNT 40
+
+// Maximum number of sprites shown on a line
+#define SPRITES_PER_LINE 10
+
+// Number of lines sprites are listed for, the visible ones
+#define SPRITE_LINES 144
+
+/**
+ * Sprites per line
+ *
+ * Keeps a copy of OAM and a list of the sprites on each visible line, so rendering a line
+ * doesn't have to look at all sprites. Like the hardware, only the first SPRITES_PER_LINE sprites
+ * in OAM that are on a line are shown. The lists are in drawing order, the sprite with the
+ * highest priority (smallest X, then first in OAM) last.
+ * Writes to OAM and DMA transfers mark the lists as dirty, they're rebuilt before the next line is rendered.
+ */
+class Sprites {
+   public:
+    struct Sprite {
+        // Screen position of the top left pixel
+        int16_t x;
+        int16_t y;
+        uint8_t tile;
+        uint8_t attributes;
+    };
+
+    static void invalidate();
+    static const uint8_t *forLine(const uint8_t y, const uint8_t height, uint8_t &count);
+    static const Sprite &get(const uint8_t index);
+
+   private:
+    static Sprite sprites[SPRITE_COUNT];
+    static uint8_t lists[SPRITE_LINES][SPRITES_PER_LINE];
+    static uint8_t counts[SPRITE_LINES];
+    static bool dirty;
+    // Height of the sprites the lists were built for
+    static uint8_t listHeight;
+
+    static void rebuild(const uint8_t height);
+};
+
+inline void Sprites::invalidate() {
+    /**
+     * Mark the lists as dirty
+     * Has to be called on every write to OAM
+     */
+    dirty = true;
+}
+
+inline const uint8_t *Sprites::forLine(const uint8_t y, const uint8_t height, uint8_t &count) {
+    /**
+     * Get the sprites on a line
+     * @param y: Visible line
+     * @param height: Height of the sprites, 8 or 16
+     * @param count: Set to the number of sprites
+     * @return Indices of the sprites in drawing order
+     */
+    if (dirty || height != listHeight) {
+        rebuild(height);
+    }
+    count = counts[y];
+    return lists[y];
+}
+
+inline const Sprites::Sprite &Sprites::get(const uint8_t index) {
+    /**
+     * Get a sprite by its index in OAM
+     */
+    return sprites[index];
+}
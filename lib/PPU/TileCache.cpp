@@ -0,0 +1,49 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#include "TileCache.h"
+
+#include <string.h>
+
+uint8_t TileCache::pixels[TILE_COUNT][64];
+
+// All tiles need decoding before their first use
+uint8_t TileCache::dirty[TILE_COUNT / 8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                           0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                           0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+uint64_t TileCache::spread(const uint8_t bits) {
+    /**
+     * Spread the bits of a bit plane to the bytes of its pixels, the highest bit to the first byte in memory (little endian)
+     * The multiplication puts a copy of the bits in front of each byte, the shift and mask keep the right bit of each.
+     */
+    return ((bits * 0x8040201008040201ULL) >> 7) & 0x0101010101010101ULL;
+}
+
+void TileCache::decode(const uint16_t tile) {
+    /**
+     * Decode all rows of a tile from its bit planes
+     * Each row is stored in two bytes, the first one holding the lower bit of each pixel.
+     */
+    const uint16_t address = MEM_VRAM_TILES + tile * 16;
+    for (uint8_t y = 0; y < 8; y++) {
+        const uint64_t row = spread(Memory::readByte(address + y * 2)) | spread(Memory::readByte(address + y * 2 + 1)) << 1;
+        memcpy(pixels[tile] + y * 8, &row, sizeof(row));
+    }
+    dirty[tile >> 3] &= ~(1 << (tile & 7));
+}
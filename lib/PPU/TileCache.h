@@ -0,0 +1,68 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#pragma once
+
+#include <Arduino.h>
+#include <Memory.h>
+
+// Number of tiles in VRAM, from MEM_VRAM_TILES up to MEM_VRAM_MAP1
+#define TILE_COUNT 384
+
+/**
+ * Cache of decoded tiles
+ *
+ * Holds the 2 bit color index of each pixel of every tile, one byte per pixel and row by row,
+ * so the renderer can copy a row of 8 pixels instead of decoding it from its two bit planes.
+ * Writes to the tile data mark the tile as dirty, it's decoded again the next time it's used.
+ */
+class TileCache {
+   public:
+    static void invalidate(const uint16_t location);
+    static const uint8_t *row(const uint16_t tile, const uint8_t y);
+
+   private:
+    static uint8_t pixels[TILE_COUNT][64];
+    static uint8_t dirty[TILE_COUNT / 8];
+
+    static uint64_t spread(const uint8_t bits);
+    static void decode(const uint16_t tile);
+};
+
+inline void TileCache::invalidate(const uint16_t location) {
+    /**
+     * Mark the tile at location as dirty
+     * Has to be called on every write to the tile data
+     * @param location: The address being written
+     */
+    const uint16_t tile = (location - MEM_VRAM_TILES) >> 4;
+    dirty[tile >> 3] |= 1 << (tile & 7);
+}
+
+inline const uint8_t *TileCache::row(const uint16_t tile, const uint8_t y) {
+    /**
+     * Get a row of a tile
+     * @param tile: Tile number, counting from MEM_VRAM_TILES
+     * @param y: Row within the tile
+     * @return Color indices of the 8 pixels from left to right
+     */
+    if (dirty[tile >> 3] & (1 << (tile & 7))) {
+        decode(tile);
+    }
+    return pixels[tile] + y * 8;
+}
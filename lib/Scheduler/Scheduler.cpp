@@ -0,0 +1,78 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#include "Scheduler.h"
+
+Scheduler::Handler Scheduler::handlers[EVENT_COUNT] = {NULL};
+uint64_t Scheduler::deadlines[EVENT_COUNT] = {SCHEDULE_NEVER, SCHEDULE_NEVER, SCHEDULE_NEVER};
+uint64_t Scheduler::next = SCHEDULE_NEVER;
+uint64_t Scheduler::dispatched = 0;
+
+void Scheduler::attach(const uint8_t event, Handler handler) {
+    /**
+     * Set the handler of an event
+     * Events without a handler are never scheduled
+     */
+    handlers[event] = handler;
+}
+
+void Scheduler::schedule(const uint8_t event, const uint64_t deadline) {
+    /**
+     * Schedule an event, replacing its previous deadline
+     * @param deadline Machine cycle to dispatch the event at, SCHEDULE_NOW to dispatch it before the next operation
+     */
+    if (!handlers[event]) {
+        return;
+    }
+
+    const uint64_t previous = deadlines[event];
+    deadlines[event] = deadline;
+
+    if (deadline < next) {
+        next = deadline;
+    } else if (previous == next) {
+        update();
+    }
+}
+
+void Scheduler::dispatch(const uint64_t now) {
+    /**
+     * Call the handlers of all events due at the given cycle
+     */
+    dispatched = now;
+    for (uint8_t event = 0; event < EVENT_COUNT; event++) {
+        if (deadlines[event] <= now) {
+            deadlines[event] = SCHEDULE_NEVER;
+            handlers[event]();
+        }
+    }
+
+    update();
+}
+
+void Scheduler::update() {
+    /**
+     * Find the earliest deadline
+     */
+    next = SCHEDULE_NEVER;
+    for (uint8_t event = 0; event < EVENT_COUNT; event++) {
+        if (deadlines[event] < next) {
+            next = deadlines[event];
+        }
+    }
+}
@@ -0,0 +1,76 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#pragma once
+
+#include <Arduino.h>
+
+// Events in the order they are dispatched when due at the same cycle
+#define EVENT_PPU    0
+#define EVENT_JOYPAD 1
+#define EVENT_TIMER  2
+#define EVENT_COUNT  3
+
+// Deadline of events to dispatch before the next operation
+#define SCHEDULE_NOW 0
+
+// Deadline of events that aren't scheduled
+#define SCHEDULE_NEVER 0xFFFFFFFFFFFFFFFFULL
+
+/**
+ * Cycle based event scheduler
+ *
+ * Peripherals attach a handler per event and schedule it at an absolute machine cycle.
+ * CPU::run performs operations up to the earliest deadline and dispatches all due events
+ * in front of the next operation, which is when the peripherals used to be polled.
+ * Handlers reschedule their event if it is periodic.
+ */
+class Scheduler {
+   public:
+    typedef void (*Handler)();
+
+    static void attach(const uint8_t event, Handler handler);
+    static void schedule(const uint8_t event, const uint64_t deadline);
+    static void dispatch(const uint64_t now);
+    static uint64_t nextDeadline();
+    static uint64_t lastDispatch();
+
+   private:
+    static Handler handlers[EVENT_COUNT];
+    static uint64_t deadlines[EVENT_COUNT];
+    static uint64_t next;
+    static uint64_t dispatched;
+
+    static void update();
+};
+
+inline uint64_t Scheduler::nextDeadline() {
+    /**
+     * Get the deadline of the earliest event
+     * @return Machine cycle
+     */
+    return next;
+}
+
+inline uint64_t Scheduler::lastDispatch() {
+    /**
+     * Get the cycle events were last dispatched at
+     * @return Machine cycle
+     */
+    return dispatched;
+}
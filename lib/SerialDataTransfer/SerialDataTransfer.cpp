@@ -20,10 +20,21 @@
 
 #include "Memory.h"
 
-void SerialDataTransfer::serialStep() {
-    const uint8_t sc = Memory::readByte(MEM_SERIAL_SC);
+void SerialDataTransfer::begin() {
+    /**
+     * Send serial data once a transfer was requested
+     */
+    Memory::attachIO(MEM_SERIAL_SC, writeControl);
+}
+
+void SerialDataTransfer::writeControl(const uint16_t location, const uint8_t sc) {
+    /**
+     * Start a transfer if requested with the internal clock, it completes right away
+     */
     if ((sc & 0x81) == 0x81) {
         Serial.print((char)Memory::readByte(MEM_SERIAL_SB));
-        Memory::writeByteInternal(MEM_SERIAL_SC, sc & 0x7F, true);
+        Memory::writeByteInternal(location, sc & 0x7F, true);
+    } else {
+        Memory::writeByteInternal(location, sc, true);
     }
 }
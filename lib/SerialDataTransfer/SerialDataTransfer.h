@@ -19,10 +19,13 @@
 
 #pragma once
 
+#include <Arduino.h>
+
 class SerialDataTransfer {
    public:
-    static void serialStep();
+    static void begin();
 
    protected:
    private:
+    static void writeControl(const uint16_t location, const uint8_t sc);
 };
@@ -0,0 +1,160 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#include "Timer.h"
+
+#include <CPU.h>
+#include <Interrupts.h>
+#include <Memory.h>
+#include <Scheduler.h>
+
+uint8_t Timer::divider = 0;
+uint8_t Timer::dividerCycles = 0;
+uint64_t Timer::dividerSync = 0;
+
+uint8_t Timer::counter = 0;
+uint8_t Timer::counterCycles = 0;
+uint64_t Timer::counterSync = 0;
+
+uint8_t Timer::counterPeriod = 250;
+bool Timer::counterEnabled = false;
+
+void Timer::begin() {
+    /**
+     * Start counting at the current cycle
+     */
+    dividerSync = counterSync = CPU::totalCycles;
+    Scheduler::attach(EVENT_TIMER, overflow);
+
+    Memory::attachIO(MEM_DIVIDER, writeByte);
+    Memory::attachIO(MEM_TIMA, writeByte);
+    Memory::attachIO(MEM_TIMER_CONTROL, writeByte);
+}
+
+uint8_t Timer::readByte(const uint16_t location) {
+    /**
+     * Read DIV or TIMA
+     */
+    if (location == MEM_DIVIDER) {
+        syncDivider();
+        return divider;
+    }
+
+    syncCounter();
+    return counter;
+}
+
+void Timer::writeByte(const uint16_t location, const uint8_t data) {
+    /**
+     * Write DIV, TIMA or TAC
+     */
+    Memory::writeByteInternal(location, data, true);
+
+    switch (location) {
+        case MEM_DIVIDER:
+            // Writes to the divider just clear it
+            syncDivider();
+            divider = 0;
+            break;
+
+        case MEM_TIMA:
+            syncCounter();
+            counter = data;
+            scheduleOverflow();
+            break;
+
+        case MEM_TIMER_CONTROL:
+            syncCounter();
+            counterEnabled = data & 0x04;
+            // Check the TAC Input Clock Select field
+            switch (data & 0x03) {
+                case 3:
+                    counterPeriod = 64;
+                    break;
+
+                case 2:
+                    counterPeriod = 16;
+                    break;
+
+                case 1:
+                    counterPeriod = 4;
+                    break;
+
+                default:
+                    counterPeriod = 250;
+                    break;
+            }
+            counterCycles %= counterPeriod;
+            scheduleOverflow();
+            break;
+    }
+}
+
+void Timer::syncDivider() {
+    /**
+     * Bring DIV up to date with the current cycle
+     */
+    const uint64_t cycles = dividerCycles + (CPU::totalCycles - dividerSync);
+    dividerSync = CPU::totalCycles;
+
+    divider += cycles / DIVIDER_CYCLES;
+    dividerCycles = cycles % DIVIDER_CYCLES;
+}
+
+void Timer::syncCounter() {
+    /**
+     * Bring TIMA up to date with the current cycle
+     * An overflow reloads TIMA from TMA and requests the timer interrupt.
+     */
+    const uint64_t cycles = counterCycles + (CPU::totalCycles - counterSync);
+    counterSync = CPU::totalCycles;
+
+    if (!counterEnabled) {
+        return;
+    }
+
+    const uint16_t value = counter + cycles / counterPeriod;
+    counterCycles = cycles % counterPeriod;
+
+    if (value > 0xFF) {
+        counter = Memory::readByte(MEM_TMA) + value - 0x100;
+        Interrupts::request(IRQ_TIMER);
+    } else {
+        counter = value;
+    }
+}
+
+void Timer::scheduleOverflow() {
+    /**
+     * Schedule the next TIMA overflow, just after counterSync
+     */
+    if (!counterEnabled) {
+        Scheduler::schedule(EVENT_TIMER, SCHEDULE_NEVER);
+        return;
+    }
+
+    Scheduler::schedule(EVENT_TIMER, counterSync + (0x100 - counter) * counterPeriod - counterCycles);
+}
+
+void Timer::overflow() {
+    /**
+     * Handle a TIMA overflow
+     */
+    syncCounter();
+    scheduleOverflow();
+}
@@ -0,0 +1,57 @@
+/**
+ * gb.teensy Emulation Software
+ * Copyright (C) 2020  Raphael Stäbler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ **/
+
+#pragma once
+
+#include <Arduino.h>
+
+// Machine cycles per DIV increment
+#define DIVIDER_CYCLES 61
+
+/**
+ * DIV and TIMA derived from the cycle counter
+ *
+ * Both registers are stored as of the cycle they were last synced at and computed when read.
+ * The only scheduled event is the next TIMA overflow.
+ */
+class Timer {
+   public:
+    static void begin();
+    static uint8_t readByte(const uint16_t location);
+
+   private:
+    // DIV and the cycles towards its next increment as of dividerSync
+    static uint8_t divider;
+    static uint8_t dividerCycles;
+    static uint64_t dividerSync;
+
+    // TIMA and the cycles towards its next increment as of counterSync
+    static uint8_t counter;
+    static uint8_t counterCycles;
+    static uint64_t counterSync;
+
+    // Cycles per TIMA increment and TAC enable bit
+    static uint8_t counterPeriod;
+    static bool counterEnabled;
+
+    static void writeByte(const uint16_t location, const uint8_t data);
+    static void syncDivider();
+    static void syncCounter();
+    static void scheduleOverflow();
+    static void overflow();
+};
@@ -26,10 +26,13 @@
 #include <CPU.h>
 #include <Cartridge.h>
 #include <FT81x.h>
+#include <HostTiming.h>
+#include <IdleLoop.h>
 #include <Joypad.h>
 #include <Memory.h>
 #include <PPU.h>
 #include <SerialDataTransfer.h>
+#include <Timer.h>
 
 void waitForKeyPress();
 
@@ -50,8 +53,10 @@ void setup() {
     Cartridge::begin("tetris.gb");
     Cartridge::getGameName(title);
 
+    // Let the CPU skip ahead while games like Tetris busy-wait for VBlank
+    IdleLoop::begin(title);
+
     Memory::initMemory();
-    CPU::cpuEnabled = 1;
 
     ft81x.beginDisplayList();
     ft81x.clear(FT81x_COLOR_RGB(0, 0, 0));
@@ -62,19 +67,34 @@ void setup() {
 
     APU::begin();
     Joypad::begin();
+    PPU::begin(ft81x);
+    SerialDataTransfer::begin();
+    Timer::begin();
+    CPU::begin();
+
+#ifdef HOST_TIMING
+    HostTiming::begin();
+#endif
 }
 
 void loop() {
     uint64_t start = millis();
+    uint64_t nextUpdate = CPU::totalCycles + 1000000;
 
     while (true) {
-        CPU::cpuStep();
-        PPU::ppuStep(ft81x);
-        APU::apuStep();
-        SerialDataTransfer::serialStep();
-        Joypad::joypadStep();
+        HOST_TIMING_ENTER(HOST_TIMING_CPU);
+        CPU::run(nextUpdate - CPU::totalCycles);
+        HOST_TIMING_LEAVE();
+
+#ifdef HOST_TIMING
+        if (HostTiming::frames >= HOST_TIMING_REPORT_FRAMES) {
+            HostTiming::report(Serial);
+            HostTiming::reset();
+        }
+#endif
 
-        if ((CPU::totalCycles % 1000000) == 0) {
+        if (CPU::totalCycles >= nextUpdate) {
+            nextUpdate += 1000000;
             uint64_t time = millis() - start;
             uint64_t hz = 1000 * CPU::totalCycles / time;
             uint8_t speed = hz / 10000;
@@ -111,38 +131,133 @@ void waitForKeyPress() {
 //
 // The commands above will run the ROM data at ROM::getRom(0) for 70000000 cycles.
 // All the Serial output is printed to stdout.
+// Use the native_jit environment instead to run hot code through the x86-64 recompiler,
+// or native_recompiled to run ROM code translated ahead of time by tools/recompile.py.
+// Builds with -DCPU_PROFILER print a profile of the ROM at the end, a .sym file given as
+// the third argument resolves its addresses to labels:
+// > .pio/build/native/program 0 70000000 game.sym
+// Builds with -DHOST_TIMING write the host time per frame of each subsystem to HOST_TIMING_FILE.
+// Idle loops are skipped for the ROMs IdleLoop knows, --idle-loops or --no-idle-loops in front
+// of the other arguments override that:
+// > .pio/build/native/program --idle-loops 1 20000000
+// --frame-hashes prints a hash of every new frame to stderr, see ci/cpu-instrs.frames and
+// ci/sprites.frames for the sprite test ROM:
+// > .pio/build/native/program --frame-hashes 2 2000000
 
 #include <Arduino.h>
 #include <CPU.h>
+#include <Fusion.h>
+#include <HostTiming.h>
+#include <IdleLoop.h>
 #include <Memory.h>
 #include <PPU.h>
+#include <Profiler.h>
 #include <SD.h>
+#include <Scheduler.h>
 #include <SerialDataTransfer.h>
+#include <Timer.h>
 #include <rom.h>
+#include <string.h>
+
+#ifdef HOST_TIMING
+#ifndef HOST_TIMING_FILE
+#define HOST_TIMING_FILE "timing.txt"
+#endif
+
+// Print to a file instead of stdout
+class FilePrint : public Print {
+   public:
+    FILE *file;
+
+    size_t write(uint8_t c) { return fputc(c, file) == EOF ? 0 : 1; }
+};
+#endif
 
 SDClass SD;
 StdioSerial Serial;
 FT81x ft81x = FT81x(10, 9, 8);
 
 int main(int argc, char **argv) {
+    // Options
+    int idleLoops = -1;
+    while (argc > 1 && argv[1][0] == '-') {
+        if (strcmp(argv[1], "--idle-loops") == 0) {
+            idleLoops = 1;
+        } else if (strcmp(argv[1], "--no-idle-loops") == 0) {
+            idleLoops = 0;
+        } else if (strcmp(argv[1], "--frame-hashes") == 0) {
+            PPU::frameHashes = true;
+        } else {
+            printf("Unknown option %s.\n", argv[1]);
+            return 1;
+        }
+        argc--;
+        argv++;
+    }
+
+#ifdef CPU_PROFILER
+    if (argc != 3 && argc != 4) {
+        printf("Invalid argument count %i instead of 3 or 4.\n", argc);
+        printf("Usage: program [--idle-loops|--no-idle-loops] [--frame-hashes] [rom index] [cycle count] [sym file]\n");
+        return 1;
+    }
+#else
     if (argc != 3) {
         printf("Invalid argument count %i instead of 3.\n", argc);
-        printf("Usage: program [rom index] [cycle count]\n");
+        printf("Usage: program [--idle-loops|--no-idle-loops] [--frame-hashes] [rom index] [cycle count]\n");
         return 1;
     }
+#endif
 
     const unsigned int romIndex = atoi(argv[1]);
     const unsigned long cycleCount = atol(argv[2]);
 
     Cartridge::begin(ROM::getRom(romIndex));
     Memory::initMemory();
-    CPU::cpuEnabled = 1;
 
+    char title[17];
+    Cartridge::getGameName(title);
+    IdleLoop::begin(title);
+    if (idleLoops >= 0) {
+        IdleLoop::enabled = idleLoops;
+    }
+    PPU::begin(ft81x);
+    SerialDataTransfer::begin();
+    Timer::begin();
+    CPU::begin();
+
+#ifdef HOST_TIMING
+    HostTiming::begin();
+#endif
+
+    HOST_TIMING_ENTER(HOST_TIMING_CPU);
     while (CPU::totalCycles < cycleCount) {
-        CPU::cpuStep();
-        PPU::ppuStep(ft81x);
-        SerialDataTransfer::serialStep();
+        CPU::run(cycleCount - CPU::totalCycles);
+    }
+    HOST_TIMING_LEAVE();
+
+    // Let the peripherals catch up with the last operation
+    Scheduler::dispatch(CPU::totalCycles);
+
+#ifdef CPU_FUSION_HISTOGRAM
+    Fusion::report();
+#endif
+
+#ifdef CPU_PROFILER
+    Profiler::report(argc > 3 ? argv[3] : NULL);
+#endif
+
+#ifdef HOST_TIMING
+    FilePrint timing;
+    timing.file = fopen(HOST_TIMING_FILE, "w");
+    if (timing.file) {
+        HostTiming::report(timing);
+        fclose(timing.file);
     }
+#endif
+
+    // Keep stdout to the ROM's serial output
+    fprintf(stderr, "Idle loops skipped: %u, %llu cycles\n", IdleLoop::skippedLoops, (unsigned long long)IdleLoop::skippedCycles);
 
     return 0;
 }
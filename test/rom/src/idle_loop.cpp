@@ -0,0 +1,95 @@
+#include "rom.h"
+
+// Waits for VBlank in the three ways IdleLoop fast-forwards and reports the divider after each,
+// so skipping iterations must not change the output:
+//   F: Polls a flag in WRAM that the VBlank handler sets
+//   L: Polls LY for line 72 with interrupts disabled
+//   I: Polls the VBlank bit of IF with interrupts disabled
+// Every report is sent over the serial port as the letter, DIV in hex and a new line.
+// Everything past the code is 0.
+const uint8_t ROM::idle_loop[0x8000] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    // 0x0040: VBlank interrupt: set the flag polled by wait_flag
+    0x3E, 0x01,                         // ld a,1
+    0xEA, 0x00, 0xC0,                   // ld ($C000),a
+    0xD9,                               // reti
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    // 0x0100: Entry point
+    0x00,                               // nop
+    0xC3, 0x50, 0x01,                   // jp start
+    // 0x0104: Header, the title is "IDLE LOOP"
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x49, 0x44, 0x4C, 0x45, 0x20, 0x4C, 0x4F, 0x4F, 0x50, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x6F, 0x00, 0x00,
+    // 0x0150: start
+    0x31, 0xFE, 0xFF,                   // ld sp,$FFFE
+    0x3E, 0x91,                         // ld a,$91
+    0xE0, 0x40,                         // ldh (LCDC),a
+    0x3E, 0x01,                         // ld a,1
+    0xE0, 0xFF,                         // ldh (IE),a
+    0x21, 0x00, 0xC0,                   // ld hl,$C000
+    // 0x015E: loop
+    0xAF,                               // xor a
+    0x77,                               // ld (hl),a
+    0xE0, 0x0F,                         // ldh (IF),a
+    0xFB,                               // ei
+    // 0x0163: wait_flag
+    0x7E,                               // ld a,(hl)
+    0xA7,                               // and a
+    0x28, 0xFC,                         // jr z,wait_flag
+    0xF3,                               // di
+    0x3E, 0x46,                         // ld a,"F"
+    0xCD, 0x88, 0x01,                   // call report
+    // 0x016D: wait_ly
+    0xF0, 0x44,                         // ldh a,(LY)
+    0xFE, 0x48,                         // cp 72
+    0x20, 0xFA,                         // jr nz,wait_ly
+    0x3E, 0x4C,                         // ld a,"L"
+    0xCD, 0x88, 0x01,                   // call report
+    0xAF,                               // xor a
+    0xE0, 0x0F,                         // ldh (IF),a
+    // 0x017B: wait_if
+    0xF0, 0x0F,                         // ldh a,(IF)
+    0xE6, 0x01,                         // and 1
+    0x28, 0xFA,                         // jr z,wait_if
+    0x3E, 0x49,                         // ld a,"I"
+    0xCD, 0x88, 0x01,                   // call report
+    0x18, 0xD6,                         // jr loop
+    // 0x0188: report
+    0xCD, 0xA5, 0x01,                   // call send
+    0xF0, 0x04,                         // ldh a,(DIV)
+    0xF5,                               // push af
+    0xCB, 0x37,                         // swap a
+    0xCD, 0x9B, 0x01,                   // call nibble
+    0xF1,                               // pop af
+    0xCD, 0x9B, 0x01,                   // call nibble
+    0x3E, 0x0A,                         // ld a,"\n"
+    0x18, 0x0A,                         // jr send
+    // 0x019B: nibble
+    0xE6, 0x0F,                         // and $0F
+    0xC6, 0x30,                         // add "0"
+    0xFE, 0x3A,                         // cp "9" + 1
+    0x38, 0x02,                         // jr c,send
+    0xC6, 0x07,                         // add "A" - "9" - 1
+    // 0x01A5: send
+    0xE0, 0x01,                         // ldh (SB),a
+    0x3E, 0x81,                         // ld a,$81
+    0xE0, 0x02,                         // ldh (SC),a
+    0xC9,                               // ret
+};
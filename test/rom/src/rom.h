@@ -4,6 +4,8 @@
 
 class ROM {
    public:
-    static const uint8_t *getRom(int index) { return cpu_instrs; }
+    static const uint8_t *getRom(int index) { return index == 2 ? sprites : index == 1 ? idle_loop : cpu_instrs; }
     static const uint8_t cpu_instrs[0x10000];
+    static const uint8_t idle_loop[0x8000];
+    static const uint8_t sprites[0x8000];
 };
@@ -0,0 +1,139 @@
+#include "rom.h"
+
+// Draws sprites over a background of alternating columns of colors 0 and 1, four frames each
+// with 8x8 sprites, 8x16 sprites and 8x8 sprites with the background off:
+//   Row at line 8: A triangle without flips and with X, Y and both flips
+//   Row at line 32: Overlapping sprites, the one further left wins and at the same X the first in OAM
+//   Row at line 56: 12 sprites in reverse order of X, only the first 10 in OAM are drawn
+//   Row at line 80: Sprites behind the background, over other sprites and clipped at the edges
+// Everything past the OAM data is 0.
+const uint8_t ROM::sprites[0x8000] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    // 0x0100: Entry point
+    0x00,                               // nop
+    0xC3, 0x50, 0x01,                   // jp start
+    // 0x0104: Header, the title is "SPRITES"
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x53, 0x50, 0x52, 0x49, 0x54, 0x45, 0x53, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xBD, 0x00, 0x00,
+    // 0x0150: start
+    0x31, 0xFE, 0xFF,                   // ld sp,$FFFE
+    // 0x0153: wait_vblank
+    0xF0, 0x44,                         // ldh a,(LY)
+    0xFE, 0x90,                         // cp 144
+    0x38, 0xFA,                         // jr c,wait_vblank
+    0xAF,                               // xor a
+    0xE0, 0x40,                         // ldh (LCDC),a
+    0x21, 0x00, 0x80,                   // ld hl,$8000
+    0x11, 0x00, 0x02,                   // ld de,tiles
+    0x01, 0x60, 0x00,                   // ld bc,96
+    0xCD, 0xAF, 0x01,                   // call copy
+    0x21, 0x00, 0xFE,                   // ld hl,$FE00
+    0x11, 0x60, 0x02,                   // ld de,oam
+    0x01, 0xA0, 0x00,                   // ld bc,160
+    0xCD, 0xAF, 0x01,                   // call copy
+    0x21, 0x00, 0x98,                   // ld hl,$9800
+    // 0x0177: fill_map
+    0x7D,                               // ld a,l
+    0xE6, 0x01,                         // and 1
+    0x22,                               // ld (hl+),a
+    0x7C,                               // ld a,h
+    0xFE, 0x9C,                         // cp $9C
+    0x20, 0xF7,                         // jr nz,fill_map
+    0x3E, 0xE4,                         // ld a,$E4
+    0xE0, 0x47,                         // ldh (BGP),a
+    0xE0, 0x48,                         // ldh (OBP0),a
+    0x3E, 0x1B,                         // ld a,$1B
+    0xE0, 0x49,                         // ldh (OBP1),a
+    0x3E, 0x93,                         // ld a,$93
+    0xCD, 0x9B, 0x01,                   // call show
+    0x3E, 0x97,                         // ld a,$97
+    0xCD, 0x9B, 0x01,                   // call show
+    0x3E, 0x92,                         // ld a,$92
+    0xCD, 0x9B, 0x01,                   // call show
+    // 0x0199: done
+    0x18, 0xFE,                         // jr done
+    // 0x019B: show
+    0xE0, 0x40,                         // ldh (LCDC),a
+    0x06, 0x04,                         // ld b,4
+    // 0x019F: wait_start
+    0xF0, 0x44,                         // ldh a,(LY)
+    0xFE, 0x90,                         // cp 144
+    0x20, 0xFA,                         // jr nz,wait_start
+    // 0x01A5: wait_end
+    0xF0, 0x44,                         // ldh a,(LY)
+    0xFE, 0x90,                         // cp 144
+    0x28, 0xFA,                         // jr z,wait_end
+    0x05,                               // dec b
+    0x20, 0xF1,                         // jr nz,wait_start
+    0xC9,                               // ret
+    // 0x01AF: copy
+    0x1A,                               // ld a,(de)
+    0x22,                               // ld (hl+),a
+    0x13,                               // inc de
+    0x0B,                               // dec bc
+    0x78,                               // ld a,b
+    0xB1,                               // or c
+    0x20, 0xF8,                         // jr nz,copy
+    0xC9,                               // ret
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    // 0x0200: tiles, copied to $8000
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // Tile 0: blank
+    0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, // Tile 1: color 1
+    0xB6, 0x6D, 0x6C, 0xDA, 0xD8, 0xB4, 0xB0, 0x68, 0x60, 0xD0, 0xC0, 0xA0, 0x80, 0x40, 0x00, 0x80, // Tile 2: triangle in the top left corner, shows how sprites are flipped
+    0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, // Tile 3: color 2
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // Tile 4: color 3
+    0xFF, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00, // Tile 5: stripes of colors 1 and 0
+    // 0x0260: oam, copied to $FE00 with the screen position of each sprite offset by (8, 16)
+    0x18, 0x10, 0x02, 0x00, // 0: triangle
+    0x18, 0x20, 0x02, 0x20, // 1: triangle, X flip
+    0x18, 0x30, 0x02, 0x40, // 2: triangle, Y flip
+    0x18, 0x40, 0x02, 0x60, // 3: triangle, X and Y flip
+    0x30, 0x14, 0x03, 0x00, // 4: color 2, below 5 which is further left
+    0x30, 0x10, 0x04, 0x00, // 5: color 3
+    0x30, 0x30, 0x03, 0x00, // 6: color 2, above 7 at the same X
+    0x30, 0x30, 0x04, 0x00, // 7: color 3
+    0x48, 0x94, 0x02, 0x10, // 8: triangle, OBP1
+    0x48, 0x88, 0x02, 0x10, // 9: triangle, OBP1
+    0x48, 0x7C, 0x02, 0x10, // 10: triangle, OBP1
+    0x48, 0x70, 0x02, 0x10, // 11: triangle, OBP1
+    0x48, 0x64, 0x02, 0x10, // 12: triangle, OBP1
+    0x48, 0x58, 0x02, 0x10, // 13: triangle, OBP1
+    0x48, 0x4C, 0x02, 0x10, // 14: triangle, OBP1
+    0x48, 0x40, 0x02, 0x10, // 15: triangle, OBP1
+    0x48, 0x34, 0x02, 0x10, // 16: triangle, OBP1
+    0x48, 0x28, 0x02, 0x10, // 17: triangle, OBP1
+    0x48, 0x1C, 0x02, 0x10, // 18: triangle, OBP1, dropped as the 11th sprite on its lines
+    0x48, 0x10, 0x02, 0x10, // 19: triangle, OBP1, dropped as the 12th sprite on its lines
+    0x60, 0x44, 0x04, 0x80, // 20: color 3, behind the background
+    0x60, 0x44, 0x03, 0x00, // 21: color 2, hidden by 20 at the same X
+    0x60, 0x04, 0x02, 0x80, // 22: triangle, behind the background and clipped at the left
+    0x60, 0xA4, 0x04, 0x10, // 23: color 3, OBP1, clipped at the right
+    0x60, 0x6C, 0x05, 0x00, // 24: stripes
+    0x64, 0x72, 0x02, 0x80, // 25: triangle, behind the background and below 24
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
@@ -0,0 +1,38 @@
+#
+# gb.teensy Emulation Software
+# Copyright (C) 2020  Raphael Stäbler
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+"""PlatformIO pre script of the *_recompiled environments
+
+Runs tools/recompile.py on the ROM given by `custom_recompile_rom` before the
+build, so lib/CPU/Recompiled.inc always matches the ROM the firmware is built for.
+"""
+
+import os
+import subprocess
+import sys
+
+Import("env")  # noqa: F821
+
+project_dir = env.subst("$PROJECT_DIR")  # noqa: F821
+rom = os.path.join(project_dir, env.GetProjectOption("custom_recompile_rom"))  # noqa: F821
+output = os.path.join(project_dir, "lib", "CPU", "Recompiled.inc")
+
+if not os.path.isfile(rom):
+    sys.stderr.write("Error: ROM %s not found, set custom_recompile_rom in platformio.ini\n" % rom)
+    env.Exit(1)  # noqa: F821
+
+subprocess.check_call([env.subst("$PYTHONEXE"), os.path.join(project_dir, "tools", "recompile.py"), rom, output])  # noqa: F821
@@ -0,0 +1,515 @@
+#!/usr/bin/env python3
+#
+# gb.teensy Emulation Software
+# Copyright (C) 2020  Raphael Stäbler
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+"""Static recompiler
+
+Disassembles a ROM, follows its control flow per bank and emits C++ for all
+reachable code. The output is included by lib/CPU/CPU.cpp when building with
+-DCPU_RECOMPILED, blocks at known addresses then run as native code while RAM
+resident or unreached code is still interpreted.
+
+Usage:
+    tools/recompile.py tetris.gb lib/CPU/Recompiled.inc
+    tools/recompile.py test/rom/src/cpu_instrs.cpp lib/CPU/Recompiled.inc
+
+ROMs can be given as binary files or as C++ sources holding the ROM as a byte array.
+"""
+
+import os
+import re
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+CPU_SOURCE = os.path.join(ROOT, "lib", "CPU", "CPU.cpp")
+
+BANK_SIZE = 0x4000
+CHECKSUM = 0x014E
+
+# Entry point, RST and interrupt vectors
+ENTRY_POINTS = [0x0100] + list(range(0x00, 0x40, 0x08)) + list(range(0x40, 0x68, 0x08))
+
+# STOP, HALT, DI, EI have to be interpreted
+INTERPRETED = {0x10, 0x76, 0xF3, 0xFB}
+
+JR = {0x18: False, 0x20: True, 0x28: True, 0x30: True, 0x38: True}
+JP = {0xC3: False, 0xC2: True, 0xCA: True, 0xD2: True, 0xDA: True}
+CALL = {0xCD: False, 0xC4: True, 0xCC: True, 0xD4: True, 0xDC: True}
+RET = {0xC9: False, 0xD9: False, 0xC0: True, 0xC8: True, 0xD0: True, 0xD8: True}
+RST = {0xC7, 0xCF, 0xD7, 0xDF, 0xE7, 0xEF, 0xF7, 0xFF}
+JP_HL = 0xE9
+
+PUSH = {0xC5, 0xD5, 0xE5, 0xF5} | set(CALL) | RST
+POP = {0xC1, 0xD1, 0xE1, 0xF1} | set(RET)
+
+# Operands as encoded in the opcodes: B, C, D, E, H, L, (HL), A
+REGISTERS = ["(BC >> 8)", "(BC & 0xFF)", "(DE >> 8)", "(DE & 0xFF)", "(HL >> 8)", "(HL & 0xFF)", "Memory::readByte(HL)", "(AF >> 8)"]
+REGISTER_PAIRS = ["BC", "DE", "HL", "SP"]
+ALUS = ["ALU_ADD", "ALU_ADC", "ALU_SUB", "ALU_SBC", "ALU_AND", "ALU_XOR", "ALU_OR", "ALU_CP"]
+SHIFTS = ["SHIFT_RLC", "SHIFT_RRC", "SHIFT_RL", "SHIFT_RR", "SHIFT_SLA", "SHIFT_SRA", "SHIFT_SWAP", "SHIFT_SRL"]
+CONDITIONS = ["ZERO_F(AF_FLAGS) == 0", "ZERO_F(AF_FLAGS) != 0", "CARRY_F(AF_FLAGS) == 0", "CARRY_F(AF_FLAGS) != 0"]
+
+
+def read_table(source, pattern):
+    """Read a 16x16 opcode table from CPU.cpp"""
+    match = re.search(pattern + r"\s*=\s*\{(.*?)\};", source, re.S)
+    if not match:
+        sys.exit("Unable to find %s in %s" % (pattern, CPU_SOURCE))
+    values = [int(v) for v in re.findall(r"\b(\d+),", re.sub(r"//.*", "", match.group(1)))]
+    assert len(values) == 256
+    return values
+
+
+def read_rom(path):
+    """Read a ROM from a binary file or a C++ byte array"""
+    if path.endswith((".cpp", ".c", ".h")):
+        with open(path) as f:
+            source = f.read()
+        return bytes(int(v, 16) for v in re.findall(r"0x([0-9A-Fa-f]{2})\b", source[source.index("{"):]))
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def read8(r):
+    """Get the C++ expression of an 8 bit operand"""
+    return REGISTERS[r]
+
+
+def write8(r, value):
+    """Get the C++ statement that writes an 8 bit operand"""
+    if r == 6:
+        return "Memory::writeByte(HL, %s);" % value
+    pair = "AF" if r == 7 else REGISTER_PAIRS[r >> 1]
+    if r & 0x01 and r != 7:
+        return "%s = LD_nN_n(%s, %s);" % (pair, pair, value)
+    return "%s = LD_Nn_n(%s, %s);" % (pair, pair, value)
+
+
+def io_read(location):
+    return location >= 0xFF00 and (location < 0xFF80 or location == 0xFFFF)
+
+
+def io_write(location):
+    return io_read(location) or location < 0x8000
+
+
+class Instruction:
+    def __init__(self, bank, address, opcode, length, operand):
+        self.bank = bank
+        self.address = address
+        self.opcode = opcode
+        self.length = length
+        self.operand = operand
+        self.next = address + length
+
+
+class Recompiler:
+    def __init__(self, rom, lengths, cycles, cycles_taken, cb_cycles):
+        self.rom = rom
+        self.banks = max(2, len(rom) // BANK_SIZE)
+        self.lengths = lengths
+        self.cycles = cycles
+        self.cycles_taken = cycles_taken
+        self.cb_cycles = cb_cycles
+        # (bank, address) -> Instruction, None for interpreted instructions
+        self.instructions = {}
+
+    def byte(self, bank, address):
+        offset = address if address < BANK_SIZE else bank * BANK_SIZE + address - BANK_SIZE
+        return self.rom[offset] if offset < len(self.rom) else 0xFF
+
+    def decode(self, bank, address):
+        opcode = self.byte(bank, address)
+        length = 2 if opcode == 0xCB else self.lengths[opcode]
+        operand = 0
+        if length == 2:
+            operand = self.byte(bank, address + 1)
+        elif length == 3:
+            operand = self.byte(bank, address + 1) | (self.byte(bank, address + 2) << 8)
+        return Instruction(bank, address, opcode, length, operand)
+
+    def compilable(self, ins):
+        """Check if an instruction can be recompiled, see NativeCode"""
+        region_end = BANK_SIZE if ins.address < BANK_SIZE else 2 * BANK_SIZE
+        if ins.next > region_end:
+            return False
+        if ins.opcode in INTERPRETED or (ins.opcode != 0xCB and self.cycles[ins.opcode] == 0):
+            return False
+        if ins.opcode in (0xE0, 0xF0):
+            return not io_read(0xFF00 + ins.operand)
+        if ins.opcode == 0xEA:
+            return not io_write(ins.operand)
+        if ins.opcode == 0xFA:
+            return not io_read(ins.operand)
+        if ins.opcode == 0x08:
+            return not io_write(ins.operand) and not io_write((ins.operand + 1) & 0xFFFF)
+        return True
+
+    def targets(self, bank, target):
+        """Get the (bank, address) pairs a branch from bank may land on"""
+        if target < BANK_SIZE:
+            return [(0, target)]
+        if target >= 2 * BANK_SIZE:
+            return []
+        if bank != 0:
+            return [(bank, target)]
+        # The mapped bank is unknown when branching from bank 0
+        return [(b, target) for b in range(1, self.banks)]
+
+    def successors(self, ins):
+        opcode = ins.opcode
+        result = []
+        if opcode in JR:
+            result += self.targets(ins.bank, (ins.next + (ins.operand ^ 0x80) - 0x80) & 0xFFFF)
+        elif opcode in JP or opcode in CALL:
+            result += self.targets(ins.bank, ins.operand)
+        elif opcode in RST:
+            result += self.targets(ins.bank, opcode & 0x38)
+        if not self.ends_flow(ins):
+            result += self.targets(ins.bank, ins.next)
+        return result
+
+    def ends_flow(self, ins):
+        """Check if execution never continues with the next instruction"""
+        opcode = ins.opcode
+        for branches in (JR, JP, RET):
+            if opcode in branches and not branches[opcode]:
+                return True
+        return opcode == JP_HL
+
+    def explore(self):
+        pending = [(0, address) for address in ENTRY_POINTS]
+        while pending:
+            key = pending.pop()
+            if key in self.instructions:
+                continue
+            ins = self.decode(*key)
+            self.instructions[key] = ins if self.compilable(ins) else None
+            pending += self.successors(ins)
+
+    def functions(self):
+        """Group instructions into chains that fall through from one to the next"""
+        assigned = set()
+        chains = []
+        for key in sorted(k for k, ins in self.instructions.items() if ins):
+            if key in assigned:
+                continue
+            chain = []
+            while key in self.instructions and self.instructions[key] and key not in assigned:
+                ins = self.instructions[key]
+                chain.append(ins)
+                assigned.add(key)
+                if self.ends_flow(ins) or ins.next >= (BANK_SIZE if ins.address < BANK_SIZE else 2 * BANK_SIZE):
+                    break
+                key = (ins.bank, ins.next)
+            chains.append(chain)
+        return chains
+
+    @staticmethod
+    def guard(ins):
+        """Get the C++ condition that sends an instruction back to the interpreter"""
+        opcode = ins.opcode
+        if 0x40 <= opcode < 0xC0 and opcode & 0x07 == 0x06 and opcode != 0x76:
+            return "NATIVE_GUARD_READ(HL)"
+        if 0x70 <= opcode < 0x78 and opcode != 0x76:
+            return "NATIVE_GUARD_WRITE(HL)"
+        simple = {
+            0x02: "NATIVE_GUARD_WRITE(BC)",
+            0x0A: "NATIVE_GUARD_READ(BC)",
+            0x12: "NATIVE_GUARD_WRITE(DE)",
+            0x1A: "NATIVE_GUARD_READ(DE)",
+            0x22: "NATIVE_GUARD_WRITE(HL)",
+            0x32: "NATIVE_GUARD_WRITE(HL)",
+            0x36: "NATIVE_GUARD_WRITE(HL)",
+            0x2A: "NATIVE_GUARD_READ(HL)",
+            0x3A: "NATIVE_GUARD_READ(HL)",
+            0x34: "NATIVE_GUARD_WRITE(HL)",
+            0x35: "NATIVE_GUARD_WRITE(HL)",
+            0xE2: "NATIVE_GUARD_WRITE(0xFF00 + (BC & 0xFF))",
+            0xF2: "NATIVE_GUARD_READ(0xFF00 + (BC & 0xFF))",
+        }
+        if opcode in simple:
+            return simple[opcode]
+        if opcode in PUSH:
+            return "NATIVE_GUARD_WRITE((uint16_t)(SP - 1)) || NATIVE_GUARD_WRITE((uint16_t)(SP - 2))"
+        if opcode in POP:
+            return "NATIVE_GUARD_READ(SP) || NATIVE_GUARD_READ((uint16_t)(SP + 1))"
+        if opcode == 0xCB and ins.operand & 0x07 == 0x06:
+            return "NATIVE_GUARD_READ(HL)" if 0x40 <= ins.operand < 0x80 else "NATIVE_GUARD_WRITE(HL)"
+        return None
+
+    def op_cycles(self, ins):
+        """Get the machine cycles of an instruction if it doesn't branch"""
+        if ins.opcode == 0xCB:
+            return self.cb_cycles[ins.operand]
+        return self.cycles[ins.opcode]
+
+    @staticmethod
+    def branches(ins):
+        """Check if an instruction may continue anywhere but with the next one"""
+        opcode = ins.opcode
+        return opcode in JR or opcode in JP or opcode in CALL or opcode in RET or opcode in RST or opcode == JP_HL
+
+    @staticmethod
+    def target(ins):
+        """Get the address a JR, JP, CALL or RST continues at if it branches"""
+        if ins.opcode in JR:
+            return (ins.next + (ins.operand ^ 0x80) - 0x80) & 0xFFFF
+        if ins.opcode in RST:
+            return ins.opcode & 0x38
+        return ins.operand
+
+    def translate(self, ins):
+        """Get the C++ statements of an instruction that doesn't branch"""
+        opcode = ins.opcode
+        if opcode == 0xCB:
+            code = ins.operand
+            src = code & 0x07
+            bit = 1 << ((code >> 3) & 0x07)
+            if code < 0x40:
+                return [write8(src, "shift<%s>(%s)" % (SHIFTS[(code >> 3) & 0x07], read8(src)))]
+            if code < 0x80:
+                return ["SET_FLAGS(ZERO_S(%s & 0x%02X) | HALF_V | CARRY_F(AF_FLAGS));" % (read8(src), bit)]
+            if code < 0xC0:
+                return [write8(src, "%s & 0x%02X" % (read8(src), ~bit & 0xFF))]
+            return [write8(src, "%s | 0x%02X" % (read8(src), bit))]
+
+        dst = (opcode >> 3) & 0x07
+        src = opcode & 0x07
+        if opcode == 0x00:
+            return []
+        if 0x40 <= opcode < 0x80:
+            return [write8(dst, read8(src))] if dst != src else []
+        if 0x80 <= opcode < 0xC0:
+            return ["alu<%s>(%s);" % (ALUS[dst], read8(src))]
+        if opcode & 0xC7 == 0xC6:
+            return ["alu<%s>(0x%02X);" % (ALUS[dst], ins.operand)]
+        if opcode & 0xC7 == 0x06 and opcode < 0x40:
+            return [write8(dst, "0x%02X" % ins.operand)]
+        if opcode & 0xC6 == 0x04 and opcode < 0x40:
+            step, table = ("-", "decFlags") if opcode & 0x01 else ("+", "incFlags")
+            return [
+                "{",
+                "    const uint8_t n = %s %s 1;" % (read8(dst), step),
+                "    " + write8(dst, "n"),
+                "    SET_FLAGS(%s[n] | CARRY_F(AF_FLAGS));" % table,
+                "}",
+            ]
+        pair = REGISTER_PAIRS[opcode >> 4] if opcode < 0x40 else None
+        if opcode & 0xCF == 0x01:
+            return ["%s = 0x%04X;" % (pair, ins.operand)]
+        if opcode & 0xCF == 0x03:
+            return ["%s++;" % pair]
+        if opcode & 0xCF == 0x0B:
+            return ["%s--;" % pair]
+        loads = {
+            0x02: ["Memory::writeByte(BC, AF >> 8);"],
+            0x12: ["Memory::writeByte(DE, AF >> 8);"],
+            0x22: ["Memory::writeByte(HL, AF >> 8);", "HL++;"],
+            0x32: ["Memory::writeByte(HL, AF >> 8);", "HL--;"],
+            0x0A: ["AF = LD_Nn_n(AF, Memory::readByte(BC));"],
+            0x1A: ["AF = LD_Nn_n(AF, Memory::readByte(DE));"],
+            0x2A: ["AF = LD_Nn_n(AF, Memory::readByte(HL));", "HL++;"],
+            0x3A: ["AF = LD_Nn_n(AF, Memory::readByte(HL));", "HL--;"],
+            0xE0: ["Memory::writeByte(0x%04X, AF >> 8);" % (0xFF00 + ins.operand)],
+            0xF0: ["AF = LD_Nn_n(AF, Memory::readByte(0x%04X));" % (0xFF00 + ins.operand)],
+            0xEA: ["Memory::writeByte(0x%04X, AF >> 8);" % ins.operand],
+            0xFA: ["AF = LD_Nn_n(AF, Memory::readByte(0x%04X));" % ins.operand],
+            0xF9: ["SP = HL;"],
+            0xC5: ["pushStack(BC);"],
+            0xD5: ["pushStack(DE);"],
+            0xE5: ["pushStack(HL);"],
+            0xF5: ["pushStack(AF_FLAGS);"],
+            0xC1: ["BC = popStack();"],
+            0xD1: ["DE = popStack();"],
+            0xE1: ["HL = popStack();"],
+        }
+        if opcode in loads:
+            return loads[opcode]
+
+        # Anything else is left to its handler
+        lines = []
+        if ins.length > 1:
+            lines.append("operand = 0x%0*X;" % (2 * (ins.length - 1), ins.operand))
+        lines.append("opcode<0x%02X>();" % opcode)
+        return lines
+
+    @staticmethod
+    def condition(ins):
+        """Get the C++ condition of a conditional branch, encoded in bits 3-4 of the opcode"""
+        return CONDITIONS[(ins.opcode >> 3) & 0x03]
+
+    def emit_function(self, chain, out):
+        """Emit the C++ function of a chain
+
+        Instructions are translated to statements on the registers, branches within the
+        chain to gotos. The chain is split into segments that end at a branch, the cycles
+        until the next event are only checked in front of a segment: it runs as a whole
+        if its last instruction starts before the event. PC is only stored on the way out.
+        """
+        first = chain[0]
+        labels = {ins.address: "op_%04X" % ins.address for ins in chain}
+
+        # Machine cycles from each instruction up to the start of the last one of its segment
+        lead = [0] * len(chain)
+        for index in reversed(range(len(chain))):
+            ins = chain[index]
+            if index + 1 < len(chain) and not self.branches(ins):
+                lead[index] = self.op_cycles(ins) + lead[index + 1]
+        leads = {ins.address: lead[index] for index, ins in enumerate(chain)}
+
+        def enter(address, indent):
+            """Continue with the segment at address or leave if the next event comes first"""
+            pad = " " * indent
+            if address in labels:
+                reached = "cycles + %d" % leads[address] if leads[address] else "cycles"
+                return [
+                    pad + "if (%s < horizon) {" % reached,
+                    pad + "    goto %s;" % labels[address],
+                    pad + "}",
+                    pad + "PC = 0x%04X;" % address,
+                    pad + "return cycles;",
+                ]
+            return [pad + "PC = 0x%04X;" % address, pad + "return cycles;"]
+
+        out.append("template <>")
+        out.append("uint16_t CPU::recompiled<0x%06X>(uint32_t horizon, uint32_t entry) {" % ((first.bank << 16) | first.address))
+        out.append("    uint32_t cycles = 0;")
+        out.append("    switch (entry) {")
+        for index, ins in enumerate(chain):
+            out.append("        case %d:" % index)
+            if lead[index]:
+                out.append("            if (%d >= horizon) {" % lead[index])
+                out.append("                return 0;")
+                out.append("            }")
+            out.append("            goto %s;" % labels[ins.address])
+        out.append("        default:")
+        out.append("            return 0;")
+        out.append("    }")
+
+        for index, ins in enumerate(chain):
+            raw = " ".join("%02X" % self.byte(ins.bank, ins.address + i) for i in range(ins.length))
+            out.append("%s:  // %s" % (labels[ins.address], raw))
+            guard = self.guard(ins)
+            if guard:
+                out.append("    if (%s) {" % guard)
+                out.append("        PC = 0x%04X;" % ins.address)
+                out.append("        return cycles | NATIVE_BAILED;")
+                out.append("    }")
+
+            opcode = ins.opcode
+            cycles = self.op_cycles(ins)
+            if not self.branches(ins):
+                out.extend("    " + line for line in self.translate(ins))
+                out.append("    cycles += %d;" % cycles)
+                if index + 1 == len(chain):
+                    out.extend(enter(ins.next, 4))
+                continue
+
+            taken = self.cycles_taken[opcode]
+            conditional = any(opcode in b and b[opcode] for b in (JR, JP, CALL, RET))
+            if opcode in JR or opcode in JP:
+                if conditional:
+                    out.append("    if (%s) {" % self.condition(ins))
+                    out.append("        cycles += %d;" % taken)
+                    out.extend(enter(self.target(ins), 8))
+                    out.append("    }")
+                else:
+                    out.append("    cycles += %d;" % cycles)
+                    out.extend(enter(self.target(ins), 4))
+                    continue
+            elif opcode in CALL or opcode in RST:
+                body = ["pushStack(0x%04X);" % ins.next, "PC = 0x%04X;" % self.target(ins), "return cycles + %d;" % taken]
+                if conditional:
+                    out.append("    if (%s) {" % self.condition(ins))
+                    out.extend("        " + line for line in body)
+                    out.append("    }")
+                else:
+                    out.extend("    " + line for line in body)
+                    continue
+            elif opcode in RET:
+                body = ["PC = popStack();", "return cycles + %d;" % taken]
+                if opcode == 0xD9:
+                    # RETI enables interrupts through its handler
+                    body = ["opcode<0xD9>();", "return cycles + %d;" % taken]
+                if conditional:
+                    out.append("    if (%s) {" % self.condition(ins))
+                    out.extend("        " + line for line in body)
+                    out.append("    }")
+                else:
+                    out.extend("    " + line for line in body)
+                    continue
+            else:
+                # JP (HL)
+                out.append("    PC = HL;")
+                out.append("    return cycles + %d;" % cycles)
+                continue
+
+            # Not taken, the next segment starts with the next instruction
+            out.append("    cycles += %d;" % cycles)
+            out.extend(enter(ins.next, 4))
+        out.append("}")
+        out.append("")
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+
+    rom = read_rom(sys.argv[1])
+    with open(CPU_SOURCE) as f:
+        source = f.read()
+    lengths = read_table(source, r"CPU::opLength\[256\]")
+    cycles = read_table(source, r"opCycles\[256\]")
+    cycles_taken = read_table(source, r"opCyclesTaken\[256\]")
+    cb_cycles = read_table(source, r"cbCycles\[256\]")
+
+    recompiler = Recompiler(rom, lengths, cycles, cycles_taken, cb_cycles)
+    recompiler.explore()
+    chains = recompiler.functions()
+
+    out = [
+        "// Generated by tools/recompile.py from %s, do not edit" % os.path.basename(sys.argv[1]),
+        "",
+        "#define RECOMPILED_CHECKSUM 0x%04X" % ((rom[CHECKSUM] << 8) | rom[CHECKSUM + 1]),
+        "",
+    ]
+    for chain in chains:
+        recompiler.emit_function(chain, out)
+
+    entries = []
+    for chain in chains:
+        key = (chain[0].bank << 16) | chain[0].address
+        for index, ins in enumerate(chain):
+            entries.append(((ins.bank << 16) | ins.address, key, index))
+    entries.sort()
+
+    out.append("const CPU::RecompiledEntry CPU::recompiledEntries[] = {")
+    for address, key, index in entries:
+        out.append("    {0x%06X, &CPU::recompiled<0x%06X>, %d}," % (address, key, index))
+    out.append("};")
+    out.append("")
+    out.append("const uint32_t CPU::recompiledCount = %d;" % len(entries))
+
+    with open(sys.argv[2], "w") as f:
+        f.write("\n".join(out) + "\n")
+
+    print("Recompiled %d instructions in %d blocks" % (len(entries), len(chains)))
+
+
+if __name__ == "__main__":
+    main()
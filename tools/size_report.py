@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+#
+# gb.teensy Emulation Software
+# Copyright (C) 2020  Raphael Stäbler
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+"""Interpreter size report
+
+Lists the code size of the interpreter's hot path, that is the CPU core with its
+opcode handlers and the memory fast path, and checks where it ended up in the
+Teensy 4.x memory map. Code in ITCM runs without wait states, code that spilled
+to flash runs through the cache and stalls on misses.
+
+Usage:
+    tools/size_report.py [firmware.elf] [nm]
+    tools/size_report.py .pio/build/teensy41/firmware.elf arm-none-eabi-nm
+    tools/size_report.py .pio/build/native/program nm
+
+The ITCM check is skipped for host builds, the sizes are still listed.
+"""
+
+import subprocess
+import sys
+
+DEFAULT_ELF = ".pio/build/teensy41/firmware.elf"
+DEFAULT_NM = "arm-none-eabi-nm"
+
+# Teensy 4.x memory map
+ITCM_START = 0x00000000
+ITCM_END = 0x00080000
+FLASH_START = 0x60000000
+
+# ITCM and DTCM share 512 KB of RAM1 in banks of 32 KB
+RAM1_SIZE = 0x80000
+RAM1_BANK = 0x8000
+
+# Classes on the path of every emulated instruction
+HOT_CLASSES = ("CPU::", "Memory::", "BlockCache::", "Interrupts::", "Scheduler::", "IdleLoop::")
+
+# Number of the largest hot symbols to list
+LISTED = 20
+
+
+def read_symbols(elf, nm):
+    """Read the code symbols of an ELF file as (address, size, name)"""
+    output = subprocess.check_output([nm, "--demangle", "--print-size", "--defined-only", elf], universal_newlines=True)
+    symbols = []
+    for line in output.splitlines():
+        fields = line.split(None, 3)
+        if len(fields) != 4 or fields[2] not in "tTwW":
+            continue
+        symbols.append((int(fields[0], 16), int(fields[1], 16), fields[3]))
+    return symbols
+
+
+def region(address):
+    if ITCM_START <= address < ITCM_END:
+        return "ITCM"
+    if address >= FLASH_START:
+        return "flash"
+    return "-"
+
+
+def hot_class(name):
+    for prefix in HOT_CLASSES:
+        if prefix in name.split("(")[0]:
+            return prefix[:-2]
+    return None
+
+
+def main():
+    if len(sys.argv) > 3:
+        sys.exit(__doc__)
+
+    elf = sys.argv[1] if len(sys.argv) > 1 else DEFAULT_ELF
+    nm = sys.argv[2] if len(sys.argv) > 2 else DEFAULT_NM
+    symbols = read_symbols(elf, nm)
+
+    hot = [s for s in symbols if hot_class(s[2])]
+    hot.sort(key=lambda s: -s[1])
+    # Teensy firmware boots from flash, host builds have nothing there
+    teensy = any(region(s[0]) == "flash" for s in symbols)
+
+    print("Largest hot symbols:")
+    for address, size, name in hot[:LISTED]:
+        print("  %8d  %-5s  %s" % (size, region(address) if teensy else "-", name))
+
+    print("")
+    print("Hot code per class:")
+    totals = {}
+    for address, size, name in hot:
+        totals[hot_class(name)] = totals.get(hot_class(name), 0) + size
+    for prefix in HOT_CLASSES:
+        print("  %8d  %s" % (totals.get(prefix[:-2], 0), prefix[:-2]))
+    print("  %8d  total in %d symbols" % (sum(totals.values()), len(hot)))
+
+    if not teensy:
+        print("")
+        print("Not a Teensy firmware, skipping the ITCM check")
+        return
+
+    itcm = [s for s in symbols if region(s[0]) == "ITCM"]
+    itcm_used = max(address + size for address, size, name in itcm) - ITCM_START
+    itcm_banks = (itcm_used + RAM1_BANK - 1) // RAM1_BANK
+    print("")
+    print("ITCM: %d bytes in %d banks of 32 KB, %d KB of RAM1 left for DTCM" % (itcm_used, itcm_banks, (RAM1_SIZE - itcm_banks * RAM1_BANK) // 1024))
+
+    spilled = [s for s in hot if region(s[0]) != "ITCM"]
+    if spilled:
+        print("")
+        print("Hot symbols outside of ITCM:")
+        for address, size, name in spilled:
+            print("  %8d  %-5s  %s" % (size, region(address), name))
+        sys.exit(1)
+
+    print("All hot symbols are in ITCM")
+
+
+if __name__ == "__main__":
+    main()